@@ -169,6 +169,9 @@ Result<DebugConfig> DebugConfig::FromJSON(const picojson::object& config) {
   DebugConfig res;
   res.ignore_eos = json::LookupOrDefault<bool>(config, "ignore_eos", false);
   res.pinned_system_prompt = json::LookupOrDefault<bool>(config, "pinned_system_prompt", false);
+  res.prefix_cache_tenant = json::LookupOrDefault<std::string>(config, "prefix_cache_tenant", "");
+  res.share_prefix_across_tenants =
+      json::LookupOrDefault<bool>(config, "share_prefix_across_tenants", false);
   std::string special_request = json::LookupOrDefault<std::string>(config, "special_request", "");
   if (special_request.length() != 0) {
     if (special_request == "query_engine_metrics") {
@@ -202,6 +205,8 @@ picojson::object DebugConfig::AsJSON() const {
   picojson::object config;
   config["ignore_eos"] = picojson::value(ignore_eos);
   config["pinned_system_prompt"] = picojson::value(pinned_system_prompt);
+  config["prefix_cache_tenant"] = picojson::value(prefix_cache_tenant);
+  config["share_prefix_across_tenants"] = picojson::value(share_prefix_across_tenants);
   switch (special_request) {
     case SpecialRequestKind::kQueryEngineMetrics: {
       config["special_request"] = picojson::value("query_engine_metrics");
@@ -241,6 +246,12 @@ Result<GenerationConfig> GenerationConfig::Validate(GenerationConfig cfg) {
   if (cfg->top_p < 0 || cfg->top_p > 1) {
     return TResult::Error("\"top_p\" should be in range [0, 1]");
   }
+  if (cfg->top_k < 0) {
+    return TResult::Error("\"top_k\" should be non-negative, or 0 for no top-k truncation");
+  }
+  if (cfg->min_p < 0 || cfg->min_p > 1) {
+    return TResult::Error("\"min_p\" should be in range [0, 1]");
+  }
   if (std::fabs(cfg->frequency_penalty) > 2.0) {
     return TResult::Error("frequency_penalty must be in [-2, 2]!");
   }
@@ -253,6 +264,15 @@ Result<GenerationConfig> GenerationConfig::Validate(GenerationConfig cfg) {
   if (cfg->top_logprobs != 0 && !(cfg->logprobs)) {
     return TResult::Error("\"logprobs\" must be true to support \"top_logprobs\"");
   }
+  if (cfg->deadline_ms != -1 && cfg->deadline_ms <= 0) {
+    return TResult::Error("\"deadline_ms\" should be positive, or -1 for no deadline");
+  }
+  if (cfg->ttft_slo_ms != -1 && cfg->ttft_slo_ms <= 0) {
+    return TResult::Error("\"ttft_slo_ms\" should be positive, or -1 for no target");
+  }
+  if (cfg->tpot_slo_ms != -1 && cfg->tpot_slo_ms <= 0) {
+    return TResult::Error("\"tpot_slo_ms\" should be positive, or -1 for no target");
+  }
   for (const auto& item : cfg->logit_bias) {
     double bias_value = item.second;
     if (std::fabs(bias_value) > 100.0) {
@@ -270,6 +290,8 @@ Result<GenerationConfig> GenerationConfig::FromJSON(const picojson::object& conf
   n->temperature =
       json::LookupOrDefault<double>(config, "temperature", default_config->temperature);
   n->top_p = json::LookupOrDefault<double>(config, "top_p", default_config->top_p);
+  n->top_k = json::LookupOrDefault<int64_t>(config, "top_k", default_config->top_k);
+  n->min_p = json::LookupOrDefault<double>(config, "min_p", default_config->min_p);
   n->frequency_penalty =
       json::LookupOrDefault<double>(config, "frequency_penalty", default_config->frequency_penalty);
   n->presence_penalty =
@@ -299,6 +321,15 @@ Result<GenerationConfig> GenerationConfig::FromJSON(const picojson::object& conf
   // "-1" means the generation will not stop until exceeding
   // model capability or hit any stop criteria.
   n->max_tokens = json::LookupOrDefault<int64_t>(config, "max_tokens", -1);
+  n->priority = json::LookupOrDefault<int64_t>(config, "priority", default_config->priority);
+  n->deadline_ms =
+      json::LookupOrDefault<int64_t>(config, "deadline_ms", default_config->deadline_ms);
+  n->ttft_slo_ms =
+      json::LookupOrDefault<int64_t>(config, "ttft_slo_ms", default_config->ttft_slo_ms);
+  n->tpot_slo_ms =
+      json::LookupOrDefault<int64_t>(config, "tpot_slo_ms", default_config->tpot_slo_ms);
+  n->request_class = json::LookupOrDefault<std::string>(config, "request_class",
+                                                        default_config->request_class);
 
   std::optional<picojson::array> stop_strs_arr =
       json::LookupOptional<picojson::array>(config, "stop_strs");
@@ -363,6 +394,8 @@ GenerationConfig GenerationConfig::GetDefaultFromModelConfig(
   n->max_tokens = -1;
   n->temperature = json::LookupOrDefault<double>(model_config_json, "temperature", n->temperature);
   n->top_p = json::LookupOrDefault<double>(model_config_json, "top_p", n->top_p);
+  n->top_k = json::LookupOrDefault<int64_t>(model_config_json, "top_k", n->top_k);
+  n->min_p = json::LookupOrDefault<double>(model_config_json, "min_p", n->min_p);
   n->frequency_penalty =
       json::LookupOrDefault<double>(model_config_json, "frequency_penalty", n->frequency_penalty);
   n->presence_penalty =
@@ -375,6 +408,8 @@ picojson::object GenerationConfigNode::AsJSON() const {
   config["n"] = picojson::value(static_cast<int64_t>(this->n));
   config["temperature"] = picojson::value(this->temperature);
   config["top_p"] = picojson::value(this->top_p);
+  config["top_k"] = picojson::value(static_cast<int64_t>(this->top_k));
+  config["min_p"] = picojson::value(this->min_p);
   config["frequency_penalty"] = picojson::value(this->frequency_penalty);
   config["presence_penalty"] = picojson::value(this->presence_penalty);
   config["repetition_penalty"] = picojson::value(this->repetition_penalty);
@@ -382,6 +417,11 @@ picojson::object GenerationConfigNode::AsJSON() const {
   config["top_logprobs"] = picojson::value(static_cast<int64_t>(this->top_logprobs));
   config["max_tokens"] = picojson::value(static_cast<int64_t>(this->max_tokens));
   config["seed"] = picojson::value(static_cast<int64_t>(this->seed));
+  config["priority"] = picojson::value(static_cast<int64_t>(this->priority));
+  config["deadline_ms"] = picojson::value(this->deadline_ms);
+  config["ttft_slo_ms"] = picojson::value(this->ttft_slo_ms);
+  config["tpot_slo_ms"] = picojson::value(this->tpot_slo_ms);
+  config["request_class"] = picojson::value(this->request_class);
 
   picojson::object logit_bias_obj;
   for (auto [token_id, bias] : logit_bias) {
@@ -454,6 +494,44 @@ EngineConfig EngineConfig::FromJSONAndInferredConfig(
   n->spec_tree_width = json::LookupOrDefault<int64_t>(json, "spec_tree_width", n->spec_tree_width);
   n->prefill_mode = PrefillModeFromString(json::LookupOrDefault<std::string>(
       json, "prefill_mode", PrefillModeToString(n->prefill_mode)));
+  n->prefill_chunk_latency_target_ms = json::LookupOrDefault<double>(
+      json, "prefill_chunk_latency_target_ms", n->prefill_chunk_latency_target_ms);
+  n->min_prefill_chunk_size =
+      json::LookupOrDefault<int64_t>(json, "min_prefill_chunk_size", n->min_prefill_chunk_size);
+  n->scheduler_mode = SchedulerModeFromString(json::LookupOrDefault<std::string>(
+      json, "scheduler_mode", SchedulerModeToString(n->scheduler_mode)));
+  n->max_decode_steps =
+      json::LookupOrDefault<int64_t>(json, "max_decode_steps", n->max_decode_steps);
+  n->waiting_queue_order = WaitingQueueOrderFromString(json::LookupOrDefault<std::string>(
+      json, "waiting_queue_order", WaitingQueueOrderToString(n->waiting_queue_order)));
+  n->waiting_queue_max_wait_ms = json::LookupOrDefault<int64_t>(json, "waiting_queue_max_wait_ms",
+                                                                n->waiting_queue_max_wait_ms);
+  std::optional<picojson::object> request_class_weights =
+      json::LookupOptional<picojson::object>(json, "request_class_weights");
+  if (request_class_weights.has_value()) {
+    for (const auto& [request_class, weight] : request_class_weights.value()) {
+      CHECK(weight.is<int64_t>() && weight.get<int64_t>() > 0)
+          << "The weight of request class \"" << request_class << "\" should be a positive integer";
+      n->request_class_weights[request_class] = weight.get<int64_t>();
+    }
+  }
+  n->preemption_policy = PreemptionPolicyFromString(json::LookupOrDefault<std::string>(
+      json, "preemption_policy", PreemptionPolicyToString(n->preemption_policy)));
+  n->admission_policy = AdmissionPolicyFromString(json::LookupOrDefault<std::string>(
+      json, "admission_policy", AdmissionPolicyToString(n->admission_policy)));
+  n->admission_overcommit_ratio = json::LookupOrDefault<double>(
+      json, "admission_overcommit_ratio", n->admission_overcommit_ratio);
+  CHECK_GE(n->admission_overcommit_ratio, 1.0)
+      << "The admission overcommit ratio should be at least 1";
+  n->overlap_post_process =
+      json::LookupOrDefault<bool>(json, "overlap_post_process", n->overlap_post_process);
+  n->cpu_sampler_num_threads = json::LookupOrDefault<int64_t>(json, "cpu_sampler_num_threads",
+                                                              n->cpu_sampler_num_threads);
+  CHECK_GE(n->cpu_sampler_num_threads, 0) << "The CPU sampler thread number cannot be negative.";
+  n->deterministic_sampling =
+      json::LookupOrDefault<bool>(json, "deterministic_sampling", n->deterministic_sampling);
+  CHECK(!n->deterministic_sampling || n->speculative_mode == SpeculativeMode::kDisable)
+      << "Deterministic sampling does not support speculative decoding.";
   n->verbose = json::LookupOrDefault<bool>(json, "verbose", n->verbose);
 
   // - Fields from the inferred engine config.
@@ -469,6 +547,16 @@ EngineConfig EngineConfig::FromJSONAndInferredConfig(
       json, "prefix_cache_mode", PrefixCacheModeToString(n->prefix_cache_mode)));
   n->prefix_cache_max_num_recycling_seqs = json::LookupOrDefault<int64_t>(
       json, "prefix_cache_max_num_recycling_seqs", n->max_num_sequence);
+  n->prefix_cache_eviction_policy =
+      PrefixCacheEvictionPolicyFromString(json::LookupOrDefault<std::string>(
+          json, "prefix_cache_eviction_policy",
+          PrefixCacheEvictionPolicyToString(n->prefix_cache_eviction_policy)));
+  n->prefix_cache_tenant_max_num_recycling_seqs =
+      json::LookupOrDefault<int64_t>(json, "prefix_cache_tenant_max_num_recycling_seqs",
+                                     n->prefix_cache_tenant_max_num_recycling_seqs);
+  n->prefix_cache_tenant_max_recycling_tokens =
+      json::LookupOrDefault<int64_t>(json, "prefix_cache_tenant_max_recycling_tokens",
+                                     n->prefix_cache_tenant_max_recycling_tokens);
   return EngineConfig(n);
 }
 
@@ -529,9 +617,34 @@ String EngineConfigNode::AsJSONString() const {
   config["prefix_cache_mode"] = picojson::value(PrefixCacheModeToString(this->prefix_cache_mode));
   config["prefix_cache_max_num_recycling_seqs"] =
       picojson::value(static_cast<int64_t>(this->prefix_cache_max_num_recycling_seqs));
+  config["prefix_cache_eviction_policy"] =
+      picojson::value(PrefixCacheEvictionPolicyToString(this->prefix_cache_eviction_policy));
+  config["prefix_cache_tenant_max_num_recycling_seqs"] =
+      picojson::value(static_cast<int64_t>(this->prefix_cache_tenant_max_num_recycling_seqs));
+  config["prefix_cache_tenant_max_recycling_tokens"] =
+      picojson::value(this->prefix_cache_tenant_max_recycling_tokens);
   config["speculative_mode"] = picojson::value(SpeculativeModeToString(this->speculative_mode));
   config["spec_draft_length"] = picojson::value(static_cast<int64_t>(this->spec_draft_length));
   config["prefill_mode"] = picojson::value(PrefillModeToString(this->prefill_mode));
+  config["prefill_chunk_latency_target_ms"] =
+      picojson::value(this->prefill_chunk_latency_target_ms);
+  config["min_prefill_chunk_size"] = picojson::value(this->min_prefill_chunk_size);
+  config["scheduler_mode"] = picojson::value(SchedulerModeToString(this->scheduler_mode));
+  config["max_decode_steps"] = picojson::value(this->max_decode_steps);
+  config["waiting_queue_order"] =
+      picojson::value(WaitingQueueOrderToString(this->waiting_queue_order));
+  config["waiting_queue_max_wait_ms"] = picojson::value(this->waiting_queue_max_wait_ms);
+  picojson::object request_class_weights;
+  for (const auto& [request_class, weight] : this->request_class_weights) {
+    request_class_weights[request_class] = picojson::value(weight);
+  }
+  config["request_class_weights"] = picojson::value(request_class_weights);
+  config["preemption_policy"] = picojson::value(PreemptionPolicyToString(this->preemption_policy));
+  config["admission_policy"] = picojson::value(AdmissionPolicyToString(this->admission_policy));
+  config["admission_overcommit_ratio"] = picojson::value(this->admission_overcommit_ratio);
+  config["overlap_post_process"] = picojson::value(this->overlap_post_process);
+  config["cpu_sampler_num_threads"] = picojson::value(this->cpu_sampler_num_threads);
+  config["deterministic_sampling"] = picojson::value(this->deterministic_sampling);
   config["verbose"] = picojson::value(static_cast<bool>(this->verbose));
 
   return picojson::value(config).serialize(true);
@@ -11,6 +11,8 @@
 #include <tvm/runtime/object.h>
 
 #include <optional>
+#include <string>
+#include <unordered_map>
 
 #include "../metadata/model.h"
 #include "../support/result.h"
@@ -89,6 +91,10 @@ class DebugConfig {
  public:
   bool ignore_eos = false;
   bool pinned_system_prompt = false;
+  /*! \brief The tenant tag of the request, which decides its partition in prefix cache. */
+  std::string prefix_cache_tenant = "";
+  /*! \brief The flag if the prefix of the request can be matched by other tenants. */
+  bool share_prefix_across_tenants = false;
   SpecialRequestKind special_request = SpecialRequestKind::kNone;
   /*! \brief The grammar execution mode. */
   GrammarExecutionMode grammar_execution_mode = GrammarExecutionMode::kJumpForward;
@@ -113,6 +119,13 @@ class GenerationConfigNode : public Object {
   int n = 1;
   double temperature = 1.0;
   double top_p = 1.0;
+  /*! \brief The number of most probable tokens to sample from. 0 means no top-k truncation. */
+  int top_k = 0;
+  /*!
+   * \brief The minimum probability of a token to sample, relative to the maximum probability.
+   * 0 means no min-p truncation.
+   */
+  double min_p = 0.0;
   double frequency_penalty = 0.0;
   double presence_penalty = 0.0;
   double repetition_penalty = 1.0;
@@ -124,6 +137,25 @@ class GenerationConfigNode : public Object {
   int max_tokens = -1;
   Array<String> stop_strs;
   std::vector<int> stop_token_ids;
+  /*! \brief The priority of the request. Running requests of lower priority are preempted first. */
+  int priority = 0;
+  /*! \brief The deadline of the request in milliseconds after it is added. -1 means no deadline. */
+  int64_t deadline_ms = -1;
+  /*!
+   * \brief The time to first token (TTFT) target in milliseconds, which the SLO-aware scheduler
+   * tries to meet. -1 means no target.
+   */
+  int64_t ttft_slo_ms = -1;
+  /*!
+   * \brief The time per output token (TPOT) target in milliseconds, i.e., the inter-token latency
+   * target, which the SLO-aware scheduler tries to meet. -1 means no target.
+   */
+  int64_t tpot_slo_ms = -1;
+  /*!
+   * \brief The request class, among which the fair-share waiting queue order admits requests in
+   * proportion to the class weights in engine config.
+   */
+  std::string request_class = "default";
 
   ResponseFormat response_format;
   DebugConfig debug_config;
@@ -193,6 +225,87 @@ enum class PrefixCacheMode : int {
   kRadix = 1,
 };
 
+/*! \brief The eviction policy of recycling sequences in prefix cache. */
+enum class PrefixCacheEvictionPolicy : int {
+  /*! \brief Evict the least recently recycled sequence. */
+  kLRU = 0,
+  /*! \brief Evict the least frequently reused or forked sequence. */
+  kLFU = 1,
+  /*!
+   * \brief The Greedy-Dual-Size-Frequency policy, which evicts the sequence with the lowest
+   * "frequency * re-prefill cost / freed memory", aged by the priority of the last evicted one.
+   */
+  kGDSF = 2,
+  /*! \brief Evict the sequence which frees the most KV cache memory. */
+  kMaxFreedPages = 3,
+};
+
+/*! \brief The mode of scheduling prefill and decode in each engine step. */
+enum class SchedulerMode : int {
+  /*! \brief Prefill whenever the waiting requests can be prefilled, and decode otherwise. */
+  kGreedy = 0,
+  /*!
+   * \brief Choose between prefill and decode, and the prefill chunk size, in each step to maximize
+   * the number of requests meeting their TTFT and TPOT targets in generation config.
+   */
+  kSLO = 1,
+};
+
+/*! \brief The order of prefilling the requests in waiting queue. */
+enum class WaitingQueueOrder : int {
+  /*! \brief Prefill the waiting requests in the first-come-first-serve order. */
+  kFIFO = 0,
+  /*!
+   * \brief Prefill first the waiting requests with the longest prefix in prefix cache, and group
+   * the requests sharing prefixes, so that a prefix is reused by its requests while it is resident.
+   */
+  kPrefixAware = 1,
+  /*!
+   * \brief Admit the waiting requests of different request classes by deficit round robin, so
+   * that each class is prefilled tokens in proportion to its weight, and no class starves others.
+   */
+  kFairShare = 2,
+};
+
+/*!
+ * \brief The policy to choose the running request to preempt when the KV cache runs out of memory.
+ * Under every policy, only the running requests of the lowest priority are candidates, and the
+ * latest admitted one is preempted on ties.
+ */
+enum class PreemptionPolicy : int {
+  /*! \brief Preempt the latest admitted request. */
+  kLastRunning = 0,
+  /*! \brief Preempt the request holding the fewest KV cache pages, which loses the least work. */
+  kFewestPagesLost = 1,
+  /*!
+   * \brief Preempt the request with the most tokens left to generate before "max_tokens". The
+   * requests without "max_tokens" are preempted first.
+   */
+  kFurthestFromCompletion = 2,
+  /*!
+   * \brief Preempt the request with the most time left before its deadline. The requests without
+   * deadline are preempted first.
+   */
+  kDeadline = 3,
+};
+
+/*!
+ * \brief The policy to reserve KV cache pages for the future decode of requests when admitting
+ * waiting requests to prefill.
+ */
+enum class AdmissionPolicy : int {
+  /*! \brief Admit a request when its prompt fits, without reservation for decode. */
+  kPrompt = 0,
+  /*! \brief Reserve the pages of the tokens left to generate before "max_tokens". */
+  kMaxTokens = 1,
+  /*!
+   * \brief Reserve the pages of the tokens left to generate before the output length predicted
+   * from the recent completions of the same prompt template, capped by "max_tokens". Nothing is
+   * reserved before any request completes.
+   */
+  kPredicted = 2,
+};
+
 /*! \brief The speculative mode. */
 enum class SpeculativeMode : int {
   /*! \brief Disable speculative decoding. */
@@ -274,6 +387,18 @@ class EngineConfigNode : public Object {
   /*! \brief The maximum number of recycling sequences in prefix cache, default as max_num_sequence.
    * And set 0 to disable prefix cache, set -1 to have infinite capacity prefix cache. */
   int prefix_cache_max_num_recycling_seqs = -1;
+  /*! \brief The eviction policy of recycling sequences in prefix cache. */
+  PrefixCacheEvictionPolicy prefix_cache_eviction_policy = PrefixCacheEvictionPolicy::kLRU;
+  /*!
+   * \brief The maximum number of recycling sequences of each tenant in prefix cache.
+   * Set -1 for no quota.
+   */
+  int prefix_cache_tenant_max_num_recycling_seqs = -1;
+  /*!
+   * \brief The maximum total number of tokens of recycling sequences of each tenant in prefix
+   * cache. The tenants beyond the quota are evicted first. Set -1 for no quota.
+   */
+  int64_t prefix_cache_tenant_max_recycling_tokens = -1;
 
   /*************** Speculative decoding ***************/
 
@@ -292,6 +417,68 @@ class EngineConfigNode : public Object {
 
   /*! \brief The prefill mode. */
   PrefillMode prefill_mode = PrefillMode::kHybrid;
+  /*!
+   * \brief The target latency in milliseconds of a prefill step. When positive, the prefill chunk
+   * size is tuned online from a latency model fitted to the measured prefill step time, between
+   * "min_prefill_chunk_size" and "prefill_chunk_size". -1 means the static "prefill_chunk_size".
+   */
+  double prefill_chunk_latency_target_ms = -1;
+  /*! \brief The minimum prefill chunk size under adaptive prefill chunk sizing. */
+  int64_t min_prefill_chunk_size = 128;
+
+  /*************** Scheduling ***************/
+
+  /*! \brief The mode of scheduling prefill and decode in each engine step. */
+  SchedulerMode scheduler_mode = SchedulerMode::kGreedy;
+  /*!
+   * \brief The maximum number of decode steps to run in an engine step when there is no request to
+   * admit. The number decreases with the batch size, so that an engine step decodes at most
+   * "prefill_chunk_size" tokens.
+   */
+  int64_t max_decode_steps = 1;
+  /*! \brief The order of prefilling the requests in waiting queue. */
+  WaitingQueueOrder waiting_queue_order = WaitingQueueOrder::kFIFO;
+  /*!
+   * \brief The maximum time in milliseconds a request waits before it is prefilled ahead of the
+   * reordered requests, which bounds the starvation under the prefix-aware waiting queue order.
+   */
+  int64_t waiting_queue_max_wait_ms = 2000;
+  /*!
+   * \brief The weight of each request class under the fair-share waiting queue order. The classes
+   * not listed have weight 1.
+   */
+  std::unordered_map<std::string, int64_t> request_class_weights;
+  /*! \brief The policy to choose the running request to preempt. */
+  PreemptionPolicy preemption_policy = PreemptionPolicy::kLastRunning;
+  /*! \brief The policy to reserve KV cache pages for decode when admitting requests. */
+  AdmissionPolicy admission_policy = AdmissionPolicy::kPrompt;
+  /*!
+   * \brief The ratio by which the reserved KV cache pages for decode are overcommitted, i.e., the
+   * pages reserved are the expected pages divided by the ratio. It is at least 1.
+   */
+  double admission_overcommit_ratio = 1.0;
+  /*!
+   * \brief A boolean indicating whether to overlap the host post-process of an engine step, i.e.,
+   * the detokenization, stop checking, prefix cache update and stream callback, with the device
+   * execution of the next decode step.
+   */
+  bool overlap_post_process = false;
+  /*!
+   * \brief The maximum concurrency of the process-wide TVM threading backend, which the CPU
+   * sampler samples tokens and computes top logprobs with in parallel across samples. It applies
+   * to all parallel host work of TVM in the process, not only the CPU sampler, and a positive
+   * value is used as is without reserving the host threads the models require. 0 means the
+   * threads left on the host besides the threads the models require.
+   */
+  int64_t cpu_sampler_num_threads = 0;
+  /*!
+   * \brief A boolean indicating whether to sample deterministically, so that the CPU and GPU
+   * samplers sample the same tokens from the same probability distributions and seeds. The random
+   * numbers come from counter-based streams per request, indexed by the number of draws before,
+   * and the sampling sums up fixed-point probabilities, which is exact in any order. It does not
+   * support speculative decoding.
+   */
+  bool deterministic_sampling = false;
 
   /*************** Debug ***************/
   bool verbose = false;
@@ -394,6 +581,136 @@ inline PrefixCacheMode PrefixCacheModeFromString(const std::string& prefix_cache
   }
 }
 
+inline std::string PrefixCacheEvictionPolicyToString(PrefixCacheEvictionPolicy policy) {
+  if (policy == PrefixCacheEvictionPolicy::kLRU) {
+    return "lru";
+  } else if (policy == PrefixCacheEvictionPolicy::kLFU) {
+    return "lfu";
+  } else if (policy == PrefixCacheEvictionPolicy::kGDSF) {
+    return "gdsf";
+  } else if (policy == PrefixCacheEvictionPolicy::kMaxFreedPages) {
+    return "max_freed_pages";
+  } else {
+    LOG(FATAL) << "Invalid prefix cache eviction policy: " << static_cast<int>(policy);
+  }
+}
+
+inline PrefixCacheEvictionPolicy PrefixCacheEvictionPolicyFromString(const std::string& policy) {
+  if (policy == "lru") {
+    return PrefixCacheEvictionPolicy::kLRU;
+  } else if (policy == "lfu") {
+    return PrefixCacheEvictionPolicy::kLFU;
+  } else if (policy == "gdsf") {
+    return PrefixCacheEvictionPolicy::kGDSF;
+  } else if (policy == "max_freed_pages") {
+    return PrefixCacheEvictionPolicy::kMaxFreedPages;
+  } else {
+    LOG(FATAL) << "Invalid prefix cache eviction policy string: " << policy;
+  }
+}
+
+inline std::string WaitingQueueOrderToString(WaitingQueueOrder order) {
+  if (order == WaitingQueueOrder::kFIFO) {
+    return "fifo";
+  } else if (order == WaitingQueueOrder::kPrefixAware) {
+    return "prefix_aware";
+  } else if (order == WaitingQueueOrder::kFairShare) {
+    return "fair_share";
+  } else {
+    LOG(FATAL) << "Invalid waiting queue order: " << static_cast<int>(order);
+    throw;
+  }
+}
+
+inline WaitingQueueOrder WaitingQueueOrderFromString(const std::string& order) {
+  if (order == "fifo") {
+    return WaitingQueueOrder::kFIFO;
+  } else if (order == "prefix_aware") {
+    return WaitingQueueOrder::kPrefixAware;
+  } else if (order == "fair_share") {
+    return WaitingQueueOrder::kFairShare;
+  } else {
+    LOG(FATAL) << "Invalid waiting queue order string: " << order;
+    throw;
+  }
+}
+
+inline std::string SchedulerModeToString(SchedulerMode mode) {
+  if (mode == SchedulerMode::kGreedy) {
+    return "greedy";
+  } else if (mode == SchedulerMode::kSLO) {
+    return "slo";
+  } else {
+    LOG(FATAL) << "Invalid scheduler mode: " << static_cast<int>(mode);
+  }
+}
+
+inline SchedulerMode SchedulerModeFromString(const std::string& mode) {
+  if (mode == "greedy") {
+    return SchedulerMode::kGreedy;
+  } else if (mode == "slo") {
+    return SchedulerMode::kSLO;
+  } else {
+    LOG(FATAL) << "Invalid scheduler mode string: " << mode;
+    throw;
+  }
+}
+
+inline std::string PreemptionPolicyToString(PreemptionPolicy policy) {
+  if (policy == PreemptionPolicy::kLastRunning) {
+    return "last_running";
+  } else if (policy == PreemptionPolicy::kFewestPagesLost) {
+    return "fewest_pages_lost";
+  } else if (policy == PreemptionPolicy::kFurthestFromCompletion) {
+    return "furthest_from_completion";
+  } else if (policy == PreemptionPolicy::kDeadline) {
+    return "deadline";
+  } else {
+    LOG(FATAL) << "Invalid preemption policy: " << static_cast<int>(policy);
+    throw;
+  }
+}
+
+inline PreemptionPolicy PreemptionPolicyFromString(const std::string& policy) {
+  if (policy == "last_running") {
+    return PreemptionPolicy::kLastRunning;
+  } else if (policy == "fewest_pages_lost") {
+    return PreemptionPolicy::kFewestPagesLost;
+  } else if (policy == "furthest_from_completion") {
+    return PreemptionPolicy::kFurthestFromCompletion;
+  } else if (policy == "deadline") {
+    return PreemptionPolicy::kDeadline;
+  } else {
+    LOG(FATAL) << "Invalid preemption policy string: " << policy;
+    throw;
+  }
+}
+
+inline std::string AdmissionPolicyToString(AdmissionPolicy policy) {
+  if (policy == AdmissionPolicy::kPrompt) {
+    return "prompt";
+  } else if (policy == AdmissionPolicy::kMaxTokens) {
+    return "max_tokens";
+  } else if (policy == AdmissionPolicy::kPredicted) {
+    return "predicted";
+  } else {
+    LOG(FATAL) << "Invalid admission policy: " << static_cast<int>(policy);
+  }
+}
+
+inline AdmissionPolicy AdmissionPolicyFromString(const std::string& policy) {
+  if (policy == "prompt") {
+    return AdmissionPolicy::kPrompt;
+  } else if (policy == "max_tokens") {
+    return AdmissionPolicy::kMaxTokens;
+  } else if (policy == "predicted") {
+    return AdmissionPolicy::kPredicted;
+  } else {
+    LOG(FATAL) << "Invalid admission policy string: " << policy;
+    throw;
+  }
+}
+
 inline std::string SpeculativeModeToString(SpeculativeMode speculative_mode) {
   if (speculative_mode == SpeculativeMode::kDisable) {
     return "disable";
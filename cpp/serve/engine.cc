@@ -314,6 +314,10 @@ class MockEchoEngineImpl : public Engine {
 
   /************** Debug/Profile **************/
 
+  std::string ExportPrefixCache() final { return PagedRadixTree::Create()->ExportBinary(); }
+
+  PagedRadixTreeSnapshot GetPrefixCacheSnapshot() final { return PagedRadixTreeSnapshot(); }
+
   /*! \brief Internal engine metrics. */
   String JSONMetrics() final { return "{}"; }
 
@@ -435,13 +439,53 @@ class EngineImpl : public Engine {
             [engine_ptr = n.get()](int64_t seq_id) {
               RemoveRequestFromModel(engine_ptr->estate_, seq_id, engine_ptr->models_);
               engine_ptr->estate_->id_manager.RecycleId(seq_id);
-            });
+            },
+            [engine_ptr = n.get()](int64_t seq_id, size_t num_tokens) {
+              for (Model model : engine_ptr->models_) {
+                model->PopNFromKVCache(seq_id, num_tokens);
+              }
+            },
+            static_cast<size_t>(engine_config->kv_cache_page_size),
+            engine_config->prefix_cache_eviction_policy,
+            PrefixCacheTenantQuota{engine_config->prefix_cache_tenant_max_num_recycling_seqs,
+                                   engine_config->prefix_cache_tenant_max_recycling_tokens},
+            &n->estate_->metrics.prefix_cache);
+        // Estimate the KV cache bytes per token in the same way as memory estimation, i.e.,
+        // K and V in float16 for each layer of all models.
+        double kv_bytes_per_token = 0;
+        for (Model model : n->models_) {
+          ModelMetadata metadata = model->GetMetadata();
+          kv_bytes_per_token += metadata.kv_cache_metadata.head_dim *
+                                metadata.kv_cache_metadata.num_key_value_heads *
+                                metadata.kv_cache_metadata.num_hidden_layers * 4;
+        }
+        n->estate_->metrics.prefix_cache.kv_bytes_per_token = kv_bytes_per_token;
       } else if (engine_config->prefix_cache_mode == PrefixCacheMode::kDisable) {
         n->estate_->prefix_cache = PrefixCache::CreateNoPrefixCache();
       } else {
         LOG(FATAL) << "Unsupported prefix cache mode: "
                    << static_cast<int>(engine_config->prefix_cache_mode);
       }
+      n->estate_->preemption_victim_selector = PreemptionVictimSelector::Create(
+          engine_config->preemption_policy, engine_config->kv_cache_page_size,
+          n->estate_->prefix_cache);
+      if (engine_config->overlap_post_process &&
+          (engine_config->speculative_mode != SpeculativeMode::kDisable ||
+           n->estate_->disaggregation)) {
+        engine_config->overlap_post_process = false;
+        LOG(WARNING) << "Overlapped post-process is disabled, due to speculative decoding or "
+                        "disaggregation is enabled.";
+      }
+      if (engine_config->admission_policy == AdmissionPolicy::kPredicted) {
+        n->estate_->output_length_predictor =
+            std::make_unique<OutputLengthPredictor>(&n->estate_->metrics.admission);
+      }
+      if (engine_config->prefill_chunk_latency_target_ms > 0) {
+        n->estate_->prefill_chunk_size_tuner = std::make_unique<PrefillChunkSizeTuner>(
+            engine_config->prefill_chunk_latency_target_ms / 1e3,
+            engine_config->min_prefill_chunk_size, engine_config->prefill_chunk_size,
+            engine_config->kv_cache_page_size, &n->estate_->metrics.prefill_chunk);
+      }
       if (engine_config->speculative_mode != SpeculativeMode::kDisable &&
           engine_config->prefill_mode == PrefillMode::kHybrid) {
         engine_config->prefill_mode = PrefillMode::kChunked;
@@ -481,7 +525,8 @@ class EngineImpl : public Engine {
     LogitProcessor logit_processor =
         n->models_[0]->CreateLogitProcessor(max_num_tokens, trace_recorder);
     Sampler sampler = n->models_[0]->CreateSampler(
-        max_num_tokens, static_cast<int>(n->models_.size()), trace_recorder);
+        max_num_tokens, static_cast<int>(n->models_.size()), engine_config->deterministic_sampling,
+        trace_recorder);
     // - Initialize engine actions that represent state transitions.
     if (engine_config->speculative_mode != SpeculativeMode::kDisable) {
       n->estate_->spec_draft_length = engine_config->spec_draft_length;
@@ -510,6 +555,16 @@ class EngineImpl : public Engine {
 
   bool Empty() final { return estate_->running_queue.empty() && estate_->waiting_queue.empty(); }
 
+  std::string ExportPrefixCache() final { return estate_->prefix_cache->ExportBinary(); }
+
+  PagedRadixTreeSnapshot GetPrefixCacheSnapshot() final {
+    // Only the prefix-aware waiting queue order consumes the cached prefix length of requests.
+    if (engine_config_->waiting_queue_order != WaitingQueueOrder::kPrefixAware) {
+      return PagedRadixTreeSnapshot();
+    }
+    return estate_->prefix_cache->CreateSnapshot();
+  }
+
   String JSONMetrics() final { return picojson::value(estate_->metrics.AsJSON()).serialize(true); }
 
   FRequestStreamCallback GetRequestStreamCallback() final {
@@ -699,7 +754,7 @@ class EngineImpl : public Engine {
     std::vector<RequestStateEntry> rsentries;
     // Create the request state entry for the input.
     rsentries.emplace_back(request, models_.size(), estate_->id_manager.GetNewId(), rng_seed,
-                           token_table_, compiled_grammar);
+                           engine_config_->deterministic_sampling, token_table_, compiled_grammar);
     if (n > 1) {
       // Then create a request state entry for each parallel generation branch.
       // We add a offset to the rng seed so that to make generations different.
@@ -708,8 +763,8 @@ class EngineImpl : public Engine {
       for (int i = 0; i < n; ++i) {
         rsentries[0]->child_indices.push_back(rsentries.size());
         rsentries.emplace_back(request, models_.size(), estate_->id_manager.GetNewId(),
-                               rng_seed + i + 1, token_table_, compiled_grammar,
-                               /*parent_idx=*/0);
+                               rng_seed + i + 1, engine_config_->deterministic_sampling,
+                               token_table_, compiled_grammar, /*parent_idx=*/0);
       }
     }
     RequestState rstate = RequestState(std::move(rsentries), n, add_time_point);
@@ -723,10 +778,12 @@ class EngineImpl : public Engine {
   }
 
   void AbortRequest(const String& request_id) final {
+    estate_->RunDeferredPostProcess();
     AbortRequestImpl(estate_, models_, request_id);
   }
 
   void AbortAllRequests() final {
+    estate_->RunDeferredPostProcess();
     // - Collect all the request ids.
     std::vector<String> request_ids;
     request_ids.reserve(estate_->request_states.size());
@@ -744,6 +801,11 @@ class EngineImpl : public Engine {
   void Step() final {
     CHECK(estate_->request_stream_callback_ != nullptr)
         << "The request stream callback is not set. Engine cannot execute.";
+    if (!estate_->waiting_queue.empty()) {
+      // Only the batch decode overlaps the deferred post-process, and the actions admitting
+      // requests run after it.
+      estate_->RunDeferredPostProcess();
+    }
     for (EngineAction action : actions_) {
       Array<Request> processed_requests;
       {
@@ -751,19 +813,52 @@ class EngineImpl : public Engine {
         processed_requests = action->Step(estate_);
       }
       if (!processed_requests.empty()) {
-        ActionStepPostProcess(processed_requests, estate_, models_, tokenizer_,
-                              estate_->request_stream_callback_,
-                              engine_config_->max_single_sequence_length,
-                              draft_token_workspace_manager_, trace_recorder_);
+        estate_->RunDeferredPostProcess();
+        if (CanDeferPostProcess(processed_requests)) {
+          // Defer the post-process to the next decode step, which runs it in its device execution.
+          estate_->deferred_postproc = [this, processed_requests]() {
+            ActionStepPostProcess(processed_requests, estate_, models_, tokenizer_,
+                                  estate_->request_stream_callback_,
+                                  engine_config_->max_single_sequence_length,
+                                  draft_token_workspace_manager_, trace_recorder_);
+          };
+        } else {
+          ActionStepPostProcess(processed_requests, estate_, models_, tokenizer_,
+                                estate_->request_stream_callback_,
+                                engine_config_->max_single_sequence_length,
+                                draft_token_workspace_manager_, trace_recorder_);
+        }
         return;
       }
     }
+    // No action runs, so the deferred post-process has nothing to overlap with.
+    estate_->RunDeferredPostProcess();
     ICHECK(estate_->running_queue.empty())
         << "Internal assumption violated: It is expected that an engine step takes at least one "
            "action (e.g. prefill, decode, etc.) but it does not.";
   }
 
   /************** Utility Functions **************/
+  /*!
+   * \brief Check if the post-process of the given processed requests can be deferred to the next
+   * step. It requires the next step to be a decode, i.e., there is no request to admit, and the
+   * requests to have no grammar, as a grammar terminated by the last token cannot constrain the
+   * one more token decoded before the deferred post-process finishes the request.
+   */
+  bool CanDeferPostProcess(const Array<Request>& requests) {
+    if (!engine_config_->overlap_post_process || !estate_->waiting_queue.empty()) {
+      return false;
+    }
+    for (const Request& request : requests) {
+      for (const RequestStateEntry& rsentry : estate_->GetRequestState(request)->entries) {
+        if (rsentry->mstates[0]->grammar_matcher.has_value()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
   std::tuple<Optional<Session>, int, std::vector<int>> CreateDiscoSession(
       const std::vector<std::string>& model_libs,
       const std::vector<picojson::object>& model_configs, Device device) {
@@ -960,6 +1055,12 @@ class EngineImpl : public Engine {
 
   /*! \brief Set the maximum threading backend concurrency. */
   void SetThreadMaxConcurrency() {
+    if (engine_config_->cpu_sampler_num_threads > 0) {
+      // The CPU sampler runs on the threading backend. The configured concurrency applies to the
+      // whole process and replaces the host thread reservation of the models below.
+      tvm::runtime::threading::SetMaxConcurrency(engine_config_->cpu_sampler_num_threads);
+      return;
+    }
     int host_cpu_usage = 1;
     for (Model model : models_) {
       host_cpu_usage += model->EstimateHostCPURequirement();
@@ -1034,6 +1135,7 @@ class EngineModule : public ModuleNode {
   TVM_MODULE_VTABLE_ENTRY("step", &EngineModule::Step);
   TVM_MODULE_VTABLE_ENTRY("reset", &EngineModule::Reset);
   TVM_MODULE_VTABLE_ENTRY("json_metrics", &EngineModule::JSONMetrics);
+  TVM_MODULE_VTABLE_ENTRY_PACKED("export_prefix_cache", &EngineModule::ExportPrefixCache);
   TVM_MODULE_VTABLE_ENTRY("get_request_stream_callback", &EngineModule::GetRequestStreamCallback);
   TVM_MODULE_VTABLE_ENTRY("set_request_stream_callback", &EngineModule::SetRequestStreamCallback);
   TVM_MODULE_VTABLE_END();
@@ -1078,6 +1180,12 @@ class EngineModule : public ModuleNode {
   /*! \brief Redirection to `Engine::JSONMetrics`. */
   String JSONMetrics() { return GetEngine()->JSONMetrics(); }
 
+  /*! \brief Redirection to `Engine::ExportPrefixCache`, returning the data as bytes. */
+  void ExportPrefixCache(TVMArgs args, TVMRetValue* rv) {
+    std::string data = GetEngine()->ExportPrefixCache();
+    *rv = TVMByteArray{data.data(), data.size()};
+  }
+
  private:
   Engine* GetEngine() {
     ICHECK(engine_ != nullptr) << "Engine is not initialized via init";
@@ -109,6 +109,20 @@ class Engine {
    */
   virtual void Step() = 0;
 
+  /*!
+   * \brief Export the token content of the prefix cache in the binary format of
+   * "PagedRadixTreeObj::ExportBinary". The exported sequences can be prefilled by another
+   * engine to warm up its prefix cache, e.g., after restart.
+   */
+  virtual std::string ExportPrefixCache() = 0;
+
+  /*!
+   * \brief Create an immutable snapshot of the prefix cache, which can be matched by other threads
+   * to estimate the cached prefix length of incoming requests. The snapshot is undefined when
+   * prefix cache is disabled or the waiting queue order is not prefix-aware, as no one consumes it.
+   */
+  virtual PagedRadixTreeSnapshot GetPrefixCacheSnapshot() = 0;
+
   /************** Debug/Profile **************/
 
   /*! \brief Internal engine metrics. */
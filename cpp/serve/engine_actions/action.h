@@ -209,6 +209,18 @@ class EngineAction : public ObjectRef {
                                      std::vector<EngineAction> batch_decode_actions,
                                      EngineConfig engine_config);
 
+  /*!
+   * \brief Create the action that decides whether to prefill or decode in each step, and caps the
+   * prefill chunk size, to maximize the number of requests meeting their TTFT and TPOT targets.
+   * \param prefill_action The action for prefill.
+   * \param decode_actions The actions for decode, run in order until one processes requests.
+   * \param engine_config The engine config.
+   * \return The created action object.
+   */
+  static EngineAction SLOAwareSchedule(EngineAction prefill_action,
+                                       std::vector<EngineAction> decode_actions,
+                                       EngineConfig engine_config);
+
   /*!
    * \brief Create the action that runs the disaggregation preparation for prefill.
    * \param models The underlying models whose KV cache are to be updated.
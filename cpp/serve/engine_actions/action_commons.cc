@@ -119,6 +119,13 @@ Array<EngineAction> CreateEngineActions(
                                          trace_recorder)};
   }
 
+  if (engine_config->scheduler_mode == SchedulerMode::kSLO && !model_metadata.disaggregation) {
+    // Wrap the actions, whose first action is always the prefill, with the SLO-aware scheduling.
+    std::vector<EngineAction> decode_actions(actions.begin() + 1, actions.end());
+    actions = {
+        EngineAction::SLOAwareSchedule(actions[0], std::move(decode_actions), engine_config)};
+  }
+
   if (model_metadata.disaggregation) {
     // Insert the disaggregation actions.
     Array<EngineAction> disaggregation_actions = {
@@ -157,6 +164,13 @@ void RemoveRequestStateEntry(EngineState estate, const Array<Model>& models,
     }
   }
   if (estate->prefix_cache->HasSequence(rsentry->mstates[0]->internal_id)) {
+    if (estate->inflight_decode_seq_ids.count(rsentry->mstates[0]->internal_id)) {
+      // The decode in flight has appended the last committed token to KV cache, which is not in
+      // prefix cache. Pop it so that the recycled sequence matches prefix cache.
+      for (Model model : models) {
+        model->PopNFromKVCache(rsentry->mstates[0]->internal_id, 1);
+      }
+    }
     // If the sequence is stored in prefix cache, call prefix cache to remove.
     if (!(rsentry->request->generation_cfg->debug_config.pinned_system_prompt)) {
       // If the request is not pinned, recycle the request.
@@ -176,6 +190,8 @@ void ProcessFinishedRequestStateEntries(
     Optional<DraftTokenWorkspaceManager> draft_token_workspace_manager,
     Array<RequestStreamOutput>* callback_delta_outputs) {
   NVTXScopedRange nvtx_scope("Process finished requests");
+  // The finished requests are removed from running queue together in the end.
+  std::vector<Request> finished_requests;
   // - Remove the finished request state entries.
   for (const RequestStateEntry& rsentry : finished_rsentries) {
     // The finished entry must be a leaf.
@@ -212,10 +228,7 @@ void ProcessFinishedRequestStateEntries(
 
     if (parent_idx == -1) {
       // Remove from running queue and engine state.
-      auto it =
-          std::find(estate->running_queue.begin(), estate->running_queue.end(), rsentry->request);
-      ICHECK(it != estate->running_queue.end());
-      estate->running_queue.erase(it);
+      finished_requests.push_back(rsentry->request);
       estate->request_states.erase(rsentry->request->id);
 
       // Update engine metrics.
@@ -224,6 +237,11 @@ void ProcessFinishedRequestStateEntries(
 
       rstate->metrics.finish_time_point = trequest_finish;
       estate->metrics.RequestFinishUpdate(rstate->metrics);
+      if (estate->output_length_predictor != nullptr) {
+        estate->output_length_predictor->Update(
+            rsentry->request,
+            rstate->metrics.completion_tokens / rsentry->request->generation_cfg->n);
+      }
 
       // always stream back usage in backend
       callback_delta_outputs->push_back(RequestStreamOutput::Usage(
@@ -231,6 +249,8 @@ void ProcessFinishedRequestStateEntries(
     }
     estate->running_rsentries_changed = true;
   }
+  int num_removed = RemoveRequestsFromQueue(&estate->running_queue, finished_requests);
+  ICHECK_EQ(num_removed, static_cast<int>(finished_requests.size()));
 }
 
 void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Array<Model>& models,
@@ -246,6 +266,7 @@ void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Ar
   estate->postproc_workspace.finished_rsentries.reserve(num_requests);
   estate->postproc_workspace.callback_delta_outputs.reserve(num_requests * 2);
 
+  auto tpostproc = std::chrono::high_resolution_clock::now();
   // - Collect new generated tokens and finish reasons for requests.
   for (int r = 0; r < num_requests; ++r) {
     Request request = requests[r];
@@ -265,6 +286,9 @@ void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Ar
           !stream_output->group_extra_prefix_string[i].empty()) {
         invoke_callback = true;
       }
+      if (!stream_output->group_delta_token_ids[i].empty()) {
+        rstate->metrics.last_token_time_point = tpostproc;
+      }
     }
 
     if (invoke_callback) {
@@ -326,22 +350,17 @@ void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Ar
   }
 }  // namespace serve
 
-RequestStateEntry PreemptLastRunningRequestStateEntry(
+RequestStateEntry PreemptRunningRequestStateEntry(
     EngineState estate, const Array<Model>& models,
     Optional<DraftTokenWorkspaceManager> draft_token_workspace_manager,
     Optional<EventTraceRecorder> trace_recorder) {
   ICHECK(!estate->running_queue.empty());
-  Request request = estate->running_queue.back();
+  int victim_idx = estate->preemption_victim_selector->SelectVictim(estate->running_queue);
+  Request request = estate->running_queue[victim_idx];
 
   // Find the last alive request state entry, which is what we want to preempt.
   RequestState rstate = estate->GetRequestState(request);
-  int preempt_rstate_idx = -1;
-  for (int i = static_cast<int>(rstate->entries.size()) - 1; i >= 0; --i) {
-    if (rstate->entries[i]->status == RequestStateStatus::kAlive) {
-      preempt_rstate_idx = i;
-      break;
-    }
-  }
+  int preempt_rstate_idx = PreemptionVictimSelector::GetLastAliveEntryIndex(rstate);
   ICHECK_NE(preempt_rstate_idx, -1);
   RequestStateEntry rsentry = rstate->entries[preempt_rstate_idx];
   if (estate->disaggregation) {
@@ -356,6 +375,12 @@ RequestStateEntry PreemptLastRunningRequestStateEntry(
   // - Clear model speculation draft.
   // - Update `inputs` for future prefill.
   RECORD_EVENT(trace_recorder, rsentry->request->id, "preempt");
+  // The prefilled tokens and the committed tokens but the last one, which is not in KV cache
+  // until the next decode, are to prefill again.
+  const RequestModelState& main_mstate = rsentry->mstates[0];
+  estate->metrics.preemption.Update(
+      main_mstate->num_prefilled_tokens +
+      std::max(static_cast<int64_t>(main_mstate->committed_tokens.size()) - 1, int64_t{0}));
   rsentry->status = RequestStateStatus::kPending;
   std::vector<int> draft_token_slots;
   for (RequestModelState mstate : rsentry->mstates) {
@@ -412,7 +437,7 @@ RequestStateEntry PreemptLastRunningRequestStateEntry(
 
   if (preempt_rstate_idx == 0) {
     // Remove from running queue.
-    estate->running_queue.erase(estate->running_queue.end() - 1);
+    estate->running_queue.erase(estate->running_queue.begin() + victim_idx);
   }
   if (!partially_alive && preempt_rstate_idx == static_cast<int>(rstate->entries.size()) - 1) {
     // Add to the front of waiting queue.
@@ -63,7 +63,8 @@ void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Ar
                            Optional<EventTraceRecorder> trace_recorder);
 
 /*!
- * \brief Preempt the last running request state entry from `running_queue`.
+ * \brief Preempt the last alive request state entry of the running request selected by the
+ * preemption policy of engine state.
  * If all entries of the selected request have been preempted,
  * remove it from running request.
  * If it is not in the waiting request queue, add it to the waiting queue.
@@ -74,7 +75,7 @@ void ActionStepPostProcess(Array<Request> requests, EngineState estate, const Ar
  * \param trace_recorder The event trace recorder for requests.
  * \return The preempted request state.
  */
-RequestStateEntry PreemptLastRunningRequestStateEntry(
+RequestStateEntry PreemptRunningRequestStateEntry(
     EngineState estate, const Array<Model>& models,
     Optional<DraftTokenWorkspaceManager> draft_token_workspace_manager,
     Optional<EventTraceRecorder> trace_recorder);
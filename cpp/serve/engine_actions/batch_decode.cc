@@ -5,7 +5,7 @@
 
 #include <tvm/runtime/nvtx.h>
 
-#include <numeric>
+#include <algorithm>
 
 #include "../../support/random.h"
 #include "../config.h"
@@ -46,29 +46,83 @@ class BatchDecodeActionObj : public EngineActionObj {
     }
 
     // Preempt request state entries when decode cannot apply.
-    std::vector<RequestStateEntry> running_rsentries;
+    const std::vector<RequestStateEntry>* running_rsentries;
     {
       NVTXScopedRange nvtx_scope("BatchDecode getting requests");
-      running_rsentries = estate->GetRunningRequestStateEntries();
-      while (!CanDecode(running_rsentries.size())) {
-        if (estate->prefix_cache->TryFreeMemory()) continue;
-        RequestStateEntry preempted =
-            PreemptLastRunningRequestStateEntry(estate, models_, NullOpt, trace_recorder_);
-        if (preempted.same_as(running_rsentries.back())) {
-          running_rsentries.pop_back();
+      running_rsentries = &estate->GetRunningRequestStateEntries();
+      while (!CanDecode(running_rsentries->size())) {
+        if (estate->deferred_postproc != nullptr) {
+          // The deferred post-process of the last step may finish requests and free KV cache.
+          estate->RunDeferredPostProcess();
+        } else if (estate->prefix_cache->TryFreeMemory()) {
+          continue;
+        } else {
+          PreemptRunningRequestStateEntry(estate, models_, NullOpt, trace_recorder_);
         }
+        running_rsentries = &estate->GetRunningRequestStateEntries();
       }
-      while (running_rsentries.size() >
-             std::min(static_cast<int64_t>(engine_config_->max_num_sequence),
-                      engine_config_->prefill_chunk_size)) {
-        running_rsentries.pop_back();
+    }
+    if (estate->running_queue.empty()) {
+      return {};
+    }
+
+    // Take the decode batch descriptor maintained in engine state, which is rebuilt only when the
+    // running request state entries change. In the rare case that the running entries exceed the
+    // batch limit, only the leading entries are decoded with a descriptor built for this step.
+    DecodeBatch* batch = &estate->GetDecodeBatch();
+    DecodeBatch truncated_batch;
+    int max_num_rsentries =
+        static_cast<int>(std::min(static_cast<int64_t>(engine_config_->max_num_sequence),
+                                  engine_config_->prefill_chunk_size));
+    if (static_cast<int>(running_rsentries->size()) > max_num_rsentries) {
+      truncated_batch.Build(std::vector<RequestStateEntry>(
+          running_rsentries->begin(), running_rsentries->begin() + max_num_rsentries));
+      batch = &truncated_batch;
+    }
+
+    // - Run the decode steps. Multiple decode steps run in steady state without returning to the
+    // engine. The request state entries finished by tokens, or with stop strings, stop decoding in
+    // later steps.
+    const std::vector<RequestStateEntry>* rsentries = running_rsentries;
+    std::vector<RequestStateEntry> unfinished_rsentries;
+    DecodeBatch unfinished_batch;
+    int num_decode_steps = GetNumDecodeSteps(estate, batch->mstates.size());
+    for (int i = 0; i < num_decode_steps; ++i) {
+      if (i > 0) {
+        std::vector<RequestStateEntry> next_rsentries;
+        next_rsentries.reserve(batch->mstates.size());
+        for (int j = 0; j < static_cast<int>(batch->mstates.size()); ++j) {
+          if (CanDecodeNextStep((*rsentries)[j])) {
+            next_rsentries.push_back((*rsentries)[j]);
+          }
+        }
+        if (next_rsentries.empty() || !CanDecode(next_rsentries.size())) {
+          break;
+        }
+        if (next_rsentries.size() < batch->mstates.size()) {
+          unfinished_rsentries = std::move(next_rsentries);
+          unfinished_batch.Build(unfinished_rsentries);
+          rsentries = &unfinished_rsentries;
+          batch = &unfinished_batch;
+        }
       }
+      DecodeStep(estate, batch, *rsentries);
     }
 
+    return estate->running_queue;
+  }
+
+ private:
+  /*!
+   * \brief Run one decode step for the request state entries in the given decode batch, and commit
+   * the sampled tokens.
+   */
+  void DecodeStep(EngineState estate, DecodeBatch* batch,
+                  const std::vector<RequestStateEntry>& rsentries) {
     auto tstart = std::chrono::high_resolution_clock::now();
 
     // NOTE: Right now we only support decode all the running request states at a time.
-    int num_rsentries = running_rsentries.size();
+    int num_rsentries = batch->mstates.size();
     ICHECK_GT(num_rsentries, 0)
         << "There should be at least one request state entry that can run decode. "
            "Possible failure reason: none of the prefill phase of the running requests is finished";
@@ -76,31 +130,19 @@ class BatchDecodeActionObj : public EngineActionObj {
         << "The number of running requests exceeds the max number of sequence in EngineConfig. "
            "Possible failure reason: the prefill action allows new sequence in regardless of the "
            "max num sequence.";
-    // Collect
-    // - the last committed token,
-    // - the request id,
-    // - the generation config,
-    // - the random number generator,
-    // of each request state entry.
-    std::vector<int> input_tokens;
-    std::vector<int> lengths;
-    Array<String> request_ids;
-    std::vector<int64_t> request_internal_ids;
-    Array<RequestModelState> mstates;
-    Array<GenerationConfig> generation_cfg;
-    std::vector<RandomGenerator*> rngs;
-
-    input_tokens.reserve(num_rsentries);
-    request_ids.reserve(num_rsentries);
-    request_internal_ids.reserve(num_rsentries);
-    mstates.reserve(num_rsentries);
-    generation_cfg.reserve(num_rsentries);
-    rngs.reserve(num_rsentries);
+    // Collect the last committed tokens of each request state entry. The request ids, the
+    // generation configs and the random number generators are in the decode batch descriptor.
+    std::vector<int>& input_tokens = batch->input_tokens;
+    std::vector<int>& lengths = batch->lengths;
+    const Array<String>& request_ids = batch->request_ids;
+    const Array<RequestModelState>& mstates = batch->mstates;
+    const Array<GenerationConfig>& generation_cfg = batch->generation_cfg;
+    input_tokens.clear();
+    lengths.clear();
 
     {
       NVTXScopedRange nvtx_scope("BatchDecode setting batch info");
-      for (const RequestStateEntry& rsentry : running_rsentries) {
-        auto mstate = rsentry->mstates[0];
+      for (const RequestModelState& mstate : mstates) {
         ICHECK(mstate->num_tokens_for_next_decode > 0 &&
                mstate->num_tokens_for_next_decode <=
                    static_cast<int>(mstate->committed_tokens.size()));
@@ -112,12 +154,6 @@ class BatchDecodeActionObj : public EngineActionObj {
 
         lengths.push_back(mstate->num_tokens_for_next_decode);
         mstate->num_tokens_for_next_decode = 0;
-
-        request_ids.push_back(rsentry->request->id);
-        request_internal_ids.push_back(mstate->internal_id);
-        mstates.push_back(mstate);
-        generation_cfg.push_back(rsentry->request->generation_cfg);
-        rngs.push_back(&rsentry->rng);
       }
     }
 
@@ -135,12 +171,12 @@ class BatchDecodeActionObj : public EngineActionObj {
     RECORD_EVENT(trace_recorder_, request_ids, "start decode");
     NDArray logits;
     if (is_every_request_single_token) {
-      logits = models_[0]->BatchDecode(embeddings, request_internal_ids);
+      logits = models_[0]->BatchDecode(embeddings, batch->request_internal_ids);
       ICHECK_EQ(logits->ndim, 3);
       ICHECK_EQ(logits->shape[0], num_rsentries);
       ICHECK_EQ(logits->shape[1], 1);
     } else {
-      logits = models_[0]->BatchPrefill(embeddings, request_internal_ids, lengths);
+      logits = models_[0]->BatchPrefill(embeddings, batch->request_internal_ids, lengths);
       ICHECK_EQ(logits->ndim, 3);
       ICHECK_EQ(logits->shape[0], 1);
       ICHECK_EQ(logits->shape[1], num_rsentries);
@@ -155,35 +191,48 @@ class BatchDecodeActionObj : public EngineActionObj {
     NDArray probs_on_device =
         logit_processor_->ComputeProbsFromLogits(logits, generation_cfg, request_ids);
 
+    // - Run the post-process of the last step deferred by the engine, to overlap it with the GPU
+    // execution. The requests it finishes have been decoded one more token in this step, which
+    // is discarded.
+    if (estate->deferred_postproc != nullptr) {
+      NVTXScopedRange nvtx_scope("BatchDecode deferred postproc");
+      estate->inflight_decode_seq_ids.insert(batch->request_internal_ids.begin(),
+                                             batch->request_internal_ids.end());
+      estate->RunDeferredPostProcess();
+      estate->inflight_decode_seq_ids.clear();
+    }
+
     // - Commit the prefix cache changes from previous round of action.
     // Note: we commit prefix cache changes here to overlap this commit with the GPU execution.
     estate->prefix_cache->CommitSequenceExtention();
 
     // - Sample tokens.
-    // Fill range [0, num_rsentries) into `sample_indices`.
-    std::vector<int> sample_indices(num_rsentries);
-    std::iota(sample_indices.begin(), sample_indices.end(), 0);
+    const std::vector<int>& sample_indices = batch->sample_indices;
     NDArray renormalized_probs = sampler_->BatchRenormalizeProbsByTopP(
         probs_on_device, sample_indices, request_ids, generation_cfg);
     std::vector<SampleResult> sample_results = sampler_->BatchSampleTokensWithProbAfterTopP(
-        renormalized_probs, sample_indices, request_ids, generation_cfg, rngs);
+        renormalized_probs, sample_indices, request_ids, generation_cfg, batch->rngs);
     ICHECK_EQ(sample_results.size(), num_rsentries);
 
     // - Update the committed tokens of states.
     for (int i = 0; i < num_rsentries; ++i) {
+      if (rsentries[i]->status == RequestStateStatus::kFinished) {
+        // The request has finished in the deferred post-process.
+        continue;
+      }
       auto mstate = mstates[i];
 
       if (!mstate->require_retokenization_in_next_decode) {
         mstates[i]->CommitToken(sample_results[i]);
         // live update the output metrics
-        running_rsentries[i]->rstate->metrics.completion_tokens += 1;
+        rsentries[i]->rstate->metrics.completion_tokens += 1;
       } else {
         // Retokenize and commit tokens.
-        CommitTokenMayRetokenize(running_rsentries[i], mstate, sample_results[i]);
+        CommitTokenMayRetokenize(rsentries[i], mstate, sample_results[i]);
         mstate->require_retokenization_in_next_decode = false;
       }
 
-      running_rsentries[i]->rstate->metrics.decode_tokens += lengths[i];
+      rsentries[i]->rstate->metrics.decode_tokens += lengths[i];
     }
 
     double elapsed_time;
@@ -194,11 +243,59 @@ class BatchDecodeActionObj : public EngineActionObj {
     }
     estate->metrics.engine_decode_time_sum += elapsed_time;
     estate->metrics.UpdateDecodeTimeByBatchSize(num_rsentries, elapsed_time);
+  }
 
-    return estate->running_queue;
+  /*!
+   * \brief Get the number of decode steps to run in an engine step. Multiple decode steps run only
+   * when there is no request to admit, and an engine step decodes at most "prefill_chunk_size"
+   * tokens, so that large batches return to the engine as often as a prefill step.
+   */
+  int GetNumDecodeSteps(EngineState estate, int num_rsentries) {
+    if (engine_config_->max_decode_steps <= 1 || !estate->waiting_queue.empty()) {
+      return 1;
+    }
+    int64_t num_decode_steps = engine_config_->prefill_chunk_size / num_rsentries;
+    return static_cast<int>(
+        std::max(int64_t{1}, std::min(num_decode_steps, engine_config_->max_decode_steps)));
+  }
+
+  /*!
+   * \brief Check if the request state entry can run the next decode step of an engine step. The
+   * entries with stop strings decode one step only, as the stop strings need detokenization in
+   * the post-process. Otherwise the tokens decoded past a stop string would be counted as
+   * completion tokens and stay in KV cache.
+   */
+  bool CanDecodeNextStep(const RequestStateEntry& rsentry) {
+    return rsentry->request->generation_cfg->stop_strs.empty() && !IsFinishedByTokens(rsentry);
+  }
+
+  /*!
+   * \brief Check if the request state entry finishes by its committed tokens, i.e., by a stop
+   * token, the max tokens, the max single sequence length or the termination of its grammar, as
+   * the post-process decides.
+   */
+  bool IsFinishedByTokens(const RequestStateEntry& rsentry) {
+    if (rsentry->status == RequestStateStatus::kFinished) {
+      return true;
+    }
+    const RequestModelState& mstate = rsentry->mstates[0];
+    const GenerationConfig& generation_cfg = rsentry->request->generation_cfg;
+    int num_committed_tokens = mstate->committed_tokens.size();
+    int32_t last_token_id = mstate->committed_tokens.back().GetTokenId();
+    if (!generation_cfg->debug_config.ignore_eos &&
+        std::any_of(generation_cfg->stop_token_ids.begin(), generation_cfg->stop_token_ids.end(),
+                    [last_token_id](int32_t token) { return token == last_token_id; })) {
+      return true;
+    }
+    if (mstate->grammar_matcher.has_value() && mstate->grammar_matcher->IsTerminated()) {
+      return true;
+    }
+    return (generation_cfg->max_tokens >= 0 &&
+            num_committed_tokens >= generation_cfg->max_tokens) ||
+           rsentry->request->prompt_tokens + num_committed_tokens >=
+               engine_config_->max_single_sequence_length;
   }
 
- private:
   /*! \brief Check if the input request state entries can be decoded under conditions. */
   bool CanDecode(int num_rsentries) {
     int num_available_pages = models_[0]->GetNumAvailablePages();
@@ -6,6 +6,7 @@
 #include <tvm/runtime/nvtx.h>
 #include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <cmath>
 #include <exception>
 
@@ -37,6 +38,11 @@ class BatchJumpForwardActionObj : public EngineActionObj {
     if (models_.size() > 1 || estate->running_queue.empty()) {
       return {};
     }
+    // - The post-process is deferred only when no running request has grammar, in which case
+    // there is nothing to jump forward.
+    if (estate->deferred_postproc != nullptr) {
+      return {};
+    }
 
     // Preempt request state entries when jump-forward decoding cannot apply.
     std::vector<RequestStateEntry> running_rsentries;
@@ -46,9 +52,10 @@ class BatchJumpForwardActionObj : public EngineActionObj {
       while (!CheckMemForJumpForward(running_rsentries.size())) {
         if (estate->prefix_cache->TryFreeMemory()) continue;
         RequestStateEntry preempted =
-            PreemptLastRunningRequestStateEntry(estate, models_, NullOpt, trace_recorder_);
-        if (preempted.same_as(running_rsentries.back())) {
-          running_rsentries.pop_back();
+            PreemptRunningRequestStateEntry(estate, models_, NullOpt, trace_recorder_);
+        auto it = std::find(running_rsentries.begin(), running_rsentries.end(), preempted);
+        if (it != running_rsentries.end()) {
+          running_rsentries.erase(it);
         }
       }
     }
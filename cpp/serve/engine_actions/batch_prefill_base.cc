@@ -5,6 +5,8 @@
 
 #include "batch_prefill_base.h"
 
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 #include "../../support/json_parser.h"
@@ -40,6 +42,238 @@ BatchPrefillBaseActionObj::BatchPrefillBaseActionObj(Array<Model> models,
   kv_state_kind_ = models_[0]->GetMetadata().kv_state_kind;
 }
 
+/*!
+ * \brief Get the token ids of the leading TokenData inputs of a request.
+ * \param request The request.
+ * \return The token ids, which stop before the first input that is not TokenData.
+ */
+inline std::vector<int32_t> GetLeadingTokenIds(const Request& request) {
+  std::vector<int32_t> token_ids;
+  for (const Data& input : request->inputs) {
+    const auto* token_data = input.as<TokenDataNode>();
+    if (token_data == nullptr) {
+      break;
+    }
+    token_ids.insert(token_ids.end(), token_data->token_ids.begin(), token_data->token_ids.end());
+  }
+  return token_ids;
+}
+
+/*!
+ * \brief Get the key grouping the requests which share the leading tokens, as the FNV-1a hash of
+ * at most the first "kPrefixGroupLength" leading TokenData tokens of a request.
+ * \param request The request.
+ * \return The non-negative group key.
+ */
+inline int64_t GetPrefixGroupKey(const Request& request) {
+  constexpr int kPrefixGroupLength = 64;
+  uint64_t hash = 14695981039346656037ULL;
+  int num_tokens = 0;
+  for (const Data& input : request->inputs) {
+    const auto* token_data = input.as<TokenDataNode>();
+    if (token_data == nullptr) {
+      break;
+    }
+    for (int32_t token_id : token_data->token_ids) {
+      if (num_tokens++ == kPrefixGroupLength) {
+        return static_cast<int64_t>(hash >> 1);
+      }
+      hash = (hash ^ static_cast<uint32_t>(token_id)) * 1099511628211ULL;
+    }
+  }
+  return static_cast<int64_t>(hash >> 1);
+}
+
+/*!
+ * \brief Run the deficit round robin over the queues of request classes.
+ * \param class_queues The non-empty queues of the waiting requests of each request class, together
+ * with their prompt lengths. They are walked with a cursor per class instead of popped, so that
+ * the dry run of the admission order does not copy them.
+ * \param state The deficit round robin state, which is advanced by the admitted requests.
+ * \param quantum The quantum of tokens a class of weight 1 gains in each turn.
+ * \param weights The weight of each request class.
+ * \param max_num_requests The maximum number of requests to admit.
+ * \return The admitted requests in the order of admission.
+ */
+inline std::vector<Request> DeficitRoundRobin(
+    const std::map<std::string, std::deque<std::pair<Request, int64_t>>>& class_queues,
+    FairShareState* state, int64_t quantum,
+    const std::unordered_map<std::string, int64_t>& weights, size_t max_num_requests) {
+  std::vector<Request> admitted_requests;
+  // A class without waiting requests does not bank its deficit.
+  for (auto it = state->deficits.begin(); it != state->deficits.end();) {
+    it = class_queues.count(it->first) ? std::next(it) : state->deficits.erase(it);
+  }
+  // The position of the next request to admit of each class, in the order of the classes.
+  std::vector<size_t> heads(class_queues.size(), 0);
+  size_t num_waiting_classes = class_queues.size();
+  auto it = class_queues.lower_bound(state->current_class);
+  size_t class_index = std::distance(class_queues.begin(), it);
+  while (admitted_requests.size() < max_num_requests && num_waiting_classes > 0) {
+    if (it == class_queues.end()) {
+      it = class_queues.begin();
+      class_index = 0;
+    }
+    const auto& [request_class, queue] = *it;
+    size_t& head = heads[class_index];
+    if (head == queue.size()) {
+      // All requests of the class are admitted.
+      ++it;
+      ++class_index;
+      continue;
+    }
+    if (request_class != state->current_class) {
+      state->current_class = request_class;
+      state->quantum_granted = false;
+    }
+    int64_t& deficit = state->deficits[request_class];
+    if (!state->quantum_granted) {
+      auto it_weight = weights.find(request_class);
+      deficit += quantum * (it_weight != weights.end() ? it_weight->second : 1);
+      state->quantum_granted = true;
+    }
+    while (head < queue.size() && queue[head].second <= deficit &&
+           admitted_requests.size() < max_num_requests) {
+      deficit -= queue[head].second;
+      admitted_requests.push_back(queue[head].first);
+      ++head;
+    }
+    if (head == queue.size()) {
+      state->deficits.erase(request_class);
+      --num_waiting_classes;
+    } else if (admitted_requests.size() >= max_num_requests) {
+      // The turn of the class continues in the next step.
+      break;
+    }
+    ++it;
+    ++class_index;
+    state->quantum_granted = false;
+  }
+  return admitted_requests;
+}
+
+void BatchPrefillBaseActionObj::ReorderWaitingQueue(EngineState estate) {
+  if (engine_config_->waiting_queue_order == WaitingQueueOrder::kFairShare) {
+    NVTXScopedRange nvtx_scope("Reorder waiting queue");
+    // The queues are kept across steps to reuse their memory, and refilled from the waiting queue.
+    for (auto& [request_class, queue] : fair_share_queues_) {
+      queue.clear();
+    }
+    std::vector<Request> pinned_requests;
+    for (const Request& request : estate->waiting_queue) {
+      const RequestStateEntry& root_rsentry = estate->GetRequestState(request)->entries[0];
+      // Requests which are partially prefilled or preempted are admitted already.
+      if (root_rsentry->status != RequestStateStatus::kPending ||
+          !root_rsentry->mstates[0]->committed_tokens.empty()) {
+        pinned_requests.push_back(request);
+        continue;
+      }
+      fair_share_queues_[request->generation_cfg->request_class].emplace_back(
+          request, root_rsentry->mstates[0]->GetInputLength());
+    }
+    for (auto it = fair_share_queues_.begin(); it != fair_share_queues_.end();) {
+      it = it->second.empty() ? fair_share_queues_.erase(it) : std::next(it);
+    }
+    for (auto& [request_class, class_metrics] : estate->metrics.request_classes) {
+      class_metrics.queue_depth = 0;
+    }
+    for (const auto& [request_class, queue] : fair_share_queues_) {
+      estate->metrics.request_classes[request_class].queue_depth =
+          static_cast<int64_t>(queue.size());
+    }
+    // Order the requests by a dry run of the deficit round robin, which is advanced only by the
+    // requests admitted in the end.
+    FairShareState state = estate->fair_share;
+    std::vector<Request> admission_order =
+        DeficitRoundRobin(fair_share_queues_, &state, engine_config_->prefill_chunk_size,
+                          engine_config_->request_class_weights, estate->waiting_queue.size());
+    estate->waiting_queue = std::move(pinned_requests);
+    estate->waiting_queue.insert(estate->waiting_queue.end(), admission_order.begin(),
+                                 admission_order.end());
+    return;
+  }
+  if (engine_config_->waiting_queue_order != WaitingQueueOrder::kPrefixAware ||
+      estate->waiting_queue.size() <= 1) {
+    return;
+  }
+  NVTXScopedRange nvtx_scope("Reorder waiting queue");
+  PagedRadixTreeSnapshot snapshot = estate->prefix_cache->CreateSnapshot();
+  if (!snapshot.defined()) {
+    // Prefix cache is disabled, and there is no prefix to reuse.
+    return;
+  }
+
+  auto now = std::chrono::high_resolution_clock::now();
+  auto max_wait = std::chrono::milliseconds(engine_config_->waiting_queue_max_wait_ms);
+  std::vector<Request> pinned_requests;
+  std::vector<Request> ranked_requests;
+  for (const Request& request : estate->waiting_queue) {
+    RequestState rstate = estate->GetRequestState(request);
+    const RequestStateEntry& root_rsentry = rstate->entries[0];
+    // Requests which are partially prefilled, preempted or starving are not reordered.
+    if (root_rsentry->status != RequestStateStatus::kPending ||
+        !root_rsentry->mstates[0]->committed_tokens.empty() ||
+        now - rstate->metrics.add_time_point >= max_wait) {
+      pinned_requests.push_back(request);
+      continue;
+    }
+    // The match length is cached by snapshot version, so a request is matched at most once per
+    // snapshot, possibly already by the thread adding it.
+    if (request->cached_prefix_snapshot_version != snapshot->version) {
+      request->cached_prefix_length =
+          static_cast<int>(snapshot->MatchPrefixLength(GetLeadingTokenIds(request)));
+      request->cached_prefix_snapshot_version = snapshot->version;
+    }
+    if (request->prefix_group_key == -1) {
+      request->prefix_group_key = GetPrefixGroupKey(request);
+    }
+    ranked_requests.push_back(request);
+  }
+  // Rank by the cached prefix length, and group the requests sharing the leading tokens, so that
+  // the later ones of a group reuse the prefix prefilled by the first one.
+  std::stable_sort(ranked_requests.begin(), ranked_requests.end(),
+                   [](const Request& lhs, const Request& rhs) {
+                     if (lhs->cached_prefix_length != rhs->cached_prefix_length) {
+                       return lhs->cached_prefix_length > rhs->cached_prefix_length;
+                     }
+                     return lhs->prefix_group_key < rhs->prefix_group_key;
+                   });
+  estate->waiting_queue = std::move(pinned_requests);
+  estate->waiting_queue.insert(estate->waiting_queue.end(), ranked_requests.begin(),
+                               ranked_requests.end());
+}
+
+/*!
+ * \brief Charge the deficit round robin of the fair-share order for the requests first prefilled
+ * in this step, which lead the waiting queue in the order the round robin admits them.
+ * \param estate The engine state, whose fair-share state and request class metrics are updated.
+ * \param prefill_inputs The prefill inputs of the step.
+ */
+void BatchPrefillBaseActionObj::AdmitFairShareRequests(
+    EngineState estate, const std::vector<PrefillInput>& prefill_inputs) {
+  // The requests first prefilled in this step are the leading requests in admission order.
+  size_t num_admitted_requests = 0;
+  for (const PrefillInput& input : prefill_inputs) {
+    if (!input.is_decode && input.rsentry->parent_idx == -1 &&
+        input.rsentry->status == RequestStateStatus::kPending &&
+        input.rsentry->mstates[0]->committed_tokens.empty()) {
+      ++num_admitted_requests;
+    }
+  }
+  if (num_admitted_requests == 0) {
+    return;
+  }
+  auto now = std::chrono::high_resolution_clock::now();
+  std::vector<Request> admitted_requests = DeficitRoundRobin(
+      fair_share_queues_, &estate->fair_share, engine_config_->prefill_chunk_size,
+      engine_config_->request_class_weights, num_admitted_requests);
+  for (const Request& request : admitted_requests) {
+    RequestState rstate = estate->GetRequestState(request);
+    estate->metrics.request_classes[request->generation_cfg->request_class].UpdateAdmit(
+        static_cast<double>((now - rstate->metrics.add_time_point).count()) / 1e9);
+  }
+}
+
 /*!
  * \brief Find one or multiple request state entries to run prefill.
  * \param estate The engine state.
@@ -63,11 +297,21 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
     // No request to prefill.
     return {};
   }
+  ReorderWaitingQueue(estate);
 
   std::vector<std::vector<PrefillInput>> prefill_inputs_for_all_models;
   prefill_inputs_for_all_models.reserve(models_.size());
 
   int num_decode_inputs = static_cast<int>(running_rsentries->size());
+  int64_t prefill_chunk_size = GetPrefillChunkSize(estate);
+  // The KV cache pages reserved for the future decode of the running requests.
+  int num_decode_reserved_pages = 0;
+  if (engine_config_->admission_policy != AdmissionPolicy::kPrompt) {
+    for (const RequestStateEntry& rsentry : *running_rsentries) {
+      num_decode_reserved_pages += GetDecodeReservedPages(estate, rsentry, /*num_outputs=*/1);
+    }
+    estate->metrics.admission.reserved_pages = num_decode_reserved_pages;
+  }
 
   // We first collect the inputs that can be prefilled for each model.
   // Then we make a reduction to return the maximum common inputs.
@@ -78,7 +322,9 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
     for (const RequestStateEntry& rsentry : *running_rsentries) {
       total_input_length += rsentry->mstates[i]->num_tokens_for_next_decode;
     }
-    int total_required_pages = num_decode_inputs;
+    // The reservation does not apply under sliding window, where the pages of a request are bound.
+    int num_running_reserved_pages = sliding_window_sizes_[i] == -1 ? num_decode_reserved_pages : 0;
+    int total_required_pages = num_decode_inputs + num_running_reserved_pages;
     int num_available_pages;
     int num_running_rsentries = num_decode_inputs;
     int current_total_seq_len;
@@ -136,6 +382,14 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
           num_require_pages = std::min(num_require_pages, num_required_pages_under_sliding_window);
           ICHECK_GE(num_require_pages, 0);
         }
+        // Reserve the pages for the future decode of the request. The first request to run is
+        // always admitted, as nothing is to preempt for it.
+        int num_reserved_pages = 0;
+        if (!sliding_window_enabled && rsentry->parent_idx == -1 &&
+            num_running_rsentries + num_prefill_rsentries > 0) {
+          num_reserved_pages = GetDecodeReservedPages(estate, rsentry, request->generation_cfg->n);
+        }
+        num_require_pages += num_reserved_pages;
 
         total_input_length += input_length;
         total_required_pages += num_require_pages;
@@ -169,13 +423,20 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
         if (can_prefill) {
           continue;
         }
+        if (i == 0 && num_running_reserved_pages + num_reserved_pages > 0 &&
+            CanPrefill(estate, num_prefill_rsentries + 1, total_input_length,
+                       total_required_pages - num_running_reserved_pages - num_reserved_pages,
+                       num_available_pages, current_total_seq_len, num_running_rsentries,
+                       kv_state_kind_, sliding_window_enabled)) {
+          // The request fits without the reservation, and is held by it.
+          ++estate->metrics.admission.num_held_admissions;
+        }
         total_input_length -= input_length;
         total_required_pages -= num_require_pages;
 
         // - Attempt 2. Check if the request state entry can partially fit by input chunking.
-        ICHECK_LE(total_input_length, engine_config_->prefill_chunk_size);
-        if (engine_config_->prefill_chunk_size - total_input_length >= input_length ||
-            engine_config_->prefill_chunk_size == total_input_length) {
+        if (prefill_chunk_size - total_input_length >= input_length ||
+            prefill_chunk_size <= total_input_length) {
           // 1. If the input length can fit the remaining prefill chunk size,
           // it means the failure of attempt 1 is not because of the input
           // length being too long, and thus chunking does not help.
@@ -185,7 +446,7 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
           prefill_stops = true;
           break;
         }
-        input_length = engine_config_->prefill_chunk_size - total_input_length;
+        input_length = static_cast<int>(prefill_chunk_size - total_input_length);
         num_require_pages = (input_length + engine_config_->kv_cache_page_size - 1) /
                             engine_config_->kv_cache_page_size;
         if (sliding_window_enabled) {
@@ -193,6 +454,7 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
           num_require_pages = std::min(num_require_pages, num_required_pages_under_sliding_window);
           ICHECK_GE(num_require_pages, 0);
         }
+        num_require_pages += num_reserved_pages;
 
         {
           NVTXScopedRange nvtx_scope("Attempt 2");
@@ -262,6 +524,9 @@ BatchPrefillBaseActionObj::GetRequestStateEntriesToPrefill(EngineState estate) {
     }
   }
 
+  if (engine_config_->waiting_queue_order == WaitingQueueOrder::kFairShare) {
+    AdmitFairShareRequests(estate, prefill_inputs);
+  }
   return prefill_inputs;
 }
 
@@ -294,13 +559,48 @@ bool BatchPrefillBaseActionObj::CanPrefill(EngineState estate, int num_prefill_r
   // Cond 3: number of total tokens after 8 times of decode does not
   // exceed the limit, where 8 is a watermark number can
   // be configured and adjusted in the future.
-  return total_input_length <= engine_config_->prefill_chunk_size &&
+  return total_input_length <= GetPrefillChunkSize(estate) &&
          HasPrefillSpace(num_required_pages, sliding_window_enabled,
                          (num_running_rsentries + num_prefill_rsentries), num_available_pages,
                          current_total_seq_len, total_input_length,
                          engine_config_->max_total_sequence_length);
 }
 
+int BatchPrefillBaseActionObj::GetDecodeReservedPages(const EngineState& estate,
+                                                      const RequestStateEntry& rsentry,
+                                                      int num_outputs) const {
+  if (engine_config_->admission_policy == AdmissionPolicy::kPrompt) {
+    return 0;
+  }
+  const Request& request = rsentry->request;
+  double expected_length =
+      engine_config_->max_single_sequence_length - std::max(request->prompt_tokens, 0);
+  if (request->generation_cfg->max_tokens >= 0) {
+    expected_length =
+        std::min(expected_length, static_cast<double>(request->generation_cfg->max_tokens));
+  }
+  if (engine_config_->admission_policy == AdmissionPolicy::kPredicted) {
+    // Nothing is reserved before any request completes.
+    double predicted_length = estate->output_length_predictor->Predict(request);
+    expected_length = std::min(expected_length, std::max(predicted_length, 0.0));
+  }
+  double num_remaining_tokens =
+      std::max(expected_length - rsentry->mstates[0]->committed_tokens.size(), 0.0) * num_outputs;
+  return static_cast<int>(std::ceil(num_remaining_tokens / engine_config_->kv_cache_page_size /
+                                    engine_config_->admission_overcommit_ratio));
+}
+
+int64_t BatchPrefillBaseActionObj::GetPrefillChunkSize(const EngineState& estate) const {
+  int64_t prefill_chunk_size = estate->prefill_chunk_size_tuner != nullptr
+                                   ? estate->prefill_chunk_size_tuner->GetPrefillChunkSize(
+                                         estate->GetRunningRequestStateEntries().size())
+                                   : engine_config_->prefill_chunk_size;
+  if (estate->prefill_chunk_size_limit > 0) {
+    return std::min(prefill_chunk_size, estate->prefill_chunk_size_limit);
+  }
+  return prefill_chunk_size;
+}
+
 /*!
  * \brief Chunk the input of the given RequestModelState for prefill
  * with regard to the provided maximum allowed prefill length.
@@ -428,6 +728,8 @@ std::vector<Request> BatchPrefillBaseActionObj::RemoveProcessedRequests(
   int num_rsentries = prefill_inputs.size();
   processed_requests.reserve(num_rsentries);
   std::unordered_set<const RequestNode*> dedup_map;
+  // The fully prefilled requests are removed from waiting queue together in the end.
+  std::vector<Request> prefilled_requests;
   for (int i = 0; i < num_rsentries; ++i) {
     const RequestStateEntry& rsentry = prefill_inputs[i].rsentry;
     if (dedup_map.find(rsentry->request.operator->()) != dedup_map.end()) {
@@ -444,16 +746,11 @@ std::vector<Request> BatchPrefillBaseActionObj::RemoveProcessedRequests(
         break;
       }
     }
-    if (!pending_state_exists &&
-        std::find(estate->waiting_queue.begin(), estate->waiting_queue.end(), rsentry->request) !=
-            estate->waiting_queue.end()) {
-      auto it =
-          std::find(estate->waiting_queue.begin(), estate->waiting_queue.end(), rsentry->request);
-      if (it != estate->waiting_queue.end()) {
-        estate->waiting_queue.erase(it);
-      }
+    if (!pending_state_exists) {
+      prefilled_requests.push_back(rsentry->request);
     }
   }
+  RemoveRequestsFromQueue(&estate->waiting_queue, prefilled_requests);
   return processed_requests;
 }
 
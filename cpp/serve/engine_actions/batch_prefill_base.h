@@ -5,6 +5,10 @@
 
 #include <tvm/runtime/nvtx.h>
 
+#include <deque>
+#include <map>
+#include <string>
+
 #include "../config.h"
 #include "../model.h"
 #include "action.h"
@@ -39,6 +43,44 @@ class BatchPrefillBaseActionObj : public EngineActionObj {
    */
   std::vector<PrefillInput> GetRequestStateEntriesToPrefill(EngineState estate);
 
+  /*!
+   * \brief Reorder the waiting queue as per the waiting queue order in engine config.
+   * Under the prefix-aware order, the requests whose prefill has started and the requests waiting
+   * beyond the maximum wait stay at the front in their original order. The other requests are
+   * sorted by their cached prefix length in descending order, and then by their prompt tokens, so
+   * that the requests sharing prefixes are adjacent.
+   * Under the fair-share order, the requests whose prefill has started stay at the front in their
+   * original order. The other requests are split into the queues of their request classes, and
+   * are ordered as the deficit round robin over the class queues would admit them.
+   * \param estate The engine state.
+   */
+  void ReorderWaitingQueue(EngineState estate);
+
+  /*!
+   * \brief Advance the deficit round robin state of the fair-share waiting queue order by the
+   * requests admitted to prefill, and update the metrics of their request classes.
+   * \param estate The engine state.
+   * \param prefill_inputs The prefill inputs of the step.
+   */
+  void AdmitFairShareRequests(EngineState estate, const std::vector<PrefillInput>& prefill_inputs);
+
+  /*!
+   * \brief Return the prefill chunk size of the current step, i.e., the tuned prefill chunk size
+   * or the one in engine config, capped by the limit in engine state.
+   */
+  int64_t GetPrefillChunkSize(const EngineState& estate) const;
+
+  /*!
+   * \brief Return the KV cache pages to reserve for the future decode of the given request state
+   * entry under the admission policy, i.e., the pages of the tokens it is expected to generate
+   * beyond its committed tokens, divided by the overcommit ratio.
+   * \param estate The engine state.
+   * \param rsentry The request state entry.
+   * \param num_outputs The number of outputs generated from the entry.
+   */
+  int GetDecodeReservedPages(const EngineState& estate, const RequestStateEntry& rsentry,
+                             int num_outputs) const;
+
   /*! \brief Check if the input requests can be prefilled under conditions. */
   bool CanPrefill(EngineState estate, int num_prefill_rsentries, int total_input_length,
                   int num_required_pages, int num_available_pages, int current_total_seq_len,
@@ -131,6 +173,12 @@ class BatchPrefillBaseActionObj : public EngineActionObj {
   std::vector<int> sliding_window_sizes_;
   /*! \brief Event trace recorder. */
   Optional<EventTraceRecorder> trace_recorder_;
+  /*!
+   * \brief The queues of the waiting requests of each request class, together with their prompt
+   * lengths, under the fair-share waiting queue order. They are refilled from the waiting queue in
+   * each step, and walk the deficit round robin without being copied or popped.
+   */
+  std::map<std::string, std::deque<std::pair<Request, int64_t>>> fair_share_queues_;
 };
 
 /*!
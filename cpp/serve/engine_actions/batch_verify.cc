@@ -5,6 +5,7 @@
 
 #include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <numeric>
@@ -316,14 +317,16 @@ class BatchVerifyActionObj : public EngineActionObj {
     }
     while (!CanVerify(total_required_pages)) {
       if (estate->prefix_cache->TryFreeMemory()) continue;
-      RequestStateEntry preempted = PreemptLastRunningRequestStateEntry(
+      RequestStateEntry preempted = PreemptRunningRequestStateEntry(
           estate, models_, draft_token_workspace_manager_, trace_recorder_);
-      if (preempted.same_as(running_rsentries.back())) {
-        total_verify_length -= verify_lengths.back();
-        total_required_pages -= num_page_requirement.back();
-        verify_lengths.pop_back();
-        num_page_requirement.pop_back();
-        running_rsentries.pop_back();
+      auto it = std::find(running_rsentries.begin(), running_rsentries.end(), preempted);
+      if (it != running_rsentries.end()) {
+        int idx = it - running_rsentries.begin();
+        total_verify_length -= verify_lengths[idx];
+        total_required_pages -= num_page_requirement[idx];
+        verify_lengths.erase(verify_lengths.begin() + idx);
+        num_page_requirement.erase(num_page_requirement.begin() + idx);
+        running_rsentries.erase(it);
       }
     }
     CHECK_LE(total_verify_length, std::min(static_cast<int64_t>(engine_config_->max_num_sequence),
@@ -3,6 +3,7 @@
  * \file serve/engine_actions/eagle_batch_draft.cc
  */
 
+#include <algorithm>
 #include <numeric>
 
 #include "../config.h"
@@ -45,10 +46,11 @@ class EagleBatchDraftActionObj : public EngineActionObj {
     std::vector<RequestStateEntry> running_rsentries = estate->GetRunningRequestStateEntries();
     while (!CanDecode(running_rsentries.size())) {
       if (estate->prefix_cache->TryFreeMemory()) continue;
-      RequestStateEntry preempted = PreemptLastRunningRequestStateEntry(
+      RequestStateEntry preempted = PreemptRunningRequestStateEntry(
           estate, models_, draft_token_workspace_manager_, trace_recorder_);
-      if (preempted.same_as(running_rsentries.back())) {
-        running_rsentries.pop_back();
+      auto it = std::find(running_rsentries.begin(), running_rsentries.end(), preempted);
+      if (it != running_rsentries.end()) {
+        running_rsentries.erase(it);
       }
     }
 
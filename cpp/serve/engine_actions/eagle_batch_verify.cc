@@ -5,6 +5,7 @@
 
 #include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <numeric>
@@ -380,14 +381,16 @@ class EagleBatchVerifyActionObj : public EngineActionObj {
     }
     while (!CanVerify(total_required_pages)) {
       if (estate->prefix_cache->TryFreeMemory()) continue;
-      RequestStateEntry preempted = PreemptLastRunningRequestStateEntry(
+      RequestStateEntry preempted = PreemptRunningRequestStateEntry(
           estate, models_, draft_token_workspace_manager_, trace_recorder_);
-      if (preempted.same_as(running_rsentries.back())) {
-        total_draft_length -= draft_lengths.back();
-        total_required_pages -= num_page_requirement.back();
-        draft_lengths.pop_back();
-        num_page_requirement.pop_back();
-        running_rsentries.pop_back();
+      auto it = std::find(running_rsentries.begin(), running_rsentries.end(), preempted);
+      if (it != running_rsentries.end()) {
+        int idx = it - running_rsentries.begin();
+        total_draft_length -= draft_lengths[idx];
+        total_required_pages -= num_page_requirement[idx];
+        draft_lengths.erase(draft_lengths.begin() + idx);
+        num_page_requirement.erase(num_page_requirement.begin() + idx);
+        running_rsentries.erase(it);
       }
     }
 
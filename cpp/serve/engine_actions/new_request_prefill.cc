@@ -3,6 +3,8 @@
  * \file serve/engine_actions/new_request_prefill.cc
  */
 
+#include <numeric>
+
 #include "../sampler/sampler.h"
 #include "batch_prefill_base.h"
 
@@ -252,7 +254,13 @@ class NewRequestPrefillActionObj : public BatchPrefillBaseActionObj {
                                                sample_results);
 
     auto tend = std::chrono::high_resolution_clock::now();
-    estate->metrics.engine_prefill_time_sum += static_cast<double>((tend - tstart).count()) / 1e9;
+    double elapsed_time = static_cast<double>((tend - tstart).count()) / 1e9;
+    estate->metrics.engine_prefill_time_sum += elapsed_time;
+    if (estate->prefill_chunk_size_tuner != nullptr) {
+      estate->prefill_chunk_size_tuner->Update(
+          std::accumulate(prefill_lengths.begin(), prefill_lengths.end(), int64_t{0}),
+          elapsed_time);
+    }
 
     std::vector<Request> processed_requests =
         RemoveProcessedRequests(prefill_inputs, estate, rstates_of_entries);
@@ -289,9 +297,11 @@ class NewRequestPrefillActionObj : public BatchPrefillBaseActionObj {
         // and return.
         return 0;
       }
+      const DebugConfig& debug_config = rsentry->request->generation_cfg->debug_config;
       PrefixCacheMatchedResult result = estate->prefix_cache->InsertSequence(
           rsentry->mstates[0]->internal_id, tokens, models_[0]->GetSlidingWindowSize(),
-          models_[0]->GetAttentionSinkSize());
+          models_[0]->GetAttentionSinkSize(), debug_config.prefix_cache_tenant,
+          debug_config.share_prefix_across_tenants);
 
       if (result.prefilled_offset == 0) {
         // Add new sequence
@@ -3,6 +3,8 @@
  * \file serve/engine_actions/new_request_prefill.cc
  */
 
+#include <numeric>
+
 #include "../sampler/sampler.h"
 #include "batch_prefill_base.h"
 
@@ -159,7 +161,13 @@ class NewRequestPrefillWithKVSendActionObj : public BatchPrefillBaseActionObj {
     TVMSynchronize(device_.device_type, device_.device_id, compute_stream_);
 
     auto tend = std::chrono::high_resolution_clock::now();
-    estate->metrics.engine_prefill_time_sum += static_cast<double>((tend - tstart).count()) / 1e9;
+    double elapsed_time = static_cast<double>((tend - tstart).count()) / 1e9;
+    estate->metrics.engine_prefill_time_sum += elapsed_time;
+    if (estate->prefill_chunk_size_tuner != nullptr) {
+      estate->prefill_chunk_size_tuner->Update(
+          std::accumulate(prefill_lengths.begin(), prefill_lengths.end(), int64_t{0}),
+          elapsed_time);
+    }
 
     std::vector<Request> processed_requests =
         RemoveProcessedRequests(prefill_inputs, estate, rstates_of_entries);
@@ -201,6 +209,7 @@ class NewRequestPrefillWithKVSendActionObj : public BatchPrefillBaseActionObj {
     prefill_inputs_for_all_models.reserve(models_.size());
 
     int num_running_rsentries = static_cast<int>(running_rsentries->size());
+    int64_t prefill_chunk_size = GetPrefillChunkSize(estate);
     // We first collect the inputs that can be prefilled for each model.
     // Then we make a reduction to return the maximum common inputs.
     for (int i = 0; i < static_cast<int>(models_.size()); ++i) {
@@ -291,9 +300,9 @@ class NewRequestPrefillWithKVSendActionObj : public BatchPrefillBaseActionObj {
         total_required_pages -= num_require_pages;
 
         // - Attempt 2. Check if the request state entry can partially fit by input chunking.
-        ICHECK_LE(total_input_length, engine_config_->prefill_chunk_size);
-        if (engine_config_->prefill_chunk_size - total_input_length >= input_length ||
-            engine_config_->prefill_chunk_size == total_input_length) {
+        ICHECK_LE(total_input_length, prefill_chunk_size);
+        if (prefill_chunk_size - total_input_length >= input_length ||
+            prefill_chunk_size == total_input_length) {
           // 1. If the input length can fit the remaining prefill chunk size,
           // it means the failure of attempt 1 is not because of the input
           // length being too long, and thus chunking does not help.
@@ -302,7 +311,7 @@ class NewRequestPrefillWithKVSendActionObj : public BatchPrefillBaseActionObj {
           // So we can safely return in either case.
           break;
         }
-        input_length = engine_config_->prefill_chunk_size - total_input_length;
+        input_length = static_cast<int>(prefill_chunk_size - total_input_length);
         num_require_pages = (input_length + engine_config_->kv_cache_page_size - 1) /
                             engine_config_->kv_cache_page_size;
         if (sliding_window_enabled) {
@@ -392,9 +401,11 @@ class NewRequestPrefillWithKVSendActionObj : public BatchPrefillBaseActionObj {
         // and return.
         return 0;
       }
+      const DebugConfig& debug_config = rsentry->request->generation_cfg->debug_config;
       PrefixCacheMatchedResult result = estate->prefix_cache->InsertSequence(
           rsentry->mstates[0]->internal_id, tokens, models_[0]->GetSlidingWindowSize(),
-          models_[0]->GetAttentionSinkSize());
+          models_[0]->GetAttentionSinkSize(), debug_config.prefix_cache_tenant,
+          debug_config.share_prefix_across_tenants);
 
       if (result.prefilled_offset == 0) {
         // Add new sequence
@@ -362,9 +362,11 @@ class DisaggPreparePrefillActionObj : public BatchPrefillBaseActionObj {
         // and return.
         return 0;
       }
+      const DebugConfig& debug_config = rsentry->request->generation_cfg->debug_config;
       PrefixCacheMatchedResult result = estate->prefix_cache->InsertSequence(
           rsentry->mstates[0]->internal_id, tokens, models_[0]->GetSlidingWindowSize(),
-          models_[0]->GetAttentionSinkSize());
+          models_[0]->GetAttentionSinkSize(), debug_config.prefix_cache_tenant,
+          debug_config.share_prefix_across_tenants);
 
       if (result.prefilled_offset == 0) {
         // Add new sequence
@@ -0,0 +1,173 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/engine_actions/slo_aware_schedule.cc
+ */
+
+#include <tvm/runtime/nvtx.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "../config.h"
+#include "action.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief The action that decides whether to prefill or decode in each step by the TTFT and TPOT
+ * targets of requests, with the step time estimated from the measured batch decode time and the
+ * prefill time per token.
+ * - When prefill fits in the tightest TPOT slack of running requests, it prefills with the prefill
+ * chunk size capped to the slack, so that no running request misses its TPOT target.
+ * - Otherwise, it prefills only when more waiting requests would miss their TTFT targets by
+ * waiting for a decode step than running requests would miss their TPOT targets by the prefill.
+ * Without waiting or running requests, or before any prefill is measured, it falls back to the
+ * greedy order of prefill and decode.
+ */
+class SLOAwareScheduleActionObj : public EngineActionObj {
+ public:
+  explicit SLOAwareScheduleActionObj(EngineAction prefill_action,
+                                     Array<EngineAction> decode_actions,
+                                     EngineConfig engine_config)
+      : prefill_action_(std::move(prefill_action)),
+        decode_actions_(std::move(decode_actions)),
+        engine_config_(std::move(engine_config)) {}
+
+  Array<Request> Step(EngineState estate) final {
+    bool prefill_first = !estate->waiting_queue.empty() &&
+                         (estate->GetRunningRequestStateEntries().empty() || PrefillFirst(estate));
+    if (!prefill_first) {
+      Array<Request> processed_requests = Decode(estate);
+      if (!processed_requests.empty()) {
+        return processed_requests;
+      }
+    }
+    Array<Request> processed_requests = prefill_action_->Step(estate);
+    // Reset the prefill chunk size limit.
+    estate->prefill_chunk_size_limit = 0;
+    if (processed_requests.empty()) {
+      processed_requests = Decode(estate);
+    }
+    return processed_requests;
+  }
+
+ private:
+  /*! \brief Run the decode actions, and return the requests processed by the first one. */
+  Array<Request> Decode(EngineState estate) {
+    for (EngineAction action : decode_actions_) {
+      Array<Request> processed_requests = action->Step(estate);
+      if (!processed_requests.empty()) {
+        return processed_requests;
+      }
+    }
+    return {};
+  }
+
+  /*!
+   * \brief Decide whether to prefill ahead of decode in this step, and set the prefill chunk size
+   * limit in engine state for the prefill.
+   */
+  bool PrefillFirst(EngineState estate) {
+    NVTXScopedRange nvtx_scope("SLO-aware schedule");
+    auto now = std::chrono::high_resolution_clock::now();
+    auto f_seconds_since = [&now](std::chrono::high_resolution_clock::time_point time_point) {
+      return static_cast<double>((now - time_point).count()) / 1e9;
+    };
+    const std::vector<RequestStateEntry>& running_rsentries =
+        estate->GetRunningRequestStateEntries();
+    double decode_time =
+        estate->metrics.EstimateDecodeTime(static_cast<int>(running_rsentries.size()));
+    double prefill_time_per_token = estate->metrics.GetPrefillTimePerToken();
+    if (prefill_time_per_token == 0.0) {
+      // Nothing is measured yet, so prefill greedily.
+      return true;
+    }
+
+    // - Collect the TPOT slack of running requests, i.e., the time left for prefill before they
+    // miss their TPOT targets. The requests already missing their targets are not counted.
+    std::vector<double> tpot_slacks;
+    for (const RequestStateEntry& rsentry : running_rsentries) {
+      int64_t tpot_slo_ms = rsentry->request->generation_cfg->tpot_slo_ms;
+      if (tpot_slo_ms == -1) {
+        continue;
+      }
+      double slack = tpot_slo_ms / 1e3 - decode_time -
+                     f_seconds_since(rsentry->rstate->metrics.last_token_time_point);
+      if (slack > 0) {
+        tpot_slacks.push_back(slack);
+      }
+    }
+    if (tpot_slacks.empty()) {
+      return true;
+    }
+    std::sort(tpot_slacks.begin(), tpot_slacks.end());
+
+    // The hybrid prefill processes the decode inputs together, which count in the chunk size.
+    int64_t num_decode_tokens = 0;
+    if (engine_config_->prefill_mode == PrefillMode::kHybrid) {
+      for (const RequestStateEntry& rsentry : running_rsentries) {
+        num_decode_tokens += rsentry->mstates[0]->num_tokens_for_next_decode;
+      }
+    }
+
+    // - Prefill without hurting any running request when the slack fits a chunk of a page.
+    int64_t max_prefill_tokens = static_cast<int64_t>(tpot_slacks[0] / prefill_time_per_token);
+    if (max_prefill_tokens >= engine_config_->kv_cache_page_size) {
+      estate->prefill_chunk_size_limit = max_prefill_tokens + num_decode_tokens;
+      return true;
+    }
+
+    // - Otherwise, trade the TPOT of running requests off against the TTFT of waiting requests.
+    // Prefill a page of tokens for every waiting request which otherwise misses its TTFT target.
+    int num_ttft_misses = 0;
+    for (const Request& request : estate->waiting_queue) {
+      RequestState rstate = estate->GetRequestState(request);
+      if (request->generation_cfg->ttft_slo_ms == -1 ||
+          rstate->metrics.prefill_end_time_point.time_since_epoch().count() != 0) {
+        // The request has no TTFT target, or has output its first token before preemption.
+        continue;
+      }
+      double prefill_time =
+          rstate->entries[0]->mstates[0]->GetInputLength() * prefill_time_per_token;
+      double slack = request->generation_cfg->ttft_slo_ms / 1e3 - prefill_time -
+                     f_seconds_since(rstate->metrics.add_time_point);
+      if (slack > 0 && slack <= decode_time) {
+        ++num_ttft_misses;
+      }
+    }
+    if (num_ttft_misses == 0) {
+      return false;
+    }
+    double prefill_time =
+        num_ttft_misses * engine_config_->kv_cache_page_size * prefill_time_per_token;
+    int num_tpot_misses = static_cast<int>(
+        std::lower_bound(tpot_slacks.begin(), tpot_slacks.end(), prefill_time) -
+        tpot_slacks.begin());
+    if (num_ttft_misses <= num_tpot_misses) {
+      return false;
+    }
+    estate->prefill_chunk_size_limit =
+        num_ttft_misses * engine_config_->kv_cache_page_size + num_decode_tokens;
+    return true;
+  }
+
+  /*! \brief The prefill action. */
+  EngineAction prefill_action_;
+  /*! \brief The decode actions, run in order until one processes requests. */
+  Array<EngineAction> decode_actions_;
+  /*! \brief The engine config. */
+  EngineConfig engine_config_;
+};
+
+EngineAction EngineAction::SLOAwareSchedule(EngineAction prefill_action,
+                                            std::vector<EngineAction> decode_actions,
+                                            EngineConfig engine_config) {
+  return EngineAction(make_object<SLOAwareScheduleActionObj>(
+      std::move(prefill_action), Array<EngineAction>(decode_actions), std::move(engine_config)));
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
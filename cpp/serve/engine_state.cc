@@ -4,6 +4,8 @@
  */
 #include "engine_state.h"
 
+#include <numeric>
+
 namespace mlc {
 namespace llm {
 namespace serve {
@@ -21,8 +23,19 @@ void EngineStateObj::Reset() {
   if (prefix_cache.defined()) {
     prefix_cache->Reset();
   }
+  if (prefill_chunk_size_tuner != nullptr) {
+    prefill_chunk_size_tuner->Reset();
+  }
+  if (output_length_predictor != nullptr) {
+    output_length_predictor->Reset();
+  }
+  fair_share = FairShareState();
   running_rsentries_changed = true;
+  cached_decode_batch_ = DecodeBatch();
+  decode_batch_changed_ = true;
   postproc_workspace = ActionPostProcessWorkspace();
+  deferred_postproc = nullptr;
+  inflight_decode_seq_ids.clear();
 }
 
 RequestState EngineStateObj::GetRequestState(Request request) {
@@ -44,11 +57,52 @@ const std::vector<RequestStateEntry>& EngineStateObj::GetRunningRequestStateEntr
       }
     }
     running_rsentries_changed = false;
+    decode_batch_changed_ = true;
   }
   return cached_running_rsentries_;
   //
 }
 
+DecodeBatch& EngineStateObj::GetDecodeBatch() {
+  const std::vector<RequestStateEntry>& running_rsentries = GetRunningRequestStateEntries();
+  if (decode_batch_changed_) {
+    cached_decode_batch_.Build(running_rsentries);
+    decode_batch_changed_ = false;
+  }
+  return cached_decode_batch_;
+}
+
+void EngineStateObj::RunDeferredPostProcess() {
+  if (deferred_postproc != nullptr) {
+    // Clear the post-process before running it, so that it runs only once.
+    std::function<void()> postproc = std::move(deferred_postproc);
+    deferred_postproc = nullptr;
+    postproc();
+  }
+}
+
+void DecodeBatch::Build(const std::vector<RequestStateEntry>& rsentries) {
+  request_ids.clear();
+  request_internal_ids.clear();
+  mstates.clear();
+  generation_cfg.clear();
+  rngs.clear();
+  request_ids.reserve(rsentries.size());
+  request_internal_ids.reserve(rsentries.size());
+  mstates.reserve(rsentries.size());
+  generation_cfg.reserve(rsentries.size());
+  rngs.reserve(rsentries.size());
+  sample_indices.resize(rsentries.size());
+  std::iota(sample_indices.begin(), sample_indices.end(), 0);
+  for (const RequestStateEntry& rsentry : rsentries) {
+    request_ids.push_back(rsentry->request->id);
+    request_internal_ids.push_back(rsentry->mstates[0]->internal_id);
+    mstates.push_back(rsentry->mstates[0]);
+    generation_cfg.push_back(rsentry->request->generation_cfg);
+    rngs.push_back(&rsentry->rng);
+  }
+}
+
 }  // namespace serve
 }  // namespace llm
 }  // namespace mlc
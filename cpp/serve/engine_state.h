@@ -8,8 +8,14 @@
 #include <picojson.h>
 #include <tvm/runtime/container/string.h>
 
+#include <functional>
+#include <unordered_set>
+
 #include "config.h"
 #include "metrics.h"
+#include "output_length_predictor.h"
+#include "preemption_victim_selector.h"
+#include "prefill_chunk_size_tuner.h"
 #include "prefix_cache.h"
 #include "request.h"
 #include "request_state.h"
@@ -48,6 +54,46 @@ struct EngineInternalIDManager {
   }
 };
 
+/*!
+ * \brief The deficit round robin state of the fair-share waiting queue order. The request classes
+ * with waiting requests take turns in the order of their names. At the start of its turn, a class
+ * gains the quantum of tokens times its weight in deficit, and its waiting requests are admitted
+ * while their prompt lengths fit in the deficit.
+ */
+struct FairShareState {
+  /*! \brief The deficit in tokens of each request class with waiting requests. */
+  std::unordered_map<std::string, int64_t> deficits;
+  /*! \brief The request class of the current turn. */
+  std::string current_class;
+  /*! \brief Whether the class of the current turn has gained its quantum. */
+  bool quantum_granted = false;
+};
+
+/*!
+ * \brief The struct-of-arrays descriptor of the decode batch, i.e., the request ids, internal ids,
+ * model states, generation configs, random number generators and sample indices of the running
+ * request state entries in order. It is rebuilt only when the running request state entries change on admission,
+ * finish or preemption, so that decode steps reuse it without per-request allocation.
+ */
+struct DecodeBatch {
+  Array<String> request_ids;
+  std::vector<int64_t> request_internal_ids;
+  Array<RequestModelState> mstates;
+  Array<GenerationConfig> generation_cfg;
+  std::vector<RandomGenerator*> rngs;
+  /*! \brief The range [0, batch size), as every entry samples one token from its own logits. */
+  std::vector<int> sample_indices;
+  /*!
+   * \brief The input tokens and the input lengths of each entry, which are collected in every
+   * decode step. They are kept here to reuse the allocated memory.
+   */
+  std::vector<int> input_tokens;
+  std::vector<int> lengths;
+
+  /*! \brief Rebuild the descriptor from the given request state entries. */
+  void Build(const std::vector<RequestStateEntry>& rsentries);
+};
+
 /*! \brief The data structures used in the action post-process. */
 struct ActionPostProcessWorkspace {
   std::vector<RequestStateEntry> finished_rsentries;
@@ -72,6 +118,18 @@ class EngineStateObj : public Object {
   EngineMetrics metrics;
   /*! \brief The prefix cache. */
   PrefixCache prefix_cache{nullptr};
+  /*! \brief The selector of the running request to preempt, as per the preemption policy. */
+  std::unique_ptr<PreemptionVictimSelector> preemption_victim_selector;
+  /*!
+   * \brief The online tuner of the prefill chunk size, or nullptr when the chunk size is the
+   * static one in engine config.
+   */
+  std::unique_ptr<PrefillChunkSizeTuner> prefill_chunk_size_tuner;
+  /*!
+   * \brief The predictor of the output length of requests for the admission reservation, or
+   * nullptr when the admission policy does not predict.
+   */
+  std::unique_ptr<OutputLengthPredictor> output_length_predictor;
   /*! \brief A boolean flag denoting whether the running request state entry list has changed. */
   bool running_rsentries_changed = true;
   /*!
@@ -81,6 +139,13 @@ class EngineStateObj : public Object {
    * properly work.
    */
   int spec_draft_length = 0;
+  /*!
+   * \brief The limit of the prefill chunk size of the current engine step, which is set by the
+   * scheduler to bound the step latency. Value 0 means no limit beyond the engine config.
+   */
+  int64_t prefill_chunk_size_limit = 0;
+  /*! \brief The deficit round robin state of the fair-share waiting queue order. */
+  FairShareState fair_share;
   /*! \brief A boolean flag denoting whether the engine is in disaggregation mode. */
   bool disaggregation = false;
   // Request stream callback function
@@ -90,6 +155,16 @@ class EngineStateObj : public Object {
    * We make it a workspace to avoid repetitive memory allocation/free in the action post process.
    */
   ActionPostProcessWorkspace postproc_workspace;
+  /*!
+   * \brief The post-process of the last engine step deferred to overlap with the device execution
+   * of the next decode step, or nullptr when there is none.
+   */
+  std::function<void()> deferred_postproc;
+  /*!
+   * \brief The internal ids of the sequences whose decode runs on device while the deferred
+   * post-process runs. The KV cache of them holds one token more than the prefix cache knows.
+   */
+  std::unordered_set<int64_t> inflight_decode_seq_ids;
 
   /*! \brief Reset the engine state and clear the metrics. */
   void Reset();
@@ -97,6 +172,10 @@ class EngineStateObj : public Object {
   RequestState GetRequestState(Request request);
   /*! \brief Return the running request state entries*/
   const std::vector<RequestStateEntry>& GetRunningRequestStateEntries();
+  /*! \brief Return the decode batch descriptor of the running request state entries. */
+  DecodeBatch& GetDecodeBatch();
+  /*! \brief Run the deferred post-process of the last engine step, if any. */
+  void RunDeferredPostProcess();
 
   static constexpr const char* _type_key = "mlc.serve.EngineState";
   static constexpr const bool _type_has_method_sequal_reduce = false;
@@ -105,6 +184,9 @@ class EngineStateObj : public Object {
 
  private:
   std::vector<RequestStateEntry> cached_running_rsentries_;
+  DecodeBatch cached_decode_batch_;
+  /*! \brief Whether the decode batch is out of date with the running request state entries. */
+  bool decode_batch_changed_ = true;
 };
 
 /*!
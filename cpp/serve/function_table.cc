@@ -267,9 +267,12 @@ void FunctionTable::_InitFunctions() {
     gpu_multinomial_from_uniform_func_ = mod->GetFunction("multinomial_from_uniform", true);
     gpu_argsort_probs_func_ = mod->GetFunction("argsort_probs", true);
     gpu_sample_with_top_p_func_ = mod->GetFunction("sample_with_top_p", true);
+    gpu_sample_with_top_k_top_p_func_ = mod->GetFunction("sample_with_top_k_top_p", true);
     gpu_sampler_take_probs_func_ = mod->GetFunction("sampler_take_probs", true);
     gpu_verify_draft_tokens_func_ = mod->GetFunction("sampler_verify_draft_tokens", true);
     gpu_renormalize_by_top_p_func_ = mod->GetFunction("renormalize_by_top_p", true);
+    gpu_renormalize_by_top_k_top_p_func_ = mod->GetFunction("renormalize_by_top_k_top_p", true);
+    gpu_sample_deterministic_func_ = mod->GetFunction("sample_deterministic", true);
   }
   this->nd_view_func_ = get_global_func("vm.builtin.reshape");
   this->nd_get_shape_func_ = get_global_func("vm.builtin.shape_of");
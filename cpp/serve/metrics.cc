@@ -72,6 +72,73 @@ picojson::object SpecDecodeMetrics::AsJSON() const {
   return metrics;
 }
 
+picojson::object PrefixCacheMetrics::AsJSON() const {
+  picojson::object metrics;
+  metrics["prompt_tokens_sum"] = picojson::value(prompt_tokens_sum);
+  metrics["matched_tokens_sum"] = picojson::value(matched_tokens_sum);
+  if (prompt_tokens_sum != 0) {
+    metrics["token_hit_rate"] = picojson::value(static_cast<double>(matched_tokens_sum) /
+                                                static_cast<double>(prompt_tokens_sum));
+  }
+  metrics["num_reuses"] = picojson::value(num_reuses);
+  metrics["num_forks"] = picojson::value(num_forks);
+  metrics["num_misses"] = picojson::value(num_misses);
+  metrics["num_evictions"] = picojson::value(num_evictions);
+  metrics["num_trims"] = picojson::value(num_trims);
+  metrics["reclaimed_tokens_sum"] = picojson::value(reclaimed_tokens_sum);
+  metrics["reclaimed_kv_bytes_sum"] =
+      picojson::value(static_cast<double>(reclaimed_tokens_sum) * kv_bytes_per_token);
+
+  // NOTE: label follows prometheus histogram with cumulative buckets
+  picojson::object histogram;
+  int64_t cumulative_count = 0;
+  for (size_t i = 0; i < matched_length_histogram.size(); ++i) {
+    cumulative_count += matched_length_histogram[i];
+    std::ostringstream label;
+    label << "count{le=" << (int64_t{1} << i >> 1) << "}";
+    histogram[label.str()] = picojson::value(cumulative_count);
+  }
+  metrics["matched_length_histogram"] = picojson::value(histogram);
+  return metrics;
+}
+
+picojson::object PreemptionMetrics::AsJSON() const {
+  picojson::object metrics;
+  metrics["num_preemptions"] = picojson::value(num_preemptions);
+  metrics["recompute_tokens_sum"] = picojson::value(recompute_tokens_sum);
+  return metrics;
+}
+
+picojson::object AdmissionMetrics::AsJSON() const {
+  picojson::object metrics;
+  metrics["reserved_pages"] = picojson::value(reserved_pages);
+  metrics["num_held_admissions"] = picojson::value(num_held_admissions);
+  metrics["num_predictions"] = picojson::value(num_predictions);
+  metrics["mean_prediction_error"] =
+      picojson::value(num_predictions != 0 ? prediction_error_sum / num_predictions : 0.0);
+  return metrics;
+}
+
+picojson::object PrefillChunkMetrics::AsJSON() const {
+  picojson::object metrics;
+  metrics["prefill_chunk_size"] = picojson::value(prefill_chunk_size);
+  metrics["step_time_intercept"] = picojson::value(step_time_intercept);
+  metrics["step_time_per_token"] = picojson::value(step_time_per_token);
+  metrics["num_updates"] = picojson::value(num_updates);
+  return metrics;
+}
+
+picojson::object RequestClassMetrics::AsJSON() const {
+  picojson::object metrics;
+  metrics["queue_depth"] = picojson::value(queue_depth);
+  metrics["num_admitted"] = picojson::value(num_admitted);
+  metrics["wait_time_sum"] = picojson::value(wait_time_sum);
+  metrics["mean_wait_time"] =
+      picojson::value(num_admitted != 0 ? wait_time_sum / num_admitted : 0.0);
+  metrics["max_wait_time"] = picojson::value(max_wait_time);
+  return metrics;
+}
+
 picojson::object RequestMetrics::AsJSON() const {
   picojson::object metrics;
   metrics["prompt_tokens"] = picojson::value(prompt_tokens);
@@ -125,6 +192,25 @@ picojson::object EngineMetrics::AsJSON() const {
   if (!spec_decode.IsEmpty()) {
     metrics["spec_decode"] = picojson::value(spec_decode.AsJSON());
   }
+  if (!prefix_cache.IsEmpty()) {
+    metrics["prefix_cache"] = picojson::value(prefix_cache.AsJSON());
+  }
+  if (!preemption.IsEmpty()) {
+    metrics["preemption"] = picojson::value(preemption.AsJSON());
+  }
+  if (!admission.IsEmpty()) {
+    metrics["admission"] = picojson::value(admission.AsJSON());
+  }
+  if (!prefill_chunk.IsEmpty()) {
+    metrics["prefill_chunk"] = picojson::value(prefill_chunk.AsJSON());
+  }
+  if (!request_classes.empty()) {
+    picojson::object request_classes_json;
+    for (const auto& [request_class, class_metrics] : request_classes) {
+      request_classes_json[request_class] = picojson::value(class_metrics.AsJSON());
+    }
+    metrics["request_classes"] = picojson::value(request_classes_json);
+  }
 
   auto f_create_time_list = [](const std::vector<TimeCost>& time_list) {
     picojson::object result;
@@ -149,6 +235,23 @@ picojson::object EngineMetrics::AsJSON() const {
   return metrics;
 }
 
+double EngineMetrics::EstimateDecodeTime(int batch_size) const {
+  int num_tracked = static_cast<int>(decode_time_by_batch_size.size());
+  // The batch sizes beyond the tracking range are not recorded, so search from the largest one.
+  batch_size = std::min(batch_size, num_tracked - 1);
+  // Search the tracked batch sizes outwards from the given one, preferring the larger ones.
+  for (int distance = 0; distance < num_tracked; ++distance) {
+    for (int candidate : {batch_size + distance, batch_size - distance}) {
+      if (candidate > 0 && candidate < num_tracked &&
+          decode_time_by_batch_size[candidate].count != 0) {
+        const TimeCost& item = decode_time_by_batch_size[candidate];
+        return item.sum / item.count;
+      }
+    }
+  }
+  return 0.0;
+}
+
 std::string EngineMetrics::AsUsageJSONStr() const {
   picojson::object usage;
   // We return engine usage as a usage field according to the OpenAI API.
@@ -172,6 +275,11 @@ void EngineMetrics::Reset() {
   jump_forward_tokens_sum = 0;
   last_finished_request.Reset();
   spec_decode.Reset();
+  prefix_cache.Reset();
+  preemption.Reset();
+  admission.Reset();
+  prefill_chunk.Reset();
+  request_classes.clear();
   decode_time_by_batch_size.clear();
   draft_time_by_batch_size.clear();
   verify_time_by_batch_size.clear();
@@ -9,8 +9,11 @@
 #include <picojson.h>
 #include <tvm/runtime/logging.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <string>
+#include <unordered_map>
 
 namespace mlc {
 namespace llm {
@@ -91,6 +94,187 @@ struct SpecDecodeMetrics {
   picojson::object AsJSON() const;
 };
 
+/*! \brief Prefix cache metrics, updated by the prefix cache. */
+struct PrefixCacheMetrics {
+  /*! \brief The total number of prompt tokens looked up in prefix cache. */
+  int64_t prompt_tokens_sum = 0;
+  /*! \brief The total number of prompt tokens matched in prefix cache, which skip prefill. */
+  int64_t matched_tokens_sum = 0;
+  /*! \brief The number of lookups reusing a recycling sequence. */
+  int64_t num_reuses = 0;
+  /*! \brief The number of lookups forking from a sequence in prefix cache. */
+  int64_t num_forks = 0;
+  /*! \brief The number of lookups matching no prefix to leverage. */
+  int64_t num_misses = 0;
+  /*! \brief The number of recycling sequences removed from prefix cache. */
+  int64_t num_evictions = 0;
+  /*! \brief The number of recycling sequences trimmed by cold trailing tokens. */
+  int64_t num_trims = 0;
+  /*! \brief The total number of tokens whose KV data is released by eviction and trimming. */
+  int64_t reclaimed_tokens_sum = 0;
+  /*!
+   * \brief The KV cache bytes per token of all models, to convert reclaimed tokens to bytes.
+   * It is set on engine creation and kept across reset.
+   */
+  double kv_bytes_per_token = 0;
+  /*!
+   * \brief The histogram of matched prefix lengths. The bucket 0 counts the lookups matching
+   * nothing, and the bucket i > 0 counts the matched lengths in (2^(i-2), 2^(i-1)].
+   */
+  std::vector<int64_t> matched_length_histogram;
+
+  /*!
+   * \brief Update the metrics with a prefix cache lookup.
+   * \param prompt_length The number of prompt tokens.
+   * \param matched_length The number of matched tokens.
+   * \param reused Whether a recycling sequence is reused.
+   * \param forked Whether a sequence is forked from.
+   */
+  void UpdateLookup(int64_t prompt_length, int64_t matched_length, bool reused, bool forked) {
+    prompt_tokens_sum += prompt_length;
+    matched_tokens_sum += matched_length;
+    if (reused) {
+      ++num_reuses;
+    } else if (forked) {
+      ++num_forks;
+    } else {
+      ++num_misses;
+    }
+    size_t bucket = 0;
+    while (matched_length > (int64_t{1} << bucket >> 1)) {
+      ++bucket;
+    }
+    if (matched_length_histogram.size() <= bucket) {
+      matched_length_histogram.resize(bucket + 1, 0);
+    }
+    ++matched_length_histogram[bucket];
+  }
+
+  /*! \brief Update the metrics with a sequence eviction releasing the given number of tokens. */
+  void UpdateEviction(int64_t num_reclaimed_tokens) {
+    ++num_evictions;
+    reclaimed_tokens_sum += num_reclaimed_tokens;
+  }
+
+  /*! \brief Update the metrics with a sequence trimming releasing the given number of tokens. */
+  void UpdateTrim(int64_t num_reclaimed_tokens) {
+    ++num_trims;
+    reclaimed_tokens_sum += num_reclaimed_tokens;
+  }
+
+  /*! \brief Return whether there is no lookup or eviction. */
+  bool IsEmpty() const { return num_reuses + num_forks + num_misses + num_evictions == 0; }
+
+  /*! \brief Reset the metrics, except the KV cache bytes per token. */
+  void Reset() {
+    prompt_tokens_sum = 0;
+    matched_tokens_sum = 0;
+    num_reuses = 0;
+    num_forks = 0;
+    num_misses = 0;
+    num_evictions = 0;
+    num_trims = 0;
+    reclaimed_tokens_sum = 0;
+    matched_length_histogram.clear();
+  }
+
+  picojson::object AsJSON() const;
+};
+
+/*! \brief Metrics of request preemption, whose KV data is discarded and prefilled again. */
+struct PreemptionMetrics {
+  /*! \brief The number of preempted requests. */
+  int64_t num_preemptions = 0;
+  /*! \brief The total number of tokens to prefill again for the preempted requests. */
+  int64_t recompute_tokens_sum = 0;
+
+  /*! \brief Update the metrics with a preempted request of the given tokens to prefill again. */
+  void Update(int64_t num_recompute_tokens) {
+    ++num_preemptions;
+    recompute_tokens_sum += num_recompute_tokens;
+  }
+
+  /*! \brief Return whether there is no preemption. */
+  bool IsEmpty() const { return num_preemptions == 0; }
+
+  /*! \brief Reset the metrics. */
+  void Reset() { *this = PreemptionMetrics(); }
+
+  /*! \brief Return the metrics in JSON. */
+  picojson::object AsJSON() const;
+};
+
+/*! \brief Metrics of the KV cache reservation for decode when admitting requests. */
+struct AdmissionMetrics {
+  /*! \brief The KV cache pages reserved for the decode of running requests in the last prefill. */
+  int64_t reserved_pages = 0;
+  /*! \brief The number of prefill steps where a waiting request is held only by the reservation. */
+  int64_t num_held_admissions = 0;
+  /*! \brief The number of finished requests whose output length was predicted. */
+  int64_t num_predictions = 0;
+  /*! \brief The total absolute error in tokens of the predicted output lengths. */
+  double prediction_error_sum = 0;
+
+  /*! \brief Update the metrics with the predicted and the actual output length of a request. */
+  void UpdatePrediction(double predicted_length, int64_t actual_length) {
+    ++num_predictions;
+    prediction_error_sum += std::abs(predicted_length - static_cast<double>(actual_length));
+  }
+
+  /*! \brief Return whether there is no reservation. */
+  bool IsEmpty() const { return reserved_pages + num_held_admissions + num_predictions == 0; }
+
+  /*! \brief Reset the metrics. */
+  void Reset() { *this = AdmissionMetrics(); }
+
+  /*! \brief Return the metrics in JSON. */
+  picojson::object AsJSON() const;
+};
+
+/*! \brief The metrics of adaptive prefill chunk sizing. */
+struct PrefillChunkMetrics {
+  /*! \brief The current prefill chunk size, or 0 when the chunk size is static. */
+  int64_t prefill_chunk_size = 0;
+  /*! \brief The fitted fixed time in seconds of a step. */
+  double step_time_intercept = 0;
+  /*! \brief The fitted time in seconds per token of a step. */
+  double step_time_per_token = 0;
+  /*! \brief The number of steps measured to fit the step time. */
+  int64_t num_updates = 0;
+
+  /*! \brief Return whether the chunk size is static. */
+  bool IsEmpty() const { return prefill_chunk_size == 0; }
+
+  /*! \brief Reset the metrics. */
+  void Reset() { *this = PrefillChunkMetrics(); }
+
+  /*! \brief Return the metrics in JSON. */
+  picojson::object AsJSON() const;
+};
+
+/*! \brief The metrics of a request class under the fair-share waiting queue order. */
+struct RequestClassMetrics {
+  /*! \brief The number of waiting requests of the class. */
+  int64_t queue_depth = 0;
+  /*! \brief The number of requests of the class admitted to prefill. */
+  int64_t num_admitted = 0;
+  /*! \brief The total time in seconds the admitted requests waited before prefill. */
+  double wait_time_sum = 0;
+  /*! \brief The maximum time in seconds an admitted request waited before prefill. */
+  double max_wait_time = 0;
+
+  /*! \brief Update the metrics with a request admitted to prefill. */
+  void UpdateAdmit(double wait_time) {
+    --queue_depth;
+    ++num_admitted;
+    wait_time_sum += wait_time;
+    max_wait_time = std::max(max_wait_time, wait_time);
+  }
+
+  /*! \brief Return the metrics in JSON. */
+  picojson::object AsJSON() const;
+};
+
 /*!
  * \brief Metrics attached to each request
  *
@@ -113,6 +297,8 @@ struct RequestMetrics {
   std::chrono::high_resolution_clock::time_point add_time_point;
   /*! \brief The time of finishing prefill stage. */
   std::chrono::high_resolution_clock::time_point prefill_end_time_point;
+  /*! \brief The time of returning the latest output tokens. */
+  std::chrono::high_resolution_clock::time_point last_token_time_point;
   /*! \brief The time of finishing all decode. */
   std::chrono::high_resolution_clock::time_point finish_time_point;
 
@@ -186,6 +372,16 @@ struct EngineMetrics {
   RequestMetrics last_finished_request;
   /*! \brief speculative decoding metrics */
   SpecDecodeMetrics spec_decode;
+  /*! \brief prefix cache metrics */
+  PrefixCacheMetrics prefix_cache;
+  /*! \brief preemption metrics */
+  PreemptionMetrics preemption;
+  /*! \brief admission reservation metrics */
+  AdmissionMetrics admission;
+  /*! \brief adaptive prefill chunk sizing metrics */
+  PrefillChunkMetrics prefill_chunk;
+  /*! \brief fair-share metrics of each request class */
+  std::unordered_map<std::string, RequestClassMetrics> request_classes;
 
   /*! \brief The maximum batch size we track for batch decode time. */
   static constexpr const int64_t kEndFineGrainedTrackingBatchSize = 65;
@@ -230,6 +426,18 @@ struct EngineMetrics {
     }
   }
 
+  /*!
+   * \brief Estimate the batch decode time of the given batch size from the tracked decode time.
+   * It falls back to the closest tracked batch size, and returns 0 if nothing is tracked.
+   * The batch sizes beyond the fine-grained tracking range are estimated as the largest tracked.
+   */
+  double EstimateDecodeTime(int batch_size) const;
+
+  /*! \brief Return the average prefill time per token, or 0 if nothing is prefilled yet. */
+  double GetPrefillTimePerToken() const {
+    return prefill_tokens_sum != 0 ? engine_prefill_time_sum / prefill_tokens_sum : 0.0;
+  }
+
   /*!
    * \brief Update global engine metrics as we finish a request
    *  by including the information from the finished request.
@@ -841,13 +841,13 @@ class ModelImpl : public ModelObj {
                           std::move(trace_recorder));
   }
 
-  Sampler CreateSampler(int max_num_sample, int num_models,
+  Sampler CreateSampler(int max_num_sample, int num_models, bool deterministic_sampling,
                         Optional<EventTraceRecorder> trace_recorder) final {
     if (Sampler::SupportGPUSampler(device_)) {
       return Sampler::CreateGPUSampler(max_num_sample, vocab_size_, &this->ft_, device_,
-                                       std::move(trace_recorder));
+                                       deterministic_sampling, std::move(trace_recorder));
     } else {
-      return Sampler::CreateCPUSampler(std::move(trace_recorder));
+      return Sampler::CreateCPUSampler(deterministic_sampling, std::move(trace_recorder));
     }
   }
 
@@ -311,7 +311,7 @@ class ModelObj : public Object {
                                               Optional<EventTraceRecorder> trace_recorder) = 0;
 
   /*! \brief Create a sampler from this model. */
-  virtual Sampler CreateSampler(int max_num_sample, int num_models,
+  virtual Sampler CreateSampler(int max_num_sample, int num_models, bool deterministic_sampling,
                                 Optional<EventTraceRecorder> trace_recorder) = 0;
 
   /*!
@@ -0,0 +1,80 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/output_length_predictor.cc
+ */
+#include "output_length_predictor.h"
+
+#include <cmath>
+
+#include "data.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+OutputLengthPredictor::OutputLengthPredictor(AdmissionMetrics* metrics) : metrics_(metrics) {}
+
+double OutputLengthPredictor::Predict(const Request& request) const {
+  auto it = template_stats_.find(GetTemplateKey(request));
+  if (it != template_stats_.end()) {
+    return it->second.Predict();
+  }
+  return global_stats_.initialized ? global_stats_.Predict() : -1;
+}
+
+void OutputLengthPredictor::Update(const Request& request, int64_t num_output_tokens) {
+  double predicted_length = Predict(request);
+  if (predicted_length >= 0) {
+    metrics_->UpdatePrediction(predicted_length, num_output_tokens);
+  }
+  uint64_t key = GetTemplateKey(request);
+  if (template_stats_.size() >= kMaxNumTemplates && !template_stats_.count(key)) {
+    // Drop an arbitrary template to bound the memory.
+    template_stats_.erase(template_stats_.begin());
+  }
+  template_stats_[key].Update(num_output_tokens);
+  global_stats_.Update(num_output_tokens);
+}
+
+void OutputLengthPredictor::Reset() {
+  template_stats_.clear();
+  global_stats_ = OutputLengthStats();
+}
+
+void OutputLengthPredictor::OutputLengthStats::Update(double length) {
+  if (!initialized) {
+    mean = length;
+    var = 0.0;
+    initialized = true;
+    return;
+  }
+  double diff = length - mean;
+  mean += kAlpha * diff;
+  var = (1 - kAlpha) * (var + kAlpha * diff * diff);
+}
+
+double OutputLengthPredictor::OutputLengthStats::Predict() const { return mean + std::sqrt(var); }
+
+uint64_t OutputLengthPredictor::GetTemplateKey(const Request& request) {
+  // FNV-1a hash of the leading prompt tokens.
+  uint64_t key = 14695981039346656037ULL;
+  int num_tokens = 0;
+  for (const Data& data : request->inputs) {
+    const TokenDataNode* token_data = data.as<TokenDataNode>();
+    if (token_data == nullptr) {
+      break;
+    }
+    for (int64_t token_id : token_data->token_ids) {
+      if (num_tokens == kTemplatePrefixLength) {
+        return key;
+      }
+      key = (key ^ static_cast<uint64_t>(token_id)) * 1099511628211ULL;
+      ++num_tokens;
+    }
+  }
+  return key;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,84 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/output_length_predictor.h
+ */
+#ifndef MLC_LLM_SERVE_OUTPUT_LENGTH_PREDICTOR_H_
+#define MLC_LLM_SERVE_OUTPUT_LENGTH_PREDICTOR_H_
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "metrics.h"
+#include "request.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief The online predictor of the output length of requests. It keeps the exponential moving
+ * mean and variance of the output lengths of the recent completions of each prompt template, and of
+ * all completions. The prompt template of a request is identified by its leading prompt tokens,
+ * which the requests of a chat template and a system prompt share.
+ * A request is predicted to output the mean plus one standard deviation of its template, so that
+ * most completions fit in the prediction. The requests of an unseen template are predicted by all
+ * completions.
+ */
+class OutputLengthPredictor {
+ public:
+  /*!
+   * \brief Constructor.
+   * \param metrics The metrics to report the prediction error to.
+   */
+  explicit OutputLengthPredictor(AdmissionMetrics* metrics);
+
+  /*!
+   * \brief Predict the output length of the given request.
+   * \return The predicted number of output tokens, or -1 when no request has completed.
+   */
+  double Predict(const Request& request) const;
+
+  /*!
+   * \brief Update the prediction of the template of the given completed request.
+   * \param request The completed request.
+   * \param num_output_tokens The number of output tokens of the request.
+   */
+  void Update(const Request& request, int64_t num_output_tokens);
+
+  /*! \brief Reset the predictor. */
+  void Reset();
+
+ private:
+  /*! \brief The exponential moving mean and variance of output lengths. */
+  struct OutputLengthStats {
+    double mean = 0.0;
+    double var = 0.0;
+    bool initialized = false;
+
+    void Update(double length);
+    double Predict() const;
+  };
+
+  /*! \brief Return the key of the prompt template of the given request. */
+  static uint64_t GetTemplateKey(const Request& request);
+
+  /*! \brief The number of leading prompt tokens identifying a prompt template. */
+  static constexpr const int kTemplatePrefixLength = 32;
+  /*! \brief The maximum number of prompt templates to track. */
+  static constexpr const size_t kMaxNumTemplates = 4096;
+  /*! \brief The weight of a new completion in the moving mean and variance. */
+  static constexpr const double kAlpha = 0.1;
+
+  /*! \brief The metrics to report to. */
+  AdmissionMetrics* metrics_;
+  /*! \brief The output length statistics of each prompt template. */
+  std::unordered_map<uint64_t, OutputLengthStats> template_stats_;
+  /*! \brief The output length statistics of all completions. */
+  OutputLengthStats global_stats_;
+};
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_OUTPUT_LENGTH_PREDICTOR_H_
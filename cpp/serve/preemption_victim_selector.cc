@@ -0,0 +1,163 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/preemption_victim_selector.cc
+ */
+#include "preemption_victim_selector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/****************** PreemptionVictimSelector ******************/
+
+int PreemptionVictimSelector::SelectVictim(const std::vector<Request>& running_queue) {
+  ICHECK(!running_queue.empty());
+  int victim = -1;
+  int victim_priority = 0;
+  double victim_cost = 0.0;
+  // Visit from the latest admitted request, so that it is preempted on ties.
+  for (int i = static_cast<int>(running_queue.size()) - 1; i >= 0; --i) {
+    const Request& request = running_queue[i];
+    ICHECK(request->rstate != nullptr) << "The state of the request has not been defined.";
+    RequestState rstate = GetRef<RequestState>(static_cast<RequestStateNode*>(request->rstate));
+    int entry_idx = GetLastAliveEntryIndex(rstate);
+    if (entry_idx == -1) {
+      continue;
+    }
+    int priority = request->generation_cfg->priority;
+    if (victim != -1 && priority > victim_priority) {
+      continue;
+    }
+    double cost = GetPreemptionCost(rstate, rstate->entries[entry_idx]);
+    if (victim == -1 || priority < victim_priority || cost < victim_cost) {
+      victim = i;
+      victim_priority = priority;
+      victim_cost = cost;
+    }
+  }
+  ICHECK_NE(victim, -1) << "There is no alive request state entry to preempt.";
+  return victim;
+}
+
+int PreemptionVictimSelector::GetLastAliveEntryIndex(const RequestState& rstate) {
+  for (int i = static_cast<int>(rstate->entries.size()) - 1; i >= 0; --i) {
+    if (rstate->entries[i]->status == RequestStateStatus::kAlive) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/****************** Last Running ******************/
+
+/*! \brief Preempt the latest admitted request. */
+class LastRunningPreemptionVictimSelector : public PreemptionVictimSelector {
+ public:
+  using PreemptionVictimSelector::PreemptionVictimSelector;
+
+ protected:
+  double GetPreemptionCost(const RequestState& rstate, const RequestStateEntry& rsentry) final {
+    return 0.0;
+  }
+};
+
+/****************** Fewest Pages Lost ******************/
+
+/*!
+ * \brief Preempt the request holding the fewest KV cache pages, whose preemption loses the least
+ * prefilled and decoded work to recompute. The full pages of the prefix shared with other
+ * sequences in prefix cache are not lost, as they stay in KV cache for the other sequences.
+ */
+class FewestPagesLostPreemptionVictimSelector : public PreemptionVictimSelector {
+ public:
+  using PreemptionVictimSelector::PreemptionVictimSelector;
+
+ protected:
+  double GetPreemptionCost(const RequestState& rstate, const RequestStateEntry& rsentry) final {
+    const RequestModelState& mstate = rsentry->mstates[0];
+    // The last committed token is not in KV cache until the next decode.
+    int64_t num_kv_tokens =
+        mstate->num_prefilled_tokens +
+        std::max(static_cast<int64_t>(mstate->committed_tokens.size()) - 1, int64_t{0});
+    int64_t num_shared_tokens =
+        static_cast<int64_t>(prefix_cache_->GetSequenceSharedLength(mstate->internal_id));
+    int64_t num_pages = (num_kv_tokens + kv_cache_page_size_ - 1) / kv_cache_page_size_;
+    int64_t num_shared_pages = std::min(num_shared_tokens, num_kv_tokens) / kv_cache_page_size_;
+    return static_cast<double>(num_pages - num_shared_pages);
+  }
+};
+
+/****************** Furthest From Completion ******************/
+
+/*!
+ * \brief Preempt the request with the most tokens left to generate before "max_tokens", which is
+ * expected to hold its KV cache pages for the longest time. The requests without "max_tokens" have
+ * unbounded tokens left, so they get cost -inf and are preempted before any request with
+ * "max_tokens" of the same priority.
+ */
+class FurthestFromCompletionPreemptionVictimSelector : public PreemptionVictimSelector {
+ public:
+  using PreemptionVictimSelector::PreemptionVictimSelector;
+
+ protected:
+  double GetPreemptionCost(const RequestState& rstate, const RequestStateEntry& rsentry) final {
+    int max_tokens = rsentry->request->generation_cfg->max_tokens;
+    if (max_tokens == -1) {
+      return -std::numeric_limits<double>::infinity();
+    }
+    return -static_cast<double>(max_tokens -
+                                static_cast<int64_t>(rsentry->mstates[0]->committed_tokens.size()));
+  }
+};
+
+/****************** Deadline ******************/
+
+/*!
+ * \brief Preempt the request with the most time left before its deadline, which tolerates the
+ * re-prefill latency best. The requests without deadline have unbounded slack, so they get cost
+ * -inf and are preempted before any request with deadline of the same priority. Among them, the
+ * latest admitted one is preempted as on any tie.
+ */
+class DeadlinePreemptionVictimSelector : public PreemptionVictimSelector {
+ public:
+  using PreemptionVictimSelector::PreemptionVictimSelector;
+
+ protected:
+  double GetPreemptionCost(const RequestState& rstate, const RequestStateEntry& rsentry) final {
+    int64_t deadline_ms = rsentry->request->generation_cfg->deadline_ms;
+    if (deadline_ms == -1) {
+      return -std::numeric_limits<double>::infinity();
+    }
+    auto deadline = rstate->metrics.add_time_point + std::chrono::milliseconds(deadline_ms);
+    auto slack = deadline - std::chrono::high_resolution_clock::now();
+    return -std::chrono::duration<double>(slack).count();
+  }
+};
+
+std::unique_ptr<PreemptionVictimSelector> PreemptionVictimSelector::Create(
+    PreemptionPolicy policy, int kv_cache_page_size, PrefixCache prefix_cache) {
+  switch (policy) {
+    case PreemptionPolicy::kLastRunning:
+      return std::make_unique<LastRunningPreemptionVictimSelector>(kv_cache_page_size,
+                                                                   std::move(prefix_cache));
+    case PreemptionPolicy::kFewestPagesLost:
+      return std::make_unique<FewestPagesLostPreemptionVictimSelector>(kv_cache_page_size,
+                                                                       std::move(prefix_cache));
+    case PreemptionPolicy::kFurthestFromCompletion:
+      return std::make_unique<FurthestFromCompletionPreemptionVictimSelector>(
+          kv_cache_page_size, std::move(prefix_cache));
+    case PreemptionPolicy::kDeadline:
+      return std::make_unique<DeadlinePreemptionVictimSelector>(kv_cache_page_size,
+                                                                std::move(prefix_cache));
+  }
+  LOG(FATAL) << "Invalid preemption policy: " << static_cast<int>(policy);
+  throw;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
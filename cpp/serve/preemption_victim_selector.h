@@ -0,0 +1,79 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/preemption_victim_selector.h
+ */
+#ifndef MLC_LLM_SERVE_PREEMPTION_VICTIM_SELECTOR_H_
+#define MLC_LLM_SERVE_PREEMPTION_VICTIM_SELECTOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "config.h"
+#include "prefix_cache.h"
+#include "request.h"
+#include "request_state.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief The selector of the running request to preempt when the KV cache runs out of memory.
+ * Only the running requests of the lowest priority are candidates. The subclasses implement
+ * different preemption policies by the preemption cost of candidates, and the candidate of the
+ * lowest cost is preempted. The latest admitted candidate is preempted on ties.
+ */
+class PreemptionVictimSelector {
+ public:
+  explicit PreemptionVictimSelector(int kv_cache_page_size, PrefixCache prefix_cache)
+      : kv_cache_page_size_(kv_cache_page_size), prefix_cache_(std::move(prefix_cache)) {}
+
+  virtual ~PreemptionVictimSelector() = default;
+
+  /*!
+   * \brief Create a preemption victim selector of the given preemption policy.
+   * \param policy The preemption policy.
+   * \param kv_cache_page_size The number of tokens in each KV cache page.
+   * \param prefix_cache The prefix cache, which tells the KV cache pages shared by sequences.
+   * \return The created selector.
+   */
+  static std::unique_ptr<PreemptionVictimSelector> Create(PreemptionPolicy policy,
+                                                          int kv_cache_page_size,
+                                                          PrefixCache prefix_cache);
+
+  /*!
+   * \brief Select the running request to preempt.
+   * \param running_queue The running requests in the order of admission.
+   * \return The index of selected request in the running queue.
+   */
+  int SelectVictim(const std::vector<Request>& running_queue);
+
+  /*!
+   * \brief Get the last alive request state entry of a request, which is the entry to preempt
+   * when the request is selected.
+   * \param rstate The request state.
+   * \return The index of the entry, or -1 if there is no alive entry.
+   */
+  static int GetLastAliveEntryIndex(const RequestState& rstate);
+
+ protected:
+  /*!
+   * \brief Get the preemption cost of a candidate. The candidate of the lowest cost is preempted.
+   * \param rstate The request state of the candidate.
+   * \param rsentry The request state entry to preempt of the candidate.
+   * \return The preemption cost.
+   */
+  virtual double GetPreemptionCost(const RequestState& rstate,
+                                   const RequestStateEntry& rsentry) = 0;
+
+  /*! \brief The number of tokens in each KV cache page. */
+  int kv_cache_page_size_;
+  /*! \brief The prefix cache. */
+  PrefixCache prefix_cache_;
+};
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_PREEMPTION_VICTIM_SELECTOR_H_
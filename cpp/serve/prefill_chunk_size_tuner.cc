@@ -0,0 +1,83 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/prefill_chunk_size_tuner.cc
+ */
+#include "prefill_chunk_size_tuner.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+PrefillChunkSizeTuner::PrefillChunkSizeTuner(double latency_target,
+                                             int64_t min_prefill_chunk_size,
+                                             int64_t max_prefill_chunk_size,
+                                             int64_t kv_cache_page_size,
+                                             PrefillChunkMetrics* metrics)
+    : latency_target_(latency_target),
+      min_prefill_chunk_size_(std::min(min_prefill_chunk_size, max_prefill_chunk_size)),
+      max_prefill_chunk_size_(max_prefill_chunk_size),
+      kv_cache_page_size_(kv_cache_page_size),
+      metrics_(metrics) {
+  CHECK_GT(latency_target_, 0) << "The prefill chunk latency target must be positive.";
+  CHECK_GT(min_prefill_chunk_size_, 0) << "The minimum prefill chunk size must be positive.";
+  Reset();
+}
+
+void PrefillChunkSizeTuner::Update(int64_t num_tokens, double step_time) {
+  if (num_tokens <= 0) {
+    return;
+  }
+  double x = static_cast<double>(num_tokens);
+  sum_weight_ = sum_weight_ * kDecay + 1.0;
+  sum_tokens_ = sum_tokens_ * kDecay + x;
+  sum_time_ = sum_time_ * kDecay + step_time;
+  sum_tokens_sq_ = sum_tokens_sq_ * kDecay + x * x;
+  sum_tokens_time_ = sum_tokens_time_ * kDecay + x * step_time;
+  ++metrics_->num_updates;
+
+  // - Fit the model. Skip when the measured steps do not tell the slope apart, e.g., when all
+  // of them process the same number of tokens, or when the time does not grow with the tokens.
+  double mean_tokens = sum_tokens_ / sum_weight_;
+  double mean_time = sum_time_ / sum_weight_;
+  double var_tokens = sum_tokens_sq_ / sum_weight_ - mean_tokens * mean_tokens;
+  if (var_tokens <= 1.0) {
+    return;
+  }
+  double per_token = (sum_tokens_time_ / sum_weight_ - mean_tokens * mean_time) / var_tokens;
+  if (per_token <= 0.0) {
+    return;
+  }
+  double intercept = std::max(mean_time - per_token * mean_tokens, 0.0);
+  metrics_->step_time_intercept = intercept;
+  metrics_->step_time_per_token = per_token;
+
+  // - Choose the largest chunk size within the target, aligned down to the KV cache page size.
+  double max_tokens = (latency_target_ - intercept) / per_token;
+  int64_t chunk_size = max_tokens >= static_cast<double>(max_prefill_chunk_size_)
+                           ? max_prefill_chunk_size_
+                           : static_cast<int64_t>(std::max(max_tokens, 0.0));
+  if (chunk_size < max_prefill_chunk_size_ && chunk_size >= kv_cache_page_size_) {
+    chunk_size = chunk_size / kv_cache_page_size_ * kv_cache_page_size_;
+  }
+  prefill_chunk_size_ = std::max(chunk_size, min_prefill_chunk_size_);
+  metrics_->prefill_chunk_size = prefill_chunk_size_;
+}
+
+void PrefillChunkSizeTuner::Reset() {
+  prefill_chunk_size_ = max_prefill_chunk_size_;
+  sum_weight_ = 0.0;
+  sum_tokens_ = 0.0;
+  sum_time_ = 0.0;
+  sum_tokens_sq_ = 0.0;
+  sum_tokens_time_ = 0.0;
+  metrics_->Reset();
+  metrics_->prefill_chunk_size = prefill_chunk_size_;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
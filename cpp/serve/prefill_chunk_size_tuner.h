@@ -0,0 +1,90 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/prefill_chunk_size_tuner.h
+ */
+#ifndef MLC_LLM_SERVE_PREFILL_CHUNK_SIZE_TUNER_H_
+#define MLC_LLM_SERVE_PREFILL_CHUNK_SIZE_TUNER_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "metrics.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief The online tuner of the prefill chunk size. It fits the linear latency model
+ * "step_time = intercept + per_token * num_tokens" to the measured time of the prefill steps, and
+ * chooses the largest chunk size whose estimated step time is within the latency target. Under
+ * hybrid prefill, the step time of prefill is the inter-token latency of the requests decoded
+ * together, which the target bounds. Decode steps are not fitted, since their time is dominated by
+ * reading the KV cache rather than by the number of tokens.
+ * The fit weighs the recent steps more by exponentially decaying the past ones, so that the model
+ * follows the change of the step time with the KV cache length of the running requests.
+ */
+class PrefillChunkSizeTuner {
+ public:
+  /*!
+   * \brief Constructor.
+   * \param latency_target The target step latency in seconds.
+   * \param min_prefill_chunk_size The minimum chunk size to choose.
+   * \param max_prefill_chunk_size The maximum chunk size to choose, which is the chunk size before
+   * any step is measured.
+   * \param kv_cache_page_size The KV cache page size, to which the chosen chunk size is aligned.
+   * \param metrics The metrics to report the chosen chunk size and the fitted model to.
+   */
+  explicit PrefillChunkSizeTuner(double latency_target, int64_t min_prefill_chunk_size,
+                                 int64_t max_prefill_chunk_size, int64_t kv_cache_page_size,
+                                 PrefillChunkMetrics* metrics);
+
+  /*!
+   * \brief Update the latency model with a measured prefill step, and choose the chunk size again.
+   * \param num_tokens The number of tokens processed in the step.
+   * \param step_time The time of the step in seconds.
+   */
+  void Update(int64_t num_tokens, double step_time);
+
+  /*!
+   * \brief Return the chosen prefill chunk size.
+   * \param num_decode_inputs The number of running requests, whose decode inputs count in the
+   * prefill chunk. The chunk size is kept a page above them so that prefill makes progress.
+   */
+  int64_t GetPrefillChunkSize(int64_t num_decode_inputs) const {
+    return std::min(std::max(prefill_chunk_size_, num_decode_inputs + kv_cache_page_size_),
+                    max_prefill_chunk_size_);
+  }
+
+  /*! \brief Reset the latency model and the chosen chunk size. */
+  void Reset();
+
+ private:
+  /*! \brief The weight of the past steps in the fit after each update. */
+  static constexpr const double kDecay = 0.98;
+
+  /*! \brief The target step latency in seconds. */
+  double latency_target_;
+  /*! \brief The minimum chunk size to choose. */
+  int64_t min_prefill_chunk_size_;
+  /*! \brief The maximum chunk size to choose. */
+  int64_t max_prefill_chunk_size_;
+  /*! \brief The KV cache page size. */
+  int64_t kv_cache_page_size_;
+  /*! \brief The metrics to report to. */
+  PrefillChunkMetrics* metrics_;
+  /*! \brief The chosen prefill chunk size. */
+  int64_t prefill_chunk_size_;
+  /*! \brief The decayed sums of the least-squares fit. */
+  double sum_weight_ = 0.0;
+  double sum_tokens_ = 0.0;
+  double sum_time_ = 0.0;
+  double sum_tokens_sq_ = 0.0;
+  double sum_tokens_time_ = 0.0;
+};
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_PREFILL_CHUNK_SIZE_TUNER_H_
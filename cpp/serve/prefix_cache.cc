@@ -7,6 +7,10 @@
 #include <tvm/runtime/nvtx.h>
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
+
+#include "prefix_cache_evictor.h"
+
 namespace mlc {
 namespace llm {
 namespace serve {
@@ -22,16 +26,28 @@ class PrefixCacheImpl : public PrefixCacheObj {
    * \brief Constructor of paged radix tree.
    * \param max_num_recycling_seqs The maximum number of sequences in prefix cache.
    * \param remove_callback The optional callback function to call when removing a sequence.
+   * \param rollback_callback The optional callback function to call when trimming a sequence.
+   * \param kv_cache_page_size The KV cache page size, by which trailing tokens are trimmed.
+   * \param eviction_policy The eviction policy of recycling sequences.
+   * \param tenant_quota The quotas of each tenant partition.
+   * \param metrics The optional prefix cache metrics to update.
    */
-  explicit PrefixCacheImpl(size_t max_num_recycling_seqs, PrefixCacheRemoveCallback remove_callback)
+  explicit PrefixCacheImpl(size_t max_num_recycling_seqs, PrefixCacheRemoveCallback remove_callback,
+                           PrefixCacheRollBackCallback rollback_callback,
+                           size_t kv_cache_page_size, PrefixCacheEvictionPolicy eviction_policy,
+                           PrefixCacheTenantQuota tenant_quota, PrefixCacheMetrics* metrics)
       : radix_tree_(PagedRadixTree::Create()),
+        evictor_(PrefixCacheEvictor::Create(eviction_policy, radix_tree_)),
         max_num_recycling_seqs_(max_num_recycling_seqs),
-        remove_callback_(std::move(remove_callback)) {
-    recycling_seq_lrus_.clear();
-    reversed_recycling_seq_lrus_.clear();
+        tenant_quota_(tenant_quota),
+        remove_callback_(std::move(remove_callback)),
+        rollback_callback_(std::move(rollback_callback)),
+        kv_cache_page_size_(kv_cache_page_size),
+        metrics_(metrics) {
+    CHECK_GT(kv_cache_page_size, 0);
     seq_states_.clear();
     seq_sliding_window_infos_.clear();
-    lru_counter_ = 0;
+    seq_hot_lengths_.clear();
   }
 
   /*!
@@ -41,25 +57,38 @@ class PrefixCacheImpl : public PrefixCacheObj {
    * \param sliding_window_size The sliding window size for the sequence, -1 as sliding window
    * disabled.
    * \param attention_sink_size The attention sink size for the sequence, 0 by default.
+   * \param tenant The tenant partition of the sequence.
+   * \param shared_across_tenants The flag if the sequence can be matched by other tenants.
    * \return The matched result.
    */
   PrefixCacheMatchedResult InsertSequence(int64_t seq_id, std::vector<int32_t> tokens,
-                                          int sliding_window_size, int attention_sink_size) final {
+                                          int sliding_window_size, int attention_sink_size,
+                                          const std::string& tenant,
+                                          bool shared_across_tenants) final {
     CHECK_NE(sliding_window_size, 0);
     CHECK_GE(attention_sink_size, 0);
     CHECK(seq_states_.find(seq_id) == seq_states_.end());
     CHECK(seq_sliding_window_infos_.find(seq_id) == seq_sliding_window_infos_.end());
     CHECK(!tokens.empty());
     CommitSequenceExtention();
+    int64_t prompt_length = tokens.size();
     tokens.pop_back();
-    auto [matched_offset, matched_seqs] = radix_tree_->MatchPrefix(tokens);
+    TenantPartition* partition = &tenant_partitions_[tenant];
+    // Only the sequences of the same tenant and the shared ones are visible. The filter is skipped
+    // when all sequences belong to a single tenant.
+    std::function<bool(int64_t)> visible = nullptr;
+    if (tenant_partitions_.size() > 1) {
+      visible = [this, partition](int64_t seq_id) {
+        return seq_tenant_partitions_.at(seq_id) == partition || shared_seqs_.count(seq_id);
+      };
+    }
+    auto [matched_offset, matched_seqs] = radix_tree_->MatchPrefix(tokens, visible);
     std::pair<int, size_t> sliding_window_info{sliding_window_size, attention_sink_size};
     // No prefix matched, directly adding new sequence.
     if (!matched_offset) {
       radix_tree_->AddSequence(seq_id);
-      seq_states_.emplace(seq_id, SequenceState::kActive);
-      seq_sliding_window_infos_.emplace(seq_id, sliding_window_info);
-      return PrefixCacheMatchedResult{0, -1, -1, 0};
+      AddSequenceStates(seq_id, sliding_window_info, 0, partition, shared_across_tenants);
+      return UpdateLookupMetrics(prompt_length, PrefixCacheMatchedResult{0, -1, -1, 0});
     }
 
     CHECK(!matched_seqs.empty());
@@ -70,12 +99,12 @@ class PrefixCacheImpl : public PrefixCacheObj {
       // If sliding window enabled, the reusage of recycling sequences should be limited to exactly
       // matched. And no rolling back is allowed due to the sliding window.
       for (int64_t matched_seq_id : matched_seqs) {
-        if (seq_states_.at(matched_seq_id) == SequenceState::kRecycling &&
-            seq_sliding_window_infos_.at(matched_seq_id) == sliding_window_info) {
+        if (IsReusable(matched_seq_id, sliding_window_info, partition)) {
           size_t matched_seq_length = radix_tree_->GetSequenceLength(matched_seq_id);
           if (matched_seq_length == matched_offset) {
-            ReuseRecyclingSequence(matched_seq_id);
-            return PrefixCacheMatchedResult{matched_offset, -1, matched_seq_id, 0};
+            ReuseRecyclingSequence(matched_seq_id, matched_offset, shared_across_tenants);
+            return UpdateLookupMetrics(
+                prompt_length, PrefixCacheMatchedResult{matched_offset, -1, matched_seq_id, 0});
           }
         }
       }
@@ -86,8 +115,7 @@ class PrefixCacheImpl : public PrefixCacheObj {
       int64_t shortest_recycling_seq_id = -1;
 
       for (int64_t matched_seq_id : matched_seqs) {
-        if (seq_states_.at(matched_seq_id) == SequenceState::kRecycling &&
-            seq_sliding_window_infos_.at(matched_seq_id) == sliding_window_info) {
+        if (IsReusable(matched_seq_id, sliding_window_info, partition)) {
           size_t matched_seq_length = radix_tree_->GetSequenceLength(matched_seq_id);
           if (shortest_recycling_seq_id == -1 ||
               matched_seq_length < shortest_recycling_seq_length) {
@@ -97,15 +125,18 @@ class PrefixCacheImpl : public PrefixCacheObj {
         }
       }
       if (shortest_recycling_seq_id != -1 && matched_offset > shortest_recycling_seq_length * 0.9) {
-        ReuseRecyclingSequence(shortest_recycling_seq_id);
+        ReuseRecyclingSequence(shortest_recycling_seq_id, matched_offset, shared_across_tenants);
         if (shortest_recycling_seq_length > matched_offset) {
           // Recycling sequence is longer than new sequence, rolling back the redundant trailing
           // tokens, to match the new sequence.
           radix_tree_->RollBackSequence(shortest_recycling_seq_id,
                                         shortest_recycling_seq_length - matched_offset);
+          snapshot_dirty_ = true;
         }
-        return PrefixCacheMatchedResult{matched_offset, -1, shortest_recycling_seq_id,
-                                        shortest_recycling_seq_length - matched_offset};
+        return UpdateLookupMetrics(
+            prompt_length,
+            PrefixCacheMatchedResult{matched_offset, -1, shortest_recycling_seq_id,
+                                     shortest_recycling_seq_length - matched_offset});
       }
       // No reusage of recycling sequence, fallback to forking matched sequence. Currently, we only
       // fork from sequence without sliding window, due to current paged KVCache implementation.
@@ -126,16 +157,20 @@ class PrefixCacheImpl : public PrefixCacheObj {
       }
       if (longest_forking_offset > 0) {
         radix_tree_->ForkSequence(seq_id, longest_forking_seq_id, longest_forking_offset);
-        seq_states_.emplace(seq_id, SequenceState::kActive);
-        seq_sliding_window_infos_.emplace(seq_id, sliding_window_info);
-        return PrefixCacheMatchedResult{longest_forking_offset, longest_forking_seq_id, -1, 0};
+        evictor_->HitSequence(longest_forking_seq_id);
+        size_t& forked_hot_length = seq_hot_lengths_.at(longest_forking_seq_id);
+        forked_hot_length = std::max(forked_hot_length, longest_forking_offset);
+        AddSequenceStates(seq_id, sliding_window_info, longest_forking_offset, partition,
+                          shared_across_tenants);
+        return UpdateLookupMetrics(
+            prompt_length,
+            PrefixCacheMatchedResult{longest_forking_offset, longest_forking_seq_id, -1, 0});
       }
     }
     // No forking from matched sequence, fallback to adding new sequence.
     radix_tree_->AddSequence(seq_id);
-    seq_states_.emplace(seq_id, SequenceState::kActive);
-    seq_sliding_window_infos_.emplace(seq_id, sliding_window_info);
-    return PrefixCacheMatchedResult{0, -1, -1, 0};
+    AddSequenceStates(seq_id, sliding_window_info, 0, partition, shared_across_tenants);
+    return UpdateLookupMetrics(prompt_length, PrefixCacheMatchedResult{0, -1, -1, 0});
   }
 
   /*!
@@ -175,6 +210,9 @@ class PrefixCacheImpl : public PrefixCacheObj {
     CommitSequenceExtention();
     CHECK(seq_states_.at(seq_id) == SequenceState::kActive);
     radix_tree_->RollBackSequence(seq_id, num_tokens);
+    snapshot_dirty_ |= num_tokens > 0;
+    size_t& hot_length = seq_hot_lengths_.at(seq_id);
+    hot_length = std::min(hot_length, radix_tree_->GetSequenceLength(seq_id));
   }
 
   /*!
@@ -188,55 +226,58 @@ class PrefixCacheImpl : public PrefixCacheObj {
   void RecycleSequence(int64_t seq_id, bool lazy = true) final {
     CommitSequenceExtention();
     CHECK(seq_states_.at(seq_id) == SequenceState::kActive);
-    CHECK(recycling_seq_lrus_.find(seq_id) == recycling_seq_lrus_.end());
-    if (lazy && max_num_recycling_seqs_ != 0) {
+    // The recycled sequence carries all its extended tokens, which are to be matched.
+    snapshot_dirty_ = true;
+    if (lazy && max_num_recycling_seqs_ != 0 && tenant_quota_.max_num_recycling_seqs != 0) {
       // Remove the sequence lazily.
-      if (recycling_seq_lrus_.size() == max_num_recycling_seqs_) {
+      TenantPartition* partition = seq_tenant_partitions_.at(seq_id);
+      if (tenant_quota_.max_num_recycling_seqs != -1 &&
+          partition->num_recycling_seqs ==
+              static_cast<size_t>(tenant_quota_.max_num_recycling_seqs)) {
+        // If the tenant has reached its quota of recycling sequences, try to pop one recycling
+        // sequence of the same tenant.
+        CHECK(TryRemoveRecyclingSequence(
+            [this, partition](int64_t seq_id) { return InPartition(seq_id, partition); }));
+      }
+      if (evictor_->NumRecyclingSequences() == max_num_recycling_seqs_) {
         // If prefix cache has reached maximum number of recycling sequences, try to pop one
         // recycling sequence.
-        CHECK(TryFreeMemory());
-        CHECK_EQ(recycling_seq_lrus_.size(), max_num_recycling_seqs_ - 1);
+        CHECK(TryRemoveRecyclingSequence());
+        CHECK_EQ(evictor_->NumRecyclingSequences(), max_num_recycling_seqs_ - 1);
       }
       seq_states_.at(seq_id) = SequenceState::kRecycling;
-      ++lru_counter_;
-      recycling_seq_lrus_.emplace(seq_id, lru_counter_);
-      reversed_recycling_seq_lrus_.emplace(lru_counter_, seq_id);
+      evictor_->RecycleSequence(seq_id);
+      ++partition->num_recycling_seqs;
+      partition->num_recycling_tokens += radix_tree_->GetSequenceLength(seq_id);
     } else {
       // Remove the sequence intermediately.
-      radix_tree_->RemoveSequence(seq_id);
-      if (remove_callback_ != nullptr) {
-        remove_callback_(seq_id);
-      }
-      CHECK(seq_states_.erase(seq_id));
-      CHECK(seq_sliding_window_infos_.erase(seq_id));
+      RemoveSequence(seq_id);
     }
   }
 
   /*!
-   * \brief Try to remove recycling sequence to free up memory. It will remove the oldest recycling
-   sequence.
-   * \return The flag if there is a sequence removed. In other word, return true when memory is
-   freed successfully.
+   * \brief Try to free up memory from recycling sequences. The cold trailing tokens of recycling
+   * sequences are trimmed first, and a whole recycling sequence is removed only when there is no
+   * cold token to trim. The recycling sequence to trim or remove is selected by the eviction
+   * policy, among the tenants beyond their token quota first.
+   * \return The flag if there is a sequence trimmed or removed. In other word, return true when
+   memory is freed successfully.
    * \throw Error if the given sequence id is not valid.
    */
   bool TryFreeMemory() final {
     NVTXScopedRange nvtx_scope("PrefixCache TryFreeMemory");
-    if (reversed_recycling_seq_lrus_.empty()) {
-      // There is no recycling sequence. No memory can be freed.
-      return false;
-    }
-    auto [lru, seq_id] = *reversed_recycling_seq_lrus_.begin();
-    CHECK(seq_states_.at(seq_id) == SequenceState::kRecycling);
-    CHECK_EQ(recycling_seq_lrus_.at(seq_id), lru);
-    radix_tree_->RemoveSequence(seq_id);
-    if (remove_callback_ != nullptr) {
-      remove_callback_(seq_id);
+    if (tenant_quota_.max_recycling_tokens != -1) {
+      // The tenants beyond their token quota free memory first, so that a tenant with many
+      // unique long prompts does not evict the hot prefixes of others.
+      auto over_quota = [this](int64_t seq_id) {
+        return seq_tenant_partitions_.at(seq_id)->num_recycling_tokens >
+               static_cast<size_t>(tenant_quota_.max_recycling_tokens);
+      };
+      if (TryTrimRecyclingSequence(over_quota) || TryRemoveRecyclingSequence(over_quota)) {
+        return true;
+      }
     }
-    CHECK(seq_states_.erase(seq_id));
-    CHECK(recycling_seq_lrus_.erase(seq_id));
-    CHECK(reversed_recycling_seq_lrus_.erase(lru));
-    CHECK(seq_sliding_window_infos_.erase(seq_id));
-    return true;
+    return TryTrimRecyclingSequence() || TryRemoveRecyclingSequence();
   }
 
   /*!
@@ -247,29 +288,226 @@ class PrefixCacheImpl : public PrefixCacheObj {
    */
   bool HasSequence(int64_t seq_id) final { return radix_tree_->HasSequence(seq_id); }
 
+  /*!
+   * \brief Get the number of leading tokens of a sequence shared with other sequences. The
+   * uncommitted extended tokens are exclusive to the sequence, and they are not committed here.
+   * \param seq_id The sequence ID for index.
+   * \return The number of shared tokens, which is 0 if the sequence is not in prefix cache.
+   */
+  size_t GetSequenceSharedLength(int64_t seq_id) final {
+    if (!radix_tree_->HasSequence(seq_id)) {
+      return 0;
+    }
+    return radix_tree_->GetSequenceLength(seq_id) - radix_tree_->GetSequenceExclusiveLength(seq_id);
+  }
+
+  /*!
+   * \brief Export the token content of all sequences in prefix cache.
+   * \return The exported binary data.
+   */
+  std::string ExportBinary() final {
+    CommitSequenceExtention();
+    return radix_tree_->ExportBinary();
+  }
+
+  PagedRadixTreeSnapshot CreateSnapshot() final {
+    if (snapshot_dirty_) {
+      NVTXScopedRange nvtx_scope("PrefixCache CreateSnapshot");
+      CommitSequenceExtention();
+      snapshot_ = radix_tree_->CreateSnapshot();
+      snapshot_dirty_ = false;
+    }
+    return snapshot_;
+  }
+
   /*!
    * \brief Reset the prefix cache to initial status.
    */
   void Reset() final {
     radix_tree_->Reset();
-    recycling_seq_lrus_.clear();
-    reversed_recycling_seq_lrus_.clear();
+    snapshot_dirty_ = true;
+    evictor_->Reset();
     seq_states_.clear();
     seq_sliding_window_infos_.clear();
+    seq_hot_lengths_.clear();
+    tenant_partitions_.clear();
+    seq_tenant_partitions_.clear();
+    shared_seqs_.clear();
     uncommitted_extended_token_ids_.clear();
-    lru_counter_ = 0;
   }
 
   PrefixCacheMode Mode() final { return PrefixCacheMode::kRadix; }
 
  private:
-  void ReuseRecyclingSequence(int64_t seq_id) {
+  /*! \brief The sequence counts of a tenant partition, to enforce the tenant quotas. */
+  struct TenantPartition {
+    /*! \brief The number of sequences, either active or recycling. */
+    size_t num_seqs = 0;
+    /*! \brief The number of recycling sequences. */
+    size_t num_recycling_seqs = 0;
+    /*! \brief The total number of tokens of recycling sequences. */
+    size_t num_recycling_tokens = 0;
+  };
+
+  /*!
+   * \brief Update the prefix cache metrics with the lookup result of a new sequence.
+   * \param prompt_length The number of prompt tokens of the new sequence.
+   * \param result The matched result.
+   * \return The matched result.
+   */
+  PrefixCacheMatchedResult UpdateLookupMetrics(int64_t prompt_length,
+                                               PrefixCacheMatchedResult result) {
+    if (metrics_ != nullptr) {
+      metrics_->UpdateLookup(prompt_length, result.prefilled_offset, result.reused_seq_id != -1,
+                             result.forked_seq_id != -1);
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Check if a matched sequence can be reused by a new sequence, which requires the matched
+   * sequence to be recycling, with the same sliding window information and of the same tenant.
+   * The sequences of other tenants can only be forked from.
+   */
+  bool IsReusable(int64_t seq_id, std::pair<int, size_t> sliding_window_info,
+                  TenantPartition* partition) {
+    return seq_states_.at(seq_id) == SequenceState::kRecycling &&
+           seq_sliding_window_infos_.at(seq_id) == sliding_window_info &&
+           InPartition(seq_id, partition);
+  }
+
+  /*! \brief Check if a sequence belongs to the given tenant partition. */
+  bool InPartition(int64_t seq_id, TenantPartition* partition) {
+    return seq_tenant_partitions_.at(seq_id) == partition;
+  }
+
+  /*! \brief Add the states of a new active sequence. */
+  void AddSequenceStates(int64_t seq_id, std::pair<int, size_t> sliding_window_info,
+                         size_t hot_length, TenantPartition* partition,
+                         bool shared_across_tenants) {
+    seq_states_.emplace(seq_id, SequenceState::kActive);
+    seq_sliding_window_infos_.emplace(seq_id, sliding_window_info);
+    seq_hot_lengths_.emplace(seq_id, hot_length);
+    seq_tenant_partitions_.emplace(seq_id, partition);
+    ++partition->num_seqs;
+    if (shared_across_tenants) {
+      shared_seqs_.insert(seq_id);
+    }
+  }
+
+  void ReuseRecyclingSequence(int64_t seq_id, size_t matched_offset, bool shared_across_tenants) {
     CHECK(seq_states_.at(seq_id) == SequenceState::kRecycling);
-    size_t lru = recycling_seq_lrus_.at(seq_id);
-    CHECK_EQ(reversed_recycling_seq_lrus_.at(lru), seq_id);
     seq_states_.at(seq_id) = SequenceState::kActive;
-    CHECK(recycling_seq_lrus_.erase(seq_id));
-    CHECK(reversed_recycling_seq_lrus_.erase(lru));
+    evictor_->ReuseSequence(seq_id);
+    TenantPartition* partition = seq_tenant_partitions_.at(seq_id);
+    --partition->num_recycling_seqs;
+    partition->num_recycling_tokens -= radix_tree_->GetSequenceLength(seq_id);
+    // The tokens beyond the matched offset are rolled back, and thus the hot prefix is bounded.
+    seq_hot_lengths_.at(seq_id) = matched_offset;
+    // The reused sequence is shared as per the new sequence.
+    if (shared_across_tenants) {
+      shared_seqs_.insert(seq_id);
+    } else {
+      shared_seqs_.erase(seq_id);
+    }
+  }
+
+  /*!
+   * \brief Try to trim the cold trailing tokens of a recycling sequence selected by the eviction
+   * policy, among the recycling sequences with cold trailing tokens.
+   * \param filter The optional filter of recycling sequences to trim.
+   * \return The flag if there is a sequence trimmed.
+   */
+  bool TryTrimRecyclingSequence(const std::function<bool(int64_t)>& filter = nullptr) {
+    if (rollback_callback_ == nullptr) {
+      return false;
+    }
+    int64_t seq_id = evictor_->SelectVictim([this, &filter](int64_t seq_id) {
+      return (filter == nullptr || filter(seq_id)) && GetTrimmableLength(seq_id) > 0;
+    });
+    if (seq_id == -1) {
+      return false;
+    }
+    size_t num_tokens = GetTrimmableLength(seq_id);
+    radix_tree_->RollBackSequence(seq_id, num_tokens);
+    snapshot_dirty_ = true;
+    rollback_callback_(seq_id, num_tokens);
+    seq_tenant_partitions_.at(seq_id)->num_recycling_tokens -= num_tokens;
+    if (metrics_ != nullptr) {
+      metrics_->UpdateTrim(num_tokens);
+    }
+    return true;
+  }
+
+  /*!
+   * \brief Try to remove a whole recycling sequence selected by the eviction policy.
+   * \param filter The optional filter of recycling sequences to remove.
+   * \return The flag if there is a sequence removed.
+   */
+  bool TryRemoveRecyclingSequence(const std::function<bool(int64_t)>& filter = nullptr) {
+    int64_t seq_id = evictor_->SelectVictim(filter);
+    if (seq_id == -1) {
+      // There is no recycling sequence. No memory can be freed.
+      return false;
+    }
+    CHECK(seq_states_.at(seq_id) == SequenceState::kRecycling);
+    if (metrics_ != nullptr) {
+      metrics_->UpdateEviction(radix_tree_->GetSequenceExclusiveLength(seq_id));
+    }
+    RemoveSequence(seq_id);
+    return true;
+  }
+
+  /*!
+   * \brief Get the number of cold trailing tokens of a recycling sequence that can be trimmed
+   * while keeping the sequence in cache. The cold tokens are owned by no other sequence and beyond
+   * the prefix ever matched by other requests. The trimmed length is rounded down so that the
+   * sequence ends at a KV cache page boundary, as trimming within a page frees no KV cache memory,
+   * and it is 0 when no whole page is freed. Trimming is not allowed with sliding window, and
+   * trimming the entire sequence is left to sequence removal.
+   */
+  size_t GetTrimmableLength(int64_t seq_id) {
+    if (seq_sliding_window_infos_.at(seq_id).first != -1) {
+      return 0;
+    }
+    size_t length = radix_tree_->GetSequenceLength(seq_id);
+    size_t cold_length = length - seq_hot_lengths_.at(seq_id);
+    size_t trimmable_length =
+        std::min(radix_tree_->GetSequenceExclusiveLength(seq_id), cold_length);
+    // The pages of the sequence are aligned from its start, so the kept length is rounded up.
+    size_t kept_length = (length - trimmable_length + kv_cache_page_size_ - 1) /
+                         kv_cache_page_size_ * kv_cache_page_size_;
+    return kept_length > 0 && kept_length < length ? length - kept_length : 0;
+  }
+
+  /*! \brief Remove a sequence from prefix cache, and call the remove callback. */
+  void RemoveSequence(int64_t seq_id) {
+    TenantPartition* partition = seq_tenant_partitions_.at(seq_id);
+    if (seq_states_.at(seq_id) == SequenceState::kRecycling) {
+      --partition->num_recycling_seqs;
+      partition->num_recycling_tokens -= radix_tree_->GetSequenceLength(seq_id);
+    }
+    radix_tree_->RemoveSequence(seq_id);
+    snapshot_dirty_ = true;
+    evictor_->RemoveSequence(seq_id);
+    if (remove_callback_ != nullptr) {
+      remove_callback_(seq_id);
+    }
+    CHECK(seq_states_.erase(seq_id));
+    CHECK(seq_sliding_window_infos_.erase(seq_id));
+    CHECK(seq_hot_lengths_.erase(seq_id));
+    CHECK(seq_tenant_partitions_.erase(seq_id));
+    shared_seqs_.erase(seq_id);
+    if (--partition->num_seqs == 0) {
+      // Drop the empty tenant partition, so that the filter of visible sequences can be skipped
+      // again when a single tenant remains.
+      for (auto it = tenant_partitions_.begin(); it != tenant_partitions_.end(); ++it) {
+        if (&it->second == partition) {
+          tenant_partitions_.erase(it);
+          break;
+        }
+      }
+    }
   }
 
   /*!
@@ -292,28 +530,32 @@ class PrefixCacheImpl : public PrefixCacheObj {
    */
   PagedRadixTree radix_tree_;
   /*!
-   * \brief The map from sequence to LRU time stamps.
-   */
-  std::unordered_map<int64_t, size_t> recycling_seq_lrus_;
-  /*!
-   * \brief The map from LRU time stamps to sequence, used to find the sequence with earliest LRU
-   * time stamp.
+   * \brief The evictor selecting the recycling sequence to remove, as per the eviction policy.
    */
-  std::unordered_map<size_t, int64_t> reversed_recycling_seq_lrus_;
+  std::unique_ptr<PrefixCacheEvictor> evictor_;
   /*!
    * \brief The maximum number of recycling sequences in prefix cache. Set -1 as infinite prefix
    * cache.
    */
   int max_num_recycling_seqs_ = -1;
-  /*!
-   * \brief The LRU counter.
-   */
-  size_t lru_counter_ = 0;
+  /*! \brief The quotas of each tenant partition. */
+  PrefixCacheTenantQuota tenant_quota_;
   /*!
    * \brief The callback function to call when removing a sequence. This can be used to
    * removing sequence in KVCache and return sequence ID to ID manager lazily
    */
   PrefixCacheRemoveCallback remove_callback_ = nullptr;
+  /*!
+   * \brief The callback function to call when trimming trailing tokens of a recycling sequence,
+   * which pops the tokens from KVCache.
+   */
+  PrefixCacheRollBackCallback rollback_callback_ = nullptr;
+  /*! \brief The KV cache page size, by which trailing tokens are trimmed. */
+  size_t kv_cache_page_size_;
+  /*!
+   * \brief The prefix cache metrics to update, which are owned by the engine metrics.
+   */
+  PrefixCacheMetrics* metrics_ = nullptr;
   /*!
    * \brief The map from sequence to its sequence states.
    */
@@ -325,6 +567,20 @@ class PrefixCacheImpl : public PrefixCacheObj {
    * non-negative and used when sliding window size is positive.
    */
   std::unordered_map<int64_t, std::pair<int, size_t>> seq_sliding_window_infos_;
+  /*!
+   * \brief The map from sequence to its hot prefix length, which is the longest prefix of the
+   * sequence matched by other requests, either by reusing or by forking.
+   */
+  std::unordered_map<int64_t, size_t> seq_hot_lengths_;
+  /*!
+   * \brief The map from tenant tag to its partition. The partition of a tenant is created with
+   * its first sequence and dropped with its last sequence. Pointers to partitions are stable.
+   */
+  std::unordered_map<std::string, TenantPartition> tenant_partitions_;
+  /*! \brief The map from sequence to its tenant partition. */
+  std::unordered_map<int64_t, TenantPartition*> seq_tenant_partitions_;
+  /*! \brief The sequences which can be matched by other tenants. */
+  std::unordered_set<int64_t> shared_seqs_;
   /*!
    * \brief The collection of uncommitted extended token ids of sequences.
    * The "ExtendSequence" method only lazily add token ids into this collection,
@@ -334,6 +590,11 @@ class PrefixCacheImpl : public PrefixCacheObj {
    * each action, to avoid the uncaught changes of uncomitted extended token ids.
    */
   std::vector<std::pair<int64_t, const std::vector<int32_t>&>> uncommitted_extended_token_ids_;
+  /*! \brief The last created snapshot of radix tree. */
+  PagedRadixTreeSnapshot snapshot_;
+  /*! \brief The flag if sequences have been recycled, trimmed, removed or rolled back since
+   * "snapshot_". Inserted sequences add no matchable token until they are extended. */
+  bool snapshot_dirty_ = true;
 };  // namespace serve
 
 TVM_REGISTER_OBJECT_TYPE(PrefixCacheImpl);
@@ -353,7 +614,9 @@ class NoPrefixCache : public PrefixCacheObj {
    * \return The matched result.
    */
   PrefixCacheMatchedResult InsertSequence(int64_t seq_id, std::vector<int32_t> tokens,
-                                          int sliding_window_size, int attention_sink_size) final {
+                                          int sliding_window_size, int attention_sink_size,
+                                          const std::string& tenant,
+                                          bool shared_across_tenants) final {
     // Since there is no prefix cache, always return as new sequence.
     return PrefixCacheMatchedResult{0, -1, -1, 0};
   }
@@ -416,6 +679,21 @@ class NoPrefixCache : public PrefixCacheObj {
     return false;
   }
 
+  /*!
+   * \brief Get the number of leading tokens of a sequence shared with other sequences.
+   * \param seq_id The sequence ID for index.
+   * \return Always return 0 as no sequence stored.
+   */
+  size_t GetSequenceSharedLength(int64_t seq_id) final { return 0; }
+
+  /*!
+   * \brief Export the token content of all sequences in prefix cache.
+   * \return The exported binary data of an empty radix tree.
+   */
+  std::string ExportBinary() final { return PagedRadixTree::Create()->ExportBinary(); }
+
+  PagedRadixTreeSnapshot CreateSnapshot() final { return PagedRadixTreeSnapshot(); }
+
   /*!
    * \brief Reset the prefix cache to initial status. Do nothing and return.
    */
@@ -427,9 +705,15 @@ class NoPrefixCache : public PrefixCacheObj {
 TVM_REGISTER_OBJECT_TYPE(NoPrefixCache);
 
 PrefixCache PrefixCache::CreateRadixPrefixCache(size_t max_num_recycling_seqs,
-                                                PrefixCacheRemoveCallback remove_callback) {
-  ObjectPtr<PrefixCacheImpl> n =
-      make_object<PrefixCacheImpl>(max_num_recycling_seqs, std::move(remove_callback));
+                                                PrefixCacheRemoveCallback remove_callback,
+                                                PrefixCacheRollBackCallback rollback_callback,
+                                                size_t kv_cache_page_size,
+                                                PrefixCacheEvictionPolicy eviction_policy,
+                                                PrefixCacheTenantQuota tenant_quota,
+                                                PrefixCacheMetrics* metrics) {
+  ObjectPtr<PrefixCacheImpl> n = make_object<PrefixCacheImpl>(
+      max_num_recycling_seqs, std::move(remove_callback), std::move(rollback_callback),
+      kv_cache_page_size, eviction_policy, tenant_quota, metrics);
   return PrefixCache(std::move(n));
 }
 
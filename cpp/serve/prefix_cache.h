@@ -10,9 +10,11 @@
 
 #include <functional>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "metrics.h"
 #include "model.h"
 #include "radix_tree.h"
 #include "request_state.h"
@@ -28,6 +30,22 @@ using namespace tvm::runtime;
  */
 using PrefixCacheRemoveCallback = std::function<void(int64_t)>;
 
+/*!
+ * \brief The signature of callback rolling back the given number of trailing tokens of a sequence.
+ */
+using PrefixCacheRollBackCallback = std::function<void(int64_t, size_t)>;
+
+/*!
+ * \brief The quotas of each tenant partition in prefix cache. A tenant beyond its quotas has its
+ * own recycling sequences evicted first. -1 means no quota.
+ */
+struct PrefixCacheTenantQuota {
+  /*! \brief The maximum number of recycling sequences of a tenant. */
+  int64_t max_num_recycling_seqs = -1;
+  /*! \brief The maximum total number of tokens of recycling sequences of a tenant. */
+  int64_t max_recycling_tokens = -1;
+};
+
 /*!
  * \brief The matched result from prefix cache. This result describes how to pre-process the new
  * sequence, to leverage the existing data in KVCache by reusing past sequences or forking from
@@ -62,11 +80,16 @@ class PrefixCacheObj : public Object {
    * \param sliding_window_size The sliding window size for the sequence, -1 as sliding window
    * disabled.
    * \param attention_sink_size The attention sink size for the sequence, 0 by default.
+   * \param tenant The tenant partition of the sequence. A sequence only matches the sequences of
+   * the same tenant, and the sequences shared across tenants.
+   * \param shared_across_tenants The flag if the sequence can be matched by other tenants.
    * \return The matched result.
    */
   virtual PrefixCacheMatchedResult InsertSequence(int64_t seq_id, std::vector<int32_t> tokens,
                                                   int sliding_window_size = -1,
-                                                  int attention_sink_size = 0) = 0;
+                                                  int attention_sink_size = 0,
+                                                  const std::string& tenant = "",
+                                                  bool shared_across_tenants = false) = 0;
 
   /*!
    * \brief Extend a sequence with new tokenized sequence suffix.
@@ -99,8 +122,11 @@ class PrefixCacheObj : public Object {
   virtual void RecycleSequence(int64_t seq_id, bool lazy = true) = 0;
 
   /*!
-   * \brief Try to remove recycling sequence to free up memory. It will remove the oldest recycling
-   sequence.
+   * \brief Try to free up memory from recycling sequences. The cold trailing tokens of recycling
+   * sequences, which are owned by no other sequence and have never been matched by other requests,
+   * are trimmed first, so that hot prefixes stay in cache. When no such tokens exist, a whole
+   * recycling sequence is removed. The recycling sequence to trim or remove is selected by the
+   * eviction policy.
    * \return The flag if there is a sequence removed. In other word, return true when memory is
    freed successfully.
    * \throw Error if the given sequence id is not valid.
@@ -115,6 +141,30 @@ class PrefixCacheObj : public Object {
    */
   virtual bool HasSequence(int64_t seq_id) = 0;
 
+  /*!
+   * \brief Get the number of leading tokens of a sequence shared with other sequences in prefix
+   * cache, whose KV data stays in KV cache when the sequence is removed.
+   * \param seq_id The sequence ID for index.
+   * \return The number of shared tokens, which is 0 if the sequence is not in prefix cache.
+   */
+  virtual size_t GetSequenceSharedLength(int64_t seq_id) = 0;
+
+  /*!
+   * \brief Export the token content of all sequences in prefix cache, in the binary format of
+   * "PagedRadixTreeObj::ExportBinary".
+   * \return The exported binary data.
+   */
+  virtual std::string ExportBinary() = 0;
+
+  /*!
+   * \brief Create an immutable snapshot of the sequences in prefix cache, which can be matched
+   * from other threads. The snapshot is rebuilt only when sequences have been recycled, trimmed,
+   * removed or rolled back since the last call, and extended tokens are picked up upon the next
+   * rebuild. A rebuild copies only the radix pages changed since the last snapshot.
+   * \return The snapshot, which is undefined when prefix cache is disabled.
+   */
+  virtual PagedRadixTreeSnapshot CreateSnapshot() = 0;
+
   /*!
    * \brief Reset the prefix cache to initial status.
    */
@@ -136,9 +186,19 @@ class PrefixCache : public ObjectRef {
    * \brief Initialization of prefix cache.
    * \param max_recycling_seqs The maximum number of recycling sequences in prefix cache.
    * \param remove_callback The optional callback function to call when removing a sequence.
+   * \param rollback_callback The optional callback function to call when trimming trailing tokens
+   * of a recycling sequence. Trimming is disabled when not provided.
+   * \param kv_cache_page_size The KV cache page size. Trailing tokens are trimmed in whole pages.
+   * \param eviction_policy The eviction policy of recycling sequences.
+   * \param tenant_quota The quotas of each tenant partition.
+   * \param metrics The optional prefix cache metrics to update, which should outlive the prefix
+   * cache.
    */
-  static PrefixCache CreateRadixPrefixCache(size_t max_recycling_seqs,
-                                            PrefixCacheRemoveCallback remove_callback = nullptr);
+  static PrefixCache CreateRadixPrefixCache(
+      size_t max_recycling_seqs, PrefixCacheRemoveCallback remove_callback = nullptr,
+      PrefixCacheRollBackCallback rollback_callback = nullptr, size_t kv_cache_page_size = 1,
+      PrefixCacheEvictionPolicy eviction_policy = PrefixCacheEvictionPolicy::kLRU,
+      PrefixCacheTenantQuota tenant_quota = {}, PrefixCacheMetrics* metrics = nullptr);
   /*!
    * \brief Initialization of no prefix cache.
    */
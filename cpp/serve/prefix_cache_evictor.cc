@@ -0,0 +1,227 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/prefix_cache_evictor.cc
+ */
+#include "prefix_cache_evictor.h"
+
+#include <algorithm>
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/****************** PrefixCacheEvictor ******************/
+
+void PrefixCacheEvictor::RecycleSequence(int64_t seq_id) {
+  CHECK(recycling_seq_lrus_.find(seq_id) == recycling_seq_lrus_.end());
+  ++lru_counter_;
+  recycling_seq_lrus_.emplace(seq_id, lru_counter_);
+  reversed_recycling_seq_lrus_.emplace(lru_counter_, seq_id);
+  seq_hits_.emplace(seq_id, 0);
+}
+
+void PrefixCacheEvictor::ReuseSequence(int64_t seq_id) {
+  size_t lru = recycling_seq_lrus_.at(seq_id);
+  CHECK_EQ(reversed_recycling_seq_lrus_.at(lru), seq_id);
+  CHECK(recycling_seq_lrus_.erase(seq_id));
+  CHECK(reversed_recycling_seq_lrus_.erase(lru));
+  ++seq_hits_[seq_id];
+}
+
+void PrefixCacheEvictor::HitSequence(int64_t seq_id) { ++seq_hits_[seq_id]; }
+
+void PrefixCacheEvictor::RemoveSequence(int64_t seq_id) {
+  auto it = recycling_seq_lrus_.find(seq_id);
+  if (it != recycling_seq_lrus_.end()) {
+    CHECK(reversed_recycling_seq_lrus_.erase(it->second));
+    recycling_seq_lrus_.erase(it);
+  }
+  seq_hits_.erase(seq_id);
+}
+
+void PrefixCacheEvictor::Reset() {
+  recycling_seq_lrus_.clear();
+  reversed_recycling_seq_lrus_.clear();
+  seq_hits_.clear();
+  lru_counter_ = 0;
+}
+
+/****************** LRU ******************/
+
+/*! \brief Evict the least recently recycled sequence. */
+class LRUPrefixCacheEvictor : public PrefixCacheEvictor {
+ public:
+  using PrefixCacheEvictor::PrefixCacheEvictor;
+
+  int64_t SelectVictim(const std::function<bool(int64_t)>& filter) final {
+    for (const auto& [lru, seq_id] : reversed_recycling_seq_lrus_) {
+      if (filter == nullptr || filter(seq_id)) {
+        return seq_id;
+      }
+    }
+    return -1;
+  }
+};
+
+/****************** LFU ******************/
+
+/*! \brief Evict the least frequently hit sequence, and the least recently recycled on ties. */
+class LFUPrefixCacheEvictor : public PrefixCacheEvictor {
+ public:
+  using PrefixCacheEvictor::PrefixCacheEvictor;
+
+  int64_t SelectVictim(const std::function<bool(int64_t)>& filter) final {
+    int64_t victim = -1;
+    size_t victim_hits = 0;
+    for (const auto& [lru, seq_id] : reversed_recycling_seq_lrus_) {
+      if (filter != nullptr && !filter(seq_id)) {
+        continue;
+      }
+      size_t hits = seq_hits_.at(seq_id);
+      if (victim == -1 || hits < victim_hits) {
+        victim = seq_id;
+        victim_hits = hits;
+      }
+    }
+    return victim;
+  }
+};
+
+/****************** GDSF ******************/
+
+/*!
+ * \brief The Greedy-Dual-Size-Frequency policy. The priority of a sequence is
+ * "L + frequency * cost / size", where the cost is the number of tokens to prefill again if the
+ * sequence is evicted and requested again, the size is the number of tokens freed by evicting
+ * it, and L is the inflation value when the sequence is last accessed. The cost counts the whole
+ * sequence, which is prefilled again for a request missing it in cache, while the size counts
+ * only its exclusive tokens, as its shared prefix stays in cache. Hence among sequences hit
+ * equally often, the ones freeing the most tokens relative to their length go first. L is raised
+ * to the priority of every evicted sequence, so that sequences that are not accessed for long are
+ * aged out eventually. Trimming the cold suffix of a sequence does not evict it, and keeps L.
+ */
+class GDSFPrefixCacheEvictor : public PrefixCacheEvictor {
+ public:
+  using PrefixCacheEvictor::PrefixCacheEvictor;
+
+  void RecycleSequence(int64_t seq_id) final {
+    PrefixCacheEvictor::RecycleSequence(seq_id);
+    seq_inflations_[seq_id] = inflation_;
+    victim_ = -1;
+  }
+
+  void ReuseSequence(int64_t seq_id) final {
+    PrefixCacheEvictor::ReuseSequence(seq_id);
+    seq_inflations_[seq_id] = inflation_;
+    victim_ = -1;
+  }
+
+  void HitSequence(int64_t seq_id) final {
+    PrefixCacheEvictor::HitSequence(seq_id);
+    seq_inflations_[seq_id] = inflation_;
+    victim_ = -1;
+  }
+
+  void RemoveSequence(int64_t seq_id) final {
+    if (seq_id == victim_) {
+      // The last selected victim is evicted rather than trimmed.
+      inflation_ = victim_priority_;
+    }
+    victim_ = -1;
+    PrefixCacheEvictor::RemoveSequence(seq_id);
+    seq_inflations_.erase(seq_id);
+  }
+
+  int64_t SelectVictim(const std::function<bool(int64_t)>& filter) final {
+    int64_t victim = -1;
+    double victim_priority = 0.0;
+    for (const auto& [lru, seq_id] : reversed_recycling_seq_lrus_) {
+      if (filter != nullptr && !filter(seq_id)) {
+        continue;
+      }
+      double frequency = static_cast<double>(seq_hits_.at(seq_id) + 1);
+      size_t exclusive_length = radix_tree_->GetSequenceExclusiveLength(seq_id);
+      // Evicting sequences sharing all their tokens costs no prefill, as they can be forked from
+      // the sequences sharing them again, and they go first.
+      double cost = exclusive_length == 0
+                        ? 0.0
+                        : static_cast<double>(radix_tree_->GetSequenceLength(seq_id));
+      double size = static_cast<double>(std::max<size_t>(exclusive_length, 1));
+      double priority = seq_inflations_.at(seq_id) + frequency * cost / size;
+      if (victim == -1 || priority < victim_priority) {
+        victim = seq_id;
+        victim_priority = priority;
+      }
+    }
+    victim_ = victim;
+    victim_priority_ = victim_priority;
+    return victim;
+  }
+
+  void Reset() final {
+    PrefixCacheEvictor::Reset();
+    seq_inflations_.clear();
+    inflation_ = 0.0;
+    victim_ = -1;
+  }
+
+ private:
+  /*! \brief The map from sequence to the inflation value when it is last accessed. */
+  std::unordered_map<int64_t, double> seq_inflations_;
+  /*! \brief The current inflation value L. */
+  double inflation_ = 0.0;
+  /*!
+   * \brief The last selected victim, which raises L to its priority only if it is removed next,
+   * or -1 if there is none.
+   */
+  int64_t victim_ = -1;
+  /*! \brief The priority of the last selected victim. */
+  double victim_priority_ = 0.0;
+};
+
+/****************** Max Freed Pages ******************/
+
+/*!
+ * \brief Evict the sequence which frees the most tokens, and hence the most KV cache pages, so
+ * that the fewest evictions are needed to free up memory.
+ */
+class MaxFreedPagesPrefixCacheEvictor : public PrefixCacheEvictor {
+ public:
+  using PrefixCacheEvictor::PrefixCacheEvictor;
+
+  int64_t SelectVictim(const std::function<bool(int64_t)>& filter) final {
+    int64_t victim = -1;
+    size_t victim_freed_length = 0;
+    for (const auto& [lru, seq_id] : reversed_recycling_seq_lrus_) {
+      if (filter != nullptr && !filter(seq_id)) {
+        continue;
+      }
+      size_t freed_length = radix_tree_->GetSequenceExclusiveLength(seq_id);
+      if (victim == -1 || freed_length > victim_freed_length) {
+        victim = seq_id;
+        victim_freed_length = freed_length;
+      }
+    }
+    return victim;
+  }
+};
+
+std::unique_ptr<PrefixCacheEvictor> PrefixCacheEvictor::Create(PrefixCacheEvictionPolicy policy,
+                                                               PagedRadixTree radix_tree) {
+  switch (policy) {
+    case PrefixCacheEvictionPolicy::kLRU:
+      return std::make_unique<LRUPrefixCacheEvictor>(std::move(radix_tree));
+    case PrefixCacheEvictionPolicy::kLFU:
+      return std::make_unique<LFUPrefixCacheEvictor>(std::move(radix_tree));
+    case PrefixCacheEvictionPolicy::kGDSF:
+      return std::make_unique<GDSFPrefixCacheEvictor>(std::move(radix_tree));
+    case PrefixCacheEvictionPolicy::kMaxFreedPages:
+      return std::make_unique<MaxFreedPagesPrefixCacheEvictor>(std::move(radix_tree));
+  }
+  LOG(FATAL) << "Invalid prefix cache eviction policy: " << static_cast<int>(policy);
+  throw;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,100 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/prefix_cache_evictor.h
+ */
+#ifndef MLC_LLM_SERVE_PREFIX_CACHE_EVICTOR_H_
+#define MLC_LLM_SERVE_PREFIX_CACHE_EVICTOR_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+#include "config.h"
+#include "radix_tree.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief The evictor of prefix cache, which decides the recycling sequence to remove when the
+ * prefix cache needs to free up memory or recycling sequence slots.
+ * The base class tracks the recycling sequences in the order of recycling, and the hit count of
+ * every sequence in prefix cache. The subclasses implement different eviction policies on top.
+ */
+class PrefixCacheEvictor {
+ public:
+  explicit PrefixCacheEvictor(PagedRadixTree radix_tree) : radix_tree_(std::move(radix_tree)) {}
+
+  virtual ~PrefixCacheEvictor() = default;
+
+  /*!
+   * \brief Create a prefix cache evictor of the given eviction policy.
+   * \param policy The eviction policy.
+   * \param radix_tree The radix tree of prefix cache, used to query the sequence lengths.
+   * \return The created evictor.
+   */
+  static std::unique_ptr<PrefixCacheEvictor> Create(PrefixCacheEvictionPolicy policy,
+                                                    PagedRadixTree radix_tree);
+
+  /*!
+   * \brief Mark a sequence as recycling, making it an eviction candidate.
+   * \param seq_id The recycled sequence ID.
+   */
+  virtual void RecycleSequence(int64_t seq_id);
+
+  /*!
+   * \brief Mark a recycling sequence as reused, which is no longer an eviction candidate.
+   * \param seq_id The reused sequence ID.
+   */
+  virtual void ReuseSequence(int64_t seq_id);
+
+  /*!
+   * \brief Record a hit on a sequence in prefix cache, e.g., when a new sequence forks from it.
+   * \param seq_id The hit sequence ID.
+   */
+  virtual void HitSequence(int64_t seq_id);
+
+  /*!
+   * \brief Stop tracking a sequence as it is removed from prefix cache.
+   * \param seq_id The removed sequence ID.
+   */
+  virtual void RemoveSequence(int64_t seq_id);
+
+  /*!
+   * \brief Select the recycling sequence to evict. The selected sequence is expected to be
+   * removed with "RemoveSequence" or trimmed right after.
+   * \param filter The filter of candidates, or nullptr to consider all recycling sequences.
+   * Otherwise only the recycling sequences for which the filter returns true are considered.
+   * \return The selected sequence ID, or -1 if there is no candidate.
+   */
+  virtual int64_t SelectVictim(const std::function<bool(int64_t)>& filter) = 0;
+
+  /*! \brief Return the number of recycling sequences. */
+  size_t NumRecyclingSequences() const { return recycling_seq_lrus_.size(); }
+
+  /*! \brief Reset the evictor to initial status. */
+  virtual void Reset();
+
+ protected:
+  /*! \brief The radix tree of prefix cache. */
+  PagedRadixTree radix_tree_;
+  /*! \brief The map from recycling sequence to its LRU time stamp. */
+  std::unordered_map<int64_t, size_t> recycling_seq_lrus_;
+  /*!
+   * \brief The ordered map from LRU time stamps to recycling sequence. Iterating over it visits
+   * recycling sequences from the least recently recycled one, which breaks ties of all policies.
+   */
+  std::map<size_t, int64_t> reversed_recycling_seq_lrus_;
+  /*! \brief The map from sequence to the number of times it is reused or forked from. */
+  std::unordered_map<int64_t, size_t> seq_hits_;
+  /*! \brief The LRU counter. */
+  size_t lru_counter_ = 0;
+};
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_PREFIX_CACHE_EVICTOR_H_
@@ -6,6 +6,10 @@
 
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 namespace mlc {
 namespace llm {
 namespace serve {
@@ -26,15 +30,14 @@ struct SequenceIDNode {
  * \brief The sequence ID node pool.
  *
  * The sequence ID node pool allocates a block of sequence ID nodes when pool is full,
- * and frees all when destruction, to avoid frequent memory operation.
+ * and frees all when destruction, to avoid frequent memory operation. The free nodes are chained
+ * by their "next" pointers as an intrusive free list, so that allocation and free are both O(1)
+ * pointer operations.
  */
 class SequenceIDNodePool {
  public:
   /*! \brief The constructor of sequence ID node pool, allocating a new sequence ID node block. */
-  SequenceIDNodePool() {
-    NewNodeBlock_();
-    used_nodes_.clear();
-  }
+  SequenceIDNodePool() { NewNodeBlock_(); }
 
   /*!
    * \brief Get a sequence ID node from pool, and assign the fields.
@@ -44,14 +47,11 @@ class SequenceIDNodePool {
    * \return The allocated radix page.
    */
   SequenceIDNode* Allocate(int64_t seq_id, SequenceIDNode* next) {
-    if (free_node_indices_.empty()) {
+    if (free_head_ == nullptr) {
       NewNodeBlock_();
-      CHECK(!free_node_indices_.empty());
     }
-    size_t id = free_node_indices_.back();
-    free_node_indices_.pop_back();
-    SequenceIDNode* node = nodes_[id];
-    used_nodes_[node] = id;
+    SequenceIDNode* node = free_head_;
+    free_head_ = node->next;
     node->id = seq_id;
     node->next = next;
     return node;
@@ -62,21 +62,20 @@ class SequenceIDNodePool {
    * \param node The sequence ID node to free.
    */
   void Free(SequenceIDNode* node) {
-    CHECK(used_nodes_.find(node) != used_nodes_.end());
-    free_node_indices_.push_back(used_nodes_[node]);
-    used_nodes_.erase(node);
+    // The free nodes are marked by sequence ID -1, which no sequence has, to catch double free.
+    CHECK_NE(node->id, -1) << "The sequence ID node is already freed.";
+    node->id = -1;
+    node->next = free_head_;
+    free_head_ = node;
   }
 
   /*!
    * \brief Reset the sequence ID node pool to initial status.
    */
   void Reset() {
-    used_nodes_.clear();
-    free_node_indices_.reserve(nodes_.size());
-    for (size_t i = 0; i < nodes_.size(); ++i) {
-      nodes_[i]->id = 0;
-      nodes_[i]->next = nullptr;
-      free_node_indices_[i] = i;
+    free_head_ = nullptr;
+    for (SequenceIDNode* node_block : node_blocks_) {
+      PushNodeBlock_(node_block);
     }
   }
 
@@ -92,22 +91,143 @@ class SequenceIDNodePool {
   static constexpr size_t kNodeBlockSize_ = 64;
   /*! \brief The raw sequence ID node block pool, each element is a sequence ID node array. */
   std::vector<SequenceIDNode*> node_blocks_;
-  /*! \brief The sequence ID node pool, each element is a sequence ID node pointer. */
-  std::vector<SequenceIDNode*> nodes_;
-  /*! \brief The indices of free sequence ID node in node pool. */
-  std::vector<size_t> free_node_indices_;
-  /*! \brief The map from used paged sequence ID node to its index in node pool. */
-  std::unordered_map<SequenceIDNode*, size_t> used_nodes_;
+  /*! \brief The head of free sequence ID node list, chained by "next" pointers. */
+  SequenceIDNode* free_head_ = nullptr;
 
   /*! \brief Allocate a new node pool block. */
   void NewNodeBlock_() {
-    size_t node_id_offset = node_blocks_.size() * kNodeBlockSize_;
     node_blocks_.push_back(new SequenceIDNode[kNodeBlockSize_]);
-    nodes_.reserve(nodes_.size() + kNodeBlockSize_);
-    free_node_indices_.reserve(free_node_indices_.size() + kNodeBlockSize_);
-    for (size_t i = 0; i < kNodeBlockSize_; ++i) {
-      nodes_.push_back(&node_blocks_.back()[i]);
-      free_node_indices_.push_back(i + node_id_offset);
+    PushNodeBlock_(node_blocks_.back());
+  }
+
+  /*! \brief Push all nodes of a node block to free list, so that they are allocated in order. */
+  void PushNodeBlock_(SequenceIDNode* node_block) {
+    for (size_t i = kNodeBlockSize_; i > 0; --i) {
+      node_block[i - 1].id = -1;
+      node_block[i - 1].next = free_head_;
+      free_head_ = &node_block[i - 1];
+    }
+  }
+};
+
+struct RadixPage;
+
+/*!
+ * \brief The open-addressing hash table from the first token of child page to child page.
+ *
+ * The hash table is only used by the radix pages with large fan-out, e.g. the root page when many
+ * sequences share nothing but the system prompt. The tokens and the pages are stored in two flat
+ * arrays with linear probing, so that a lookup only touches contiguous memory before reaching the
+ * matched child page.
+ */
+class RadixChildTable {
+ public:
+  /*! \brief The constructor of child table, allocating the minimum number of slots. */
+  RadixChildTable() { Rehash_(kMinNumSlots_); }
+
+  /*!
+   * \brief Find the child page indexed by first token.
+   * \param token The first token of child page.
+   * \return The child page, or nullptr if no such child page.
+   */
+  RadixPage* Find(int32_t token) const {
+    for (size_t i = Slot_(token);; i = (i + 1) & mask_) {
+      if (pages_[i] == nullptr) return nullptr;
+      if (tokens_[i] == token) return pages_[i];
+    }
+  }
+
+  /*!
+   * \brief Insert a child page indexed by first token.
+   * \param token The first token of child page.
+   * \param page The child page.
+   * \throw Error if there has been a child page indexed by the token.
+   */
+  void Insert(int32_t token, RadixPage* page) {
+    if ((size_ + 1) * 2 > pages_.size()) {
+      // Keep the load factor no more than 0.5, so that the probe sequence is short.
+      Rehash_(pages_.size() * 2);
+    }
+    size_t i = Slot_(token);
+    while (pages_[i] != nullptr) {
+      CHECK_NE(tokens_[i], token) << "Child page with first token " << token << " exists.";
+      i = (i + 1) & mask_;
+    }
+    tokens_[i] = token;
+    pages_[i] = page;
+    ++size_;
+  }
+
+  /*!
+   * \brief Erase the child page indexed by first token.
+   * \param token The first token of child page.
+   * \throw Error if there is no child page indexed by the token.
+   */
+  void Erase(int32_t token) {
+    size_t i = Slot_(token);
+    while (pages_[i] != nullptr && tokens_[i] != token) {
+      i = (i + 1) & mask_;
+    }
+    CHECK(pages_[i] != nullptr) << "Child page with first token " << token << " not found.";
+    // Backward shift the following entries in the same probe sequence, so that no tombstone is
+    // needed and the lookup can always stop at the first empty slot.
+    for (size_t j = (i + 1) & mask_; pages_[j] != nullptr; j = (j + 1) & mask_) {
+      size_t home = Slot_(tokens_[j]);
+      bool in_range = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+      if (in_range) continue;
+      tokens_[i] = tokens_[j];
+      pages_[i] = pages_[j];
+      i = j;
+    }
+    pages_[i] = nullptr;
+    --size_;
+  }
+
+  /*! \brief Get the number of child pages in table. */
+  size_t Size() const { return size_; }
+
+  /*!
+   * \brief Invoke the callback function for each first token and child page in table.
+   * \param f The callback function.
+   */
+  template <class CallbackFunc>
+  void ForEach(CallbackFunc f) const {
+    for (size_t i = 0; i < pages_.size(); ++i) {
+      if (pages_[i] != nullptr) f(tokens_[i], pages_[i]);
+    }
+  }
+
+ private:
+  /*! \brief The minimum number of slots, which should be power of 2. */
+  static constexpr size_t kMinNumSlots_ = 16;
+  /*! \brief The first tokens of child pages in slots. */
+  std::vector<int32_t> tokens_;
+  /*! \brief The child pages in slots, nullptr as empty slot. */
+  std::vector<RadixPage*> pages_;
+  /*! \brief The number of child pages in table. */
+  size_t size_ = 0;
+  /*! \brief The mask to wrap slot index, which equals number of slots minus 1. */
+  size_t mask_ = 0;
+  /*! \brief The right shift to take the high bits of hash as slot index. */
+  int shift_ = 32;
+
+  /*! \brief Get the home slot index of given token with Fibonacci hashing. */
+  size_t Slot_(int32_t token) const {
+    return (static_cast<uint32_t>(token) * 2654435769u) >> shift_;
+  }
+
+  /*! \brief Reallocate the slots and reinsert all the child pages. */
+  void Rehash_(size_t num_slots) {
+    std::vector<int32_t> old_tokens = std::move(tokens_);
+    std::vector<RadixPage*> old_pages = std::move(pages_);
+    tokens_.assign(num_slots, 0);
+    pages_.assign(num_slots, nullptr);
+    mask_ = num_slots - 1;
+    shift_ = 32;
+    for (size_t n = num_slots; n > 1; n >>= 1) --shift_;
+    size_ = 0;
+    for (size_t i = 0; i < old_pages.size(); ++i) {
+      if (old_pages[i] != nullptr) Insert(old_tokens[i], old_pages[i]);
     }
   }
 };
@@ -122,7 +242,10 @@ class SequenceIDNodePool {
  * stored prefix tokens.
  *
  * And since the vocabulary size may be very large, the paged Radix tree is represented
- * as left-child, right-sibling binary tree.
+ * as left-child, right-sibling binary tree. The sibling linked list is used for traversal only.
+ * The child lookup by first token goes through the child index instead, which is a small inline
+ * array in page when there are only a few child pages, and switches to a hash table when the
+ * number of child pages exceeds the inline array size.
  *
  * Also, due to possible pop/push front/back tokens in page, the page is designed as circular
  * buffer, to make full use of each page.
@@ -131,6 +254,8 @@ class SequenceIDNodePool {
  * all sequences locate in the boundary of each page, or the end of each page.
  */
 struct RadixPage {
+  /*! \brief The maximum number of child pages indexed by the inline array. */
+  static constexpr size_t kNumInlineChildren = 4;
   /*! \brief The parent page. */
   RadixPage* parent;
   /*! \brief The first child page. */
@@ -139,6 +264,14 @@ struct RadixPage {
   RadixPage* next_sibling;
   /*! \brief The head of sequence ID linked list. */
   SequenceIDNode* seq_ids;
+  /*! \brief The child hash table, or nullptr if the child pages are indexed by inline array. */
+  RadixChildTable* child_table;
+  /*! \brief The inline array of child pages, valid when child table is nullptr. */
+  RadixPage* inline_children[kNumInlineChildren];
+  /*! \brief The first tokens of inline child pages, valid when child table is nullptr. */
+  int32_t inline_child_tokens[kNumInlineChildren];
+  /*! \brief The number of child pages. */
+  size_t num_children;
   /*! \brief The capacity of maximum stored prefix tokens. */
   size_t capacity;
   /*! \brief The start offset of stored prefix tokens. The legal value is of [0, capacity). */
@@ -146,9 +279,11 @@ struct RadixPage {
   /*! \brief The length of stored prefix tokens. The legal value is of [0, capacity). */
   size_t length;
   /*! \brief The offset of first prefix token in memory layout. */
-  static constexpr int kDataOffset = (sizeof(RadixPage*) * 3 + sizeof(SequenceIDNode*) +
-                                      sizeof(size_t) * 3 + sizeof(int32_t) - 1) /
-                                     sizeof(int32_t);
+  static constexpr int kDataOffset =
+      (sizeof(RadixPage*) * (3 + kNumInlineChildren) + sizeof(SequenceIDNode*) +
+       sizeof(RadixChildTable*) + sizeof(int32_t) * kNumInlineChildren + sizeof(size_t) * 4 +
+       sizeof(int32_t) - 1) /
+      sizeof(int32_t);
 
   /*!
    * \brief Overload operator [] to get the prefix tokens by index as simple int array.
@@ -282,18 +417,38 @@ struct RadixPage {
    */
   RadixPage* FindChild(int64_t first_token) {
     int32_t casted = first_token;
-    // Iterate all child radix pages, as the child radix pages are stored unorderly.
-    for (RadixPage* child = first_child; child; child = child->next_sibling) {
-      if ((*child)[0] == casted) return child;
+    if (child_table) return child_table->Find(casted);
+    // Scan the inline array, whose first tokens are contiguous in page memory.
+    for (size_t i = 0; i < num_children; ++i) {
+      if (inline_child_tokens[i] == casted) return inline_children[i];
     }
     return nullptr;
   }
 
-  /*! \brief Insert a new child page. */
+  /*!
+   * \brief Insert a new child page. The child page should not be empty, as it is indexed by its
+   * first token.
+   */
   void InsertChild(RadixPage* child) {
+    CHECK_GT(child->length, 0);
     child->parent = this;
     child->next_sibling = first_child;
     first_child = child;
+    int32_t first_token = (*child)[0];
+    if (child_table == nullptr && num_children < kNumInlineChildren) {
+      inline_child_tokens[num_children] = first_token;
+      inline_children[num_children] = child;
+    } else {
+      if (child_table == nullptr) {
+        // The inline array is full, switch to the child hash table.
+        child_table = new RadixChildTable();
+        for (size_t i = 0; i < num_children; ++i) {
+          child_table->Insert(inline_child_tokens[i], inline_children[i]);
+        }
+      }
+      child_table->Insert(first_token, child);
+    }
+    ++num_children;
   }
 
   /*!
@@ -307,6 +462,62 @@ struct RadixPage {
     } else {
       child->GetLastSibling()->next_sibling = child->next_sibling;
     }
+    int32_t first_token = (*child)[0];
+    --num_children;
+    if (child_table) {
+      child_table->Erase(first_token);
+      if (num_children <= kNumInlineChildren / 2) {
+        // Switch back to the inline array. The threshold is lower than the inline array size, to
+        // avoid allocating and freeing child hash table repeatedly.
+        size_t i = 0;
+        child_table->ForEach([this, &i](int32_t token, RadixPage* page) {
+          inline_child_tokens[i] = token;
+          inline_children[i] = page;
+          ++i;
+        });
+        delete child_table;
+        child_table = nullptr;
+      }
+      return;
+    }
+    for (size_t i = 0; i <= num_children; ++i) {
+      if (inline_children[i] == child) {
+        inline_child_tokens[i] = inline_child_tokens[num_children];
+        inline_children[i] = inline_children[num_children];
+        return;
+      }
+    }
+    LOG(FATAL) << "Child page not found in child index.";
+  }
+
+  /*! \brief Detach all child pages from current page, without changing the child pages. */
+  void ClearChildren() {
+    delete child_table;
+    child_table = nullptr;
+    first_child = nullptr;
+    num_children = 0;
+  }
+
+  /*!
+   * \brief Move all child pages of another page to current page, including the child index.
+   * \param other The page whose child pages are moved. It has no child page after moving.
+   * \throw Error if current page has child page.
+   */
+  void TakeChildren(RadixPage* other) {
+    CHECK_EQ(num_children, 0);
+    first_child = other->first_child;
+    child_table = other->child_table;
+    num_children = other->num_children;
+    for (size_t i = 0; i < kNumInlineChildren; ++i) {
+      inline_child_tokens[i] = other->inline_child_tokens[i];
+      inline_children[i] = other->inline_children[i];
+    }
+    for (RadixPage* p = first_child; p; p = p->next_sibling) {
+      p->parent = this;
+    }
+    other->first_child = nullptr;
+    other->child_table = nullptr;
+    other->num_children = 0;
   }
 
   /*!
@@ -343,6 +554,9 @@ struct RadixPage {
   }
 };
 
+static_assert(sizeof(RadixPage) <= RadixPage::kDataOffset * sizeof(int32_t),
+              "The prefix tokens should not overlap with the page information.");
+
 /*!
  * \brief The paged radix tree page pool.
  *
@@ -352,10 +566,7 @@ struct RadixPage {
 class RadixPagePool {
  public:
   /*! \brief The constructor of paged radix tree page pool, allocating memory for each page. */
-  RadixPagePool() {
-    NewPageBlock_();
-    used_pages_.clear();
-  }
+  RadixPagePool() { NewPageBlock_(); }
 
   /*!
    * \brief Get a radix page from pool.
@@ -363,18 +574,18 @@ class RadixPagePool {
    * \return The allocated radix page.
    */
   RadixPage* Allocate() {
-    if (free_page_indices_.empty()) {
+    if (free_head_ == nullptr) {
       NewPageBlock_();
-      CHECK(!free_page_indices_.empty());
     }
-    int id = free_page_indices_.back();
-    free_page_indices_.pop_back();
-    RadixPage* page = pages_[id];
-    used_pages_[page] = id;
+    RadixPage* page = free_head_;
+    free_head_ = page->next_sibling;
+    --num_free_pages_;
     page->parent = page->first_child = page->next_sibling = nullptr;
     page->capacity = kPageCapacity_;
     page->offset = page->length = 0;
     page->seq_ids = nullptr;
+    page->child_table = nullptr;
+    page->num_children = 0;
     return page;
   }
 
@@ -384,35 +595,42 @@ class RadixPagePool {
    */
   void Free(RadixPage* page) {
     CHECK_EQ(page->seq_ids, nullptr);
-    CHECK(used_pages_.find(page) != used_pages_.end());
-    free_page_indices_.push_back(used_pages_[page]);
-    CHECK(used_pages_.erase(page));
+    CHECK_EQ(page->num_children, 0);
+    // The free pages are marked by zero capacity, to catch double free.
+    CHECK_NE(page->capacity, 0) << "The radix page is already freed.";
+    PushPage_(page);
   }
 
   /*!
    * \brief Get the token capacity of free pages.
    * \return The the token capacity of free pages.
    */
-  size_t FreeCapacity() { return free_page_indices_.size() * kPageCapacity_; }
+  size_t FreeCapacity() { return num_free_pages_ * kPageCapacity_; }
 
   /*!
    * \brief Reset the paged radix tree page pool to initial status.
    */
   void Reset() {
-    used_pages_.clear();
-    free_page_indices_.reserve(pages_.size());
-    for (int i = 0; i < pages_.size(); ++i) {
-      pages_[i]->parent = pages_[i]->first_child = pages_[i]->next_sibling = nullptr;
-      pages_[i]->capacity = kPageCapacity_;
-      pages_[i]->offset = pages_[i]->length = 0;
-      pages_[i]->seq_ids = nullptr;
-      free_page_indices_[i] = i;
+    free_head_ = nullptr;
+    num_free_pages_ = 0;
+    for (int32_t* page_block : page_blocks_) {
+      for (size_t i = kPageBlockSize_; i > 0; --i) {
+        RadixPage* page = reinterpret_cast<RadixPage*>(page_block + (i - 1) * kPageSize_);
+        page->parent = nullptr;
+        page->ClearChildren();
+        page->offset = page->length = 0;
+        page->seq_ids = nullptr;
+        PushPage_(page);
+      }
     }
   }
 
   /*! \brief The destructor of paged radix tree page pool, freeing memory for each page. */
   ~RadixPagePool() {
     for (int32_t* page_block : page_blocks_) {
+      for (size_t i = 0; i < kPageBlockSize_; ++i) {
+        delete reinterpret_cast<RadixPage*>(page_block + i * kPageSize_)->child_table;
+      }
       delete[] page_block;
     }
   }
@@ -427,23 +645,29 @@ class RadixPagePool {
   /*! \brief The raw paged radix tree page block pool,
   each element is a raw paged radix tree page array. */
   std::vector<int32_t*> page_blocks_;
-  /*! \brief The paged radix tree page pool,
-  each element is a raw paged radix tree page pointer. */
-  std::vector<RadixPage*> pages_;
-  /*! \brief The indices of free paged radix page in page pool. */
-  std::vector<size_t> free_page_indices_;
-  /*! \brief The map from used paged radix tree page to its index in page pool. */
-  std::unordered_map<RadixPage*, size_t> used_pages_;
+  /*! \brief The head of free radix page list, chained by "next_sibling" pointers. */
+  RadixPage* free_head_ = nullptr;
+  /*! \brief The number of free radix pages. */
+  size_t num_free_pages_ = 0;
+
+  /*! \brief Push a page to the free list, marking it as free by zero capacity. */
+  void PushPage_(RadixPage* page) {
+    page->capacity = 0;
+    page->next_sibling = free_head_;
+    free_head_ = page;
+    ++num_free_pages_;
+  }
 
   /*! \brief Allocate a new page pool block. */
   void NewPageBlock_() {
-    size_t page_id_offset = page_blocks_.size() * kPageBlockSize_;
     page_blocks_.push_back(new int32_t[kPageBlockSize_ * kPageSize_]);
-    pages_.reserve(pages_.size() + kPageBlockSize_);
-    free_page_indices_.reserve(free_page_indices_.size() + kPageBlockSize_);
-    for (size_t i = 0; i < kPageBlockSize_; ++i) {
-      pages_.push_back(reinterpret_cast<RadixPage*>(page_blocks_.back() + i * kPageSize_));
-      free_page_indices_.push_back(i + page_id_offset);
+    for (size_t i = kPageBlockSize_; i > 0; --i) {
+      RadixPage* page = reinterpret_cast<RadixPage*>(page_blocks_.back() + (i - 1) * kPageSize_);
+      // The child table is initialized here since it is freed when resetting and destructing.
+      page->child_table = nullptr;
+      page->num_children = 0;
+      page->first_child = nullptr;
+      PushPage_(page);
     }
   }
 };
@@ -472,6 +696,8 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
     root->parent = root->first_child = root->next_sibling = nullptr;
     root->offset = root->length = root->capacity = 0;
     root->seq_ids = nullptr;
+    root->child_table = nullptr;
+    root->num_children = 0;
   }
 
   /*!
@@ -505,14 +731,29 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
   /*!
    * \brief Get all sequences with longest common prefix with give prefix tokens.
    * \param tokens The prefix tokens for reference.
+   * \param filter The filter of sequences, or nullptr to match all sequences.
    * \return The pair of matched prefix length and the array of matched sequences indices.
    */
-  std::pair<size_t, std::vector<int64_t>> MatchPrefix(const std::vector<int32_t>& tokens) {
+  std::pair<size_t, std::vector<int64_t>> MatchPrefix(const std::vector<int32_t>& tokens,
+                                                      const std::function<bool(int64_t)>& filter) {
     const int32_t* prefix = tokens.data();
     size_t length = tokens.size();
     auto [page, offset, in_page_offset] = MatchSequence(root, prefix, length);
     if (!offset) return std::make_pair(0, std::vector<int64_t>());
-    return std::make_pair(offset, page->FindAllChildSequence());
+    if (filter == nullptr) return std::make_pair(offset, page->FindAllChildSequence());
+    // Back off along the matched path, until reaching a page whose sub-tree has any sequence
+    // passing the filter. The sequences in the sub-tree share the prefix ending at that page.
+    while (page != root) {
+      std::vector<int64_t> seq_ids = page->FindAllChildSequence();
+      seq_ids.erase(std::remove_if(seq_ids.begin(), seq_ids.end(),
+                                   [&filter](int64_t seq_id) { return !filter(seq_id); }),
+                    seq_ids.end());
+      if (!seq_ids.empty()) return std::make_pair(offset, std::move(seq_ids));
+      offset -= in_page_offset;
+      page = page->parent;
+      in_page_offset = page->length;
+    }
+    return std::make_pair(0, std::vector<int64_t>());
   }
 
   /*!
@@ -530,6 +771,29 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
     return length;
   }
 
+  /*!
+   * \brief Get the number of tokens exclusively owned by a sequence, which are not shared with
+   * any other sequence. These tokens are released when the sequence is removed.
+   * \param seq_id The sequence ID for index.
+   * \return The number of exclusively owned tokens.
+   * \throw Error if sequence ID is not valid.
+   */
+  size_t GetSequenceExclusiveLength(int64_t seq_id) {
+    CHECK(seq2page.find(seq_id) != seq2page.end());
+    RadixPage* page = seq2page[seq_id];
+    // The last page is shared with other sequences, or is the prefix of its child pages.
+    if (page->seq_ids->next || page->first_child) return 0;
+    // Walk up the same path as "RemoveSequence" would free pages along.
+    size_t length = 0;
+    while (page->parent) {
+      length += page->length;
+      RadixPage* parent = page->parent;
+      if (parent->seq_ids || parent->num_children > 1) break;
+      page = parent;
+    }
+    return length;
+  }
+
   /*!
    * \brief Fork a sequence from parent sequence at given position.
    * \param seq_id The new sequence ID.
@@ -592,17 +856,24 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
     if (offset < length && !page->seq_ids && !page->first_child && page->capacity > page->length) {
       // Extend in the existing leaf page first if possible.
       size_t suffix_length = std::min(page->capacity - page->length, length - offset);
+      // An empty page gets its first token, by which the parent page sorts its children.
+      if (page->length == 0 && page->parent != nullptr) {
+        OnChildrenChanged(page->parent);
+      }
       page->Extend(suffix + offset, suffix_length);
       offset += suffix_length;
+      OnPageChanged(page);
     }
     while (offset < length) {
       // Allocate new radix page and extend tokens
       RadixPage* new_page = radix_page_pool->Allocate();
+      size_t suffix_length = std::min(new_page->capacity - new_page->length, length - offset);
+      new_page->Extend(suffix + offset, suffix_length);
+      offset += suffix_length;
+      // Insert the child page after extending, as the child page is indexed by its first token.
       page->InsertChild(new_page);
+      OnChildrenChanged(page);
       page = new_page;
-      size_t suffix_length = std::min(page->capacity - page->length, length - offset);
-      page->Extend(suffix + offset, suffix_length);
-      offset += suffix_length;
     }
     page->AddSequence(seq_id_node_pool, seq_id);
     seq2page[seq_id] = page;
@@ -639,13 +910,15 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
       if (page->seq_ids == nullptr && page->first_child == nullptr) {
         // The leaf page is removable
         parent->RemoveChild(page);
-        radix_page_pool->Free(page);
+        OnChildrenChanged(parent);
+        FreePage(page);
       }
       page = parent;
     }
     if (page->seq_ids == nullptr && page->first_child == nullptr) {
       // The page is leaf page, directly roll back in page length
       page->length -= num_tokens;
+      OnPageChanged(page);
       // Update the mapping from sequence to page
       page->AddSequence(seq_id_node_pool, seq_id);
       seq2page[seq_id] = page;
@@ -672,7 +945,8 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
     while (page->parent && !page->seq_ids && !page->first_child) {
       RadixPage* parent = page->parent;
       parent->RemoveChild(page);
-      radix_page_pool->Free(page);
+      OnChildrenChanged(parent);
+      FreePage(page);
       page = parent;
     }
     if (page && page->Mergeable()) {
@@ -687,23 +961,255 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
    */
   size_t FreeCapacity() { return radix_page_pool->FreeCapacity(); }
 
+  /*!
+   * \brief Export the structure and token content of the paged radix tree into a compact binary
+   * format. The binary data is in host byte order and consists of
+   * - the header: the magic number and the format version, both uint32_t;
+   * - the number of pages, as uint32_t, including the root page;
+   * - the pages in pre-order, each as its parent index (int32_t, -1 for root), the number of
+   *   tokens (uint32_t), the tokens (int32_t), the number of sequences (uint32_t) and the sequence
+   *   IDs (int64_t) ending at the page.
+   * \return The exported binary data.
+   */
+  std::string ExportBinary() {
+    std::string data;
+    auto write = [&data](const void* ptr, size_t size) {
+      data.append(reinterpret_cast<const char*>(ptr), size);
+    };
+    uint32_t header[2] = {kBinaryMagic_, kBinaryVersion_};
+    write(header, sizeof(header));
+    size_t num_pages_pos = data.size();
+    uint32_t num_pages = 0;
+    write(&num_pages, sizeof(num_pages));
+    // Pre-order traversal, so that the parent page is always written before its child pages.
+    std::vector<std::pair<RadixPage*, int32_t>> stack{{root, -1}};
+    while (!stack.empty()) {
+      auto [page, parent_index] = stack.back();
+      stack.pop_back();
+      int32_t index = num_pages++;
+      uint32_t length = page->length;
+      write(&parent_index, sizeof(parent_index));
+      write(&length, sizeof(length));
+      for (size_t i = 0; i < length; ++i) {
+        int32_t token = (*page)[i];
+        write(&token, sizeof(token));
+      }
+      std::vector<int64_t> seq_ids = page->GetLocalSequence();
+      uint32_t num_seqs = seq_ids.size();
+      write(&num_seqs, sizeof(num_seqs));
+      write(seq_ids.data(), sizeof(int64_t) * num_seqs);
+      for (RadixPage* child = page->first_child; child; child = child->next_sibling) {
+        stack.emplace_back(child, index);
+      }
+    }
+    std::memcpy(&data[num_pages_pos], &num_pages, sizeof(num_pages));
+    return data;
+  }
+
+  /*!
+   * \brief Import the sequences from binary data exported by "ExportBinary".
+   * \param data The binary data to import.
+   * \return The imported sequence IDs.
+   * \throw Error if the data is malformed, or any imported sequence ID already exists.
+   */
+  std::vector<int64_t> ImportBinary(const std::string& data) {
+    size_t pos = 0;
+    auto read = [&data, &pos](void* ptr, size_t size) {
+      CHECK_LE(pos + size, data.size()) << "Radix tree binary data is truncated.";
+      if (size > 0) {
+        std::memcpy(ptr, data.data() + pos, size);
+      }
+      pos += size;
+    };
+    uint32_t header[2];
+    read(header, sizeof(header));
+    CHECK_EQ(header[0], kBinaryMagic_) << "Invalid radix tree binary data.";
+    CHECK_EQ(header[1], kBinaryVersion_) << "Unsupported radix tree binary version " << header[1];
+    uint32_t num_pages;
+    read(&num_pages, sizeof(num_pages));
+    // The parent index and token range in "tokens" of each page.
+    std::vector<int32_t> page_parents;
+    std::vector<std::pair<size_t, size_t>> page_token_ranges;
+    std::vector<int32_t> tokens;
+    std::vector<std::pair<int64_t, int32_t>> seq_pages;
+    for (uint32_t i = 0; i < num_pages; ++i) {
+      int32_t parent_index;
+      uint32_t length;
+      read(&parent_index, sizeof(parent_index));
+      read(&length, sizeof(length));
+      CHECK(i == 0 ? parent_index == -1
+                   : (parent_index >= 0 && parent_index < static_cast<int32_t>(i)))
+          << "Invalid parent page index " << parent_index << " of page " << i;
+      page_parents.push_back(parent_index);
+      page_token_ranges.emplace_back(tokens.size(), tokens.size() + length);
+      tokens.resize(tokens.size() + length);
+      read(tokens.data() + page_token_ranges.back().first, sizeof(int32_t) * length);
+      uint32_t num_seqs;
+      read(&num_seqs, sizeof(num_seqs));
+      for (uint32_t j = 0; j < num_seqs; ++j) {
+        int64_t seq_id;
+        read(&seq_id, sizeof(seq_id));
+        seq_pages.emplace_back(seq_id, i);
+      }
+    }
+    CHECK_EQ(pos, data.size()) << "Radix tree binary data has trailing bytes.";
+    for (const auto& [seq_id, page_index] : seq_pages) {
+      CHECK(seq2page.find(seq_id) == seq2page.end())
+          << "The imported sequence " << seq_id << " already exists.";
+    }
+    std::vector<int64_t> seq_ids;
+    seq_ids.reserve(seq_pages.size());
+    for (const auto& [seq_id, page_index] : seq_pages) {
+      std::vector<int32_t> path;
+      for (int32_t i = page_index; i != -1; i = page_parents[i]) {
+        path.push_back(i);
+      }
+      std::vector<int32_t> seq_tokens;
+      for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        auto [begin, end] = page_token_ranges[*it];
+        seq_tokens.insert(seq_tokens.end(), tokens.begin() + begin, tokens.begin() + end);
+      }
+      // Sequences with common prefix share pages again, as "ExtendSequence" matches the existing
+      // pages first.
+      AddSequence(seq_id);
+      if (!seq_tokens.empty()) {
+        ExtendSequence(seq_id, seq_tokens);
+      }
+      seq_ids.push_back(seq_id);
+    }
+    return seq_ids;
+  }
+
+  /*!
+   * \brief Create an immutable snapshot of the paged radix tree. Only the pages changed since the
+   * last snapshot and their ancestors get new nodes, and the other nodes are shared.
+   * \return The created snapshot.
+   */
+  PagedRadixTreeSnapshot CreateSnapshot() {
+    using Node = PagedRadixTreeSnapshotObj::Node;
+    // Build the missing nodes in post-order with an explicit stack, as long sequences make deep
+    // trees.
+    std::vector<std::pair<RadixPage*, bool>> stack{{root, false}};
+    while (!stack.empty()) {
+      auto [page, expanded] = stack.back();
+      PageSnapshot& page_snapshot = page_snapshots_[page];
+      if (page_snapshot.node != nullptr) {
+        stack.pop_back();
+        continue;
+      }
+      if (!expanded) {
+        if (page_snapshot.children_changed) {
+          // Empty pages cannot be matched by the first token.
+          page_snapshot.sorted_children.clear();
+          for (RadixPage* child = page->first_child; child; child = child->next_sibling) {
+            if (child->length > 0) page_snapshot.sorted_children.push_back(child);
+          }
+          std::sort(page_snapshot.sorted_children.begin(), page_snapshot.sorted_children.end(),
+                    [](RadixPage* lhs, RadixPage* rhs) { return (*lhs)[0] < (*rhs)[0]; });
+          page_snapshot.children_changed = false;
+        }
+        stack.back().second = true;
+        for (RadixPage* child : page_snapshot.sorted_children) {
+          auto it = page_snapshots_.find(child);
+          if (it == page_snapshots_.end() || it->second.node == nullptr) {
+            stack.emplace_back(child, false);
+          }
+        }
+        continue;
+      }
+      stack.pop_back();
+      auto node = std::make_shared<Node>();
+      node->tokens.reserve(page->length);
+      for (size_t i = 0; i < page->length; ++i) {
+        node->tokens.push_back((*page)[i]);
+      }
+      node->children.reserve(page_snapshot.sorted_children.size());
+      for (RadixPage* child : page_snapshot.sorted_children) {
+        node->children.push_back(page_snapshots_.at(child).node);
+      }
+      page_snapshot.node = std::move(node);
+    }
+    const std::shared_ptr<const Node>& root_node = page_snapshots_.at(root).node;
+    if (!snapshot_.defined() || snapshot_->root != root_node) {
+      ObjectPtr<PagedRadixTreeSnapshotObj> n = make_object<PagedRadixTreeSnapshotObj>();
+      n->root = root_node;
+      n->version = ++snapshot_version_counter_;
+      snapshot_ = PagedRadixTreeSnapshot(n);
+    }
+    return snapshot_;
+  }
+
   void Reset() {
     radix_page_pool->Reset();
     seq_id_node_pool->Reset();
     seq2page.clear();
-    root->parent = root->first_child = root->next_sibling = nullptr;
+    page_snapshots_.clear();
+    snapshot_ = PagedRadixTreeSnapshot();
+    root->parent = root->next_sibling = nullptr;
+    root->ClearChildren();
     root->offset = root->length = root->capacity = 0;
     root->seq_ids = nullptr;
   }
 
   /*! \brief The destructor to free root page. */
   ~PagedRadixTreeImpl() {
+    delete root->child_table;
     delete[] reinterpret_cast<int32_t*>(root);
     delete seq_id_node_pool;
     delete radix_page_pool;
   }
 
  private:
+  /*! \brief The magic number of exported binary data, "MLRT" in little endian. */
+  static constexpr const uint32_t kBinaryMagic_ = 0x54524C4D;
+  /*! \brief The version of exported binary format. */
+  static constexpr const uint32_t kBinaryVersion_ = 1;
+
+  /*! \brief The snapshot node of a page, which is shared by snapshots until the page changes. */
+  struct PageSnapshot {
+    /*! \brief The snapshot node, or nullptr if the page or any descendant page has changed. */
+    std::shared_ptr<const PagedRadixTreeSnapshotObj::Node> node;
+    /*! \brief The non-empty child pages sorted by first token. */
+    std::vector<RadixPage*> sorted_children;
+    /*! \brief The flag if the child pages have changed since "sorted_children" was sorted. */
+    bool children_changed = true;
+  };
+  /*!
+   * \brief The snapshot nodes of pages. If a page has no valid node, neither has any ancestor
+   * page, so that marking a page changed stops at the first ancestor already marked.
+   */
+  std::unordered_map<const RadixPage*, PageSnapshot> page_snapshots_;
+  /*! \brief The last created snapshot. */
+  PagedRadixTreeSnapshot snapshot_;
+  /*! \brief The version of the last snapshot created by any radix tree. */
+  static std::atomic<uint64_t> snapshot_version_counter_;
+
+  /*! \brief Mark the tokens of a page changed, which invalidates its snapshot node and ancestors. */
+  void OnPageChanged(RadixPage* page) {
+    for (; page != nullptr; page = page->parent) {
+      auto it = page_snapshots_.find(page);
+      if (it == page_snapshots_.end() || it->second.node == nullptr) {
+        break;
+      }
+      it->second.node = nullptr;
+    }
+  }
+
+  /*! \brief Mark the child pages or the tokens of a page changed. */
+  void OnChildrenChanged(RadixPage* page) {
+    auto it = page_snapshots_.find(page);
+    if (it != page_snapshots_.end()) {
+      it->second.children_changed = true;
+    }
+    OnPageChanged(page);
+  }
+
+  /*! \brief Free a page to pool, dropping its snapshot node as the page may be reused. */
+  void FreePage(RadixPage* page) {
+    page_snapshots_.erase(page);
+    radix_page_pool->Free(page);
+  }
+
   /*!
    * \brief Merge a radix tree page with its child radix tree page, to save radix tree page.
    * e.g. MergePage([1, 2, _, _, _] -> [3, 4, 5, _, _]) = [1, 2, 3, 4, 5].
@@ -717,15 +1223,14 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
       (*page)[i + page->length] = (*child)[i];
     }
     page->length += child->length;
-    page->first_child = child->first_child;
-    for (RadixPage* p = child->first_child; p; p = p->next_sibling) {
-      p->parent = page;
-    }
+    page->ClearChildren();
+    page->TakeChildren(child);
+    OnChildrenChanged(page);
     page->seq_ids = child->seq_ids;
     std::vector<int64_t> seq_ids = page->GetLocalSequence();
     for (int64_t id : seq_ids) seq2page[id] = page;
     child->seq_ids = nullptr;
-    radix_page_pool->Free(child);
+    FreePage(child);
   }
 
   /*!
@@ -739,17 +1244,14 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
   RadixPage* SplitPage(RadixPage* page, size_t offset) {
     CHECK_LT(offset, page->length);
     RadixPage* child = radix_page_pool->Allocate();
-    child->parent = page;
-    child->first_child = page->first_child;
-    for (RadixPage* p = page->first_child; p; p = p->next_sibling) {
-      p->parent = child;
-    }
-    page->first_child = child;
+    child->TakeChildren(page);
     for (int i = offset; i < page->length; ++i) {
       (*child)[i - offset] = (*page)[i];
     }
     child->length = page->length - offset;
     page->length = offset;
+    page->InsertChild(child);
+    OnChildrenChanged(page);
     child->seq_ids = page->seq_ids;
     std::vector<int64_t> seq_ids = page->GetLocalSequence();
     for (int64_t id : seq_ids) seq2page[id] = child;
@@ -796,6 +1298,39 @@ class PagedRadixTreeImpl : public PagedRadixTreeObj {
 
 TVM_REGISTER_OBJECT_TYPE(PagedRadixTreeImpl);
 
+// PagedRadixTreeSnapshot
+
+TVM_REGISTER_OBJECT_TYPE(PagedRadixTreeSnapshotObj);
+
+std::atomic<uint64_t> PagedRadixTreeImpl::snapshot_version_counter_{0};
+
+size_t PagedRadixTreeSnapshotObj::MatchPrefixLength(const std::vector<int32_t>& prefix) const {
+  size_t offset = 0;
+  const Node* node = root.get();
+  while (node != nullptr && offset < prefix.size()) {
+    // Binary search the child node starting with the offset-th token.
+    auto child = std::lower_bound(node->children.begin(), node->children.end(), prefix[offset],
+                                  [](const std::shared_ptr<const Node>& child, int32_t token) {
+                                    return child->tokens[0] < token;
+                                  });
+    if (child == node->children.end() || (*child)->tokens[0] != prefix[offset]) {
+      break;
+    }
+    const std::vector<int32_t>& tokens = (*child)->tokens;
+    size_t matched_length = 0;
+    while (matched_length < tokens.size() && offset + matched_length < prefix.size() &&
+           tokens[matched_length] == prefix[offset + matched_length]) {
+      ++matched_length;
+    }
+    offset += matched_length;
+    if (matched_length < tokens.size()) {
+      break;
+    }
+    node = child->get();
+  }
+  return offset;
+}
+
 PagedRadixTree PagedRadixTree::Create() {
   return PagedRadixTree(make_object<PagedRadixTreeImpl>());
 }
@@ -806,7 +1341,7 @@ TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTree").set_body_typed([]() {
 TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeMatchPrefix")
     .set_body_typed([](PagedRadixTree paged_radix_tree, IntTuple tokens) {
       std::vector<int32_t> token_ids{tokens.begin(), tokens.end()};
-      auto [offset, seq_ids] = paged_radix_tree->MatchPrefix(token_ids);
+      auto [offset, seq_ids] = paged_radix_tree->MatchPrefix(token_ids, nullptr);
       seq_ids.insert(seq_ids.begin(), offset);
       return IntTuple(seq_ids);
     });
@@ -836,6 +1371,27 @@ TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeGetSequenceLength")
     .set_body_typed([](PagedRadixTree paged_radix_tree, int64_t seq_id) {
       return (int64_t)paged_radix_tree->GetSequenceLength(seq_id);
     });
+TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeGetSequenceExclusiveLength")
+    .set_body_typed([](PagedRadixTree paged_radix_tree, int64_t seq_id) {
+      return (int64_t)paged_radix_tree->GetSequenceExclusiveLength(seq_id);
+    });
+TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeExportBinary")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      PagedRadixTree paged_radix_tree = args[0];
+      std::string data = paged_radix_tree->ExportBinary();
+      *rv = TVMByteArray{data.data(), data.size()};
+    });
+TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeImportBinary")
+    .set_body_typed([](PagedRadixTree paged_radix_tree, std::string data) {
+      return IntTuple(paged_radix_tree->ImportBinary(data));
+    });
+TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeCreateSnapshot")
+    .set_body_method<PagedRadixTree>(&PagedRadixTreeObj::CreateSnapshot);
+TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeSnapshotMatchPrefixLength")
+    .set_body_typed([](PagedRadixTreeSnapshot snapshot, IntTuple tokens) {
+      std::vector<int32_t> token_ids{tokens.begin(), tokens.end()};
+      return static_cast<int64_t>(snapshot->MatchPrefixLength(token_ids));
+    });
 TVM_REGISTER_GLOBAL("mlc.serve.PagedRadixTreeFreeCapacity")
     .set_body_typed([](PagedRadixTree paged_radix_tree) {
       return (int64_t)paged_radix_tree->FreeCapacity();
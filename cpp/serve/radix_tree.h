@@ -7,8 +7,12 @@
 #include <tvm/runtime/container/shape_tuple.h>
 #include <tvm/runtime/object.h>
 
+#include <functional>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace mlc {
 namespace llm {
@@ -16,6 +20,49 @@ namespace serve {
 
 using namespace tvm::runtime;
 
+/*!
+ * \brief The immutable snapshot of a paged radix tree, which supports prefix matching from any
+ * thread while the paged radix tree keeps being modified by the engine thread. The snapshot is
+ * published RCU-style: a new snapshot is created after modifications, and an old snapshot is
+ * reclaimed when its last reader releases it. Consecutive snapshots share the nodes of the pages
+ * unchanged in between.
+ */
+class PagedRadixTreeSnapshotObj : public Object {
+ public:
+  /*!
+   * \brief Get the length of longest common prefix of given tokens and sequences in the snapshot.
+   * \param tokens The prefix tokens for reference.
+   * \return The matched prefix length.
+   */
+  size_t MatchPrefixLength(const std::vector<int32_t>& tokens) const;
+
+  /*!
+   * \brief The immutable radix tree node of a page, whose children are sorted by their first
+   * tokens, so that the child to match is found by binary search.
+   */
+  struct Node {
+    /*! \brief The tokens of the page. */
+    std::vector<int32_t> tokens;
+    /*! \brief The child nodes, which are never empty. */
+    std::vector<std::shared_ptr<const Node>> children;
+  };
+  /*! \brief The root node. */
+  std::shared_ptr<const Node> root;
+  /*!
+   * \brief The version of the snapshot, which is unique among all snapshots and increases with
+   * creation, so that the match results against a snapshot can be cached by its version.
+   */
+  uint64_t version;
+
+  static constexpr const char* _type_key = "mlc.serve.PagedRadixTreeSnapshot";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PagedRadixTreeSnapshotObj, Object)
+};
+
+class PagedRadixTreeSnapshot : public ObjectRef {
+ public:
+  TVM_DEFINE_OBJECT_REF_METHODS(PagedRadixTreeSnapshot, ObjectRef, PagedRadixTreeSnapshotObj);
+};
+
 /*!
  * \brief The paged radix tree data structure.
  */
@@ -40,10 +87,12 @@ class PagedRadixTreeObj : public Object {
   /*!
    * \brief Get all sequences with longest common prefix with give prefix tokens.
    * \param tokens The prefix tokens for reference.
+   * \param filter The filter of sequences, or nullptr to match all sequences. Otherwise only the
+   * sequences for which the filter returns true are matched.
    * \return The pair of matched prefix length and the array of matched sequences indices.
    */
   virtual std::pair<size_t, std::vector<int64_t>> MatchPrefix(
-      const std::vector<int32_t>& tokens) = 0;
+      const std::vector<int32_t>& tokens, const std::function<bool(int64_t)>& filter) = 0;
 
   /*!
    * \brief Get a sequence's length.
@@ -53,6 +102,15 @@ class PagedRadixTreeObj : public Object {
    */
   virtual size_t GetSequenceLength(int64_t seq_id) = 0;
 
+  /*!
+   * \brief Get the number of tokens exclusively owned by a sequence, which are not shared with
+   * any other sequence. These tokens are released when the sequence is removed.
+   * \param seq_id The sequence ID for index.
+   * \return The number of exclusively owned tokens.
+   * \throw Error if sequence ID is not valid.
+   */
+  virtual size_t GetSequenceExclusiveLength(int64_t seq_id) = 0;
+
   /*!
    * \brief Fork a sequence from parent sequence at given position.
    * \param seq_id The new sequence ID.
@@ -101,6 +159,30 @@ class PagedRadixTreeObj : public Object {
    */
   virtual size_t FreeCapacity() = 0;
 
+  /*!
+   * \brief Export the structure and token content of the paged radix tree into a compact binary
+   * format, where the tokens shared by sequences are stored only once.
+   * \return The exported binary data.
+   */
+  virtual std::string ExportBinary() = 0;
+
+  /*!
+   * \brief Import the sequences from binary data exported by "ExportBinary". The sequences are
+   * added into the paged radix tree with their original sequence IDs.
+   * \param data The binary data to import.
+   * \return The imported sequence IDs.
+   * \throw Error if the data is malformed, or any imported sequence ID already exists.
+   */
+  virtual std::vector<int64_t> ImportBinary(const std::string& data) = 0;
+
+  /*!
+   * \brief Create an immutable snapshot of the paged radix tree. Only the pages changed since the
+   * last snapshot and their ancestors are copied, and the last snapshot is returned as is when no
+   * page changed.
+   * \return The created snapshot.
+   */
+  virtual PagedRadixTreeSnapshot CreateSnapshot() = 0;
+
   /*!
    * \brief Reset the paged radix tree to initial status.
    */
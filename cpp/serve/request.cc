@@ -8,6 +8,9 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
+#include <unordered_set>
+
 #include "data.h"
 
 namespace mlc {
@@ -68,6 +71,30 @@ Request Request::FromUntokenized(const Request& request, const Tokenizer& tokeni
   }
 }
 
+int RemoveRequestsFromQueue(std::vector<Request>* queue, const std::vector<Request>& requests) {
+  if (requests.empty()) {
+    return 0;
+  } else if (requests.size() == 1) {
+    auto it = std::find(queue->begin(), queue->end(), requests[0]);
+    if (it == queue->end()) {
+      return 0;
+    }
+    queue->erase(it);
+    return 1;
+  }
+  std::unordered_set<const RequestNode*> removed_requests;
+  removed_requests.reserve(requests.size());
+  for (const Request& request : requests) {
+    removed_requests.insert(request.operator->());
+  }
+  auto it = std::remove_if(queue->begin(), queue->end(), [&](const Request& request) {
+    return removed_requests.count(request.operator->());
+  });
+  int num_removed = static_cast<int>(queue->end() - it);
+  queue->erase(it, queue->end());
+  return num_removed;
+}
+
 TVM_REGISTER_GLOBAL("mlc.serve.RequestGetInputs").set_body_typed([](Request request) {
   return request->inputs;
 });
@@ -11,6 +11,8 @@
 #include <tvm/runtime/object.h>
 #include <tvm/runtime/packed_func.h>
 
+#include <vector>
+
 #include "../tokenizers/tokenizers.h"
 #include "config.h"
 #include "data.h"
@@ -48,6 +50,24 @@ class RequestNode : public Object {
    * of untokenized text data.
    */
   int prompt_tokens = -1;
+  /*!
+   * \brief The estimated number of prompt tokens already in prefix cache, which is matched
+   * against a prefix cache snapshot when the request is added, off the engine thread.
+   * "-1" means it is not estimated. The estimation is a hint only: it may be stale, and it ignores
+   * tenant partitions.
+   */
+  int cached_prefix_length = -1;
+  /*!
+   * \brief The version of the prefix cache snapshot which "cached_prefix_length" is matched
+   * against, so that the request is matched again only against a newer snapshot. "0" means it is
+   * not matched.
+   */
+  uint64_t cached_prefix_snapshot_version = 0;
+  /*!
+   * \brief The hash of the leading prompt tokens, by which the prefix-aware waiting queue order
+   * groups the requests sharing a prefix. "-1" means it is not computed.
+   */
+  int64_t prefix_group_key = -1;
   /*!
    * \brief The sampling configuration which may contain temperature,
    * top_p, repetition_penalty, max_gen_len, etc.
@@ -78,6 +98,16 @@ class Request : public ObjectRef {
   TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(Request, ObjectRef, RequestNode);
 };
 
+/*!
+ * \brief Remove the given requests from a request queue in a single pass, keeping the order of
+ * the remaining requests. Unlike erasing the requests one by one, it takes time linear in the
+ * queue length no matter how many requests are removed.
+ * \param queue The request queue to remove from.
+ * \param requests The requests to remove. The requests not in the queue are ignored.
+ * \return The number of removed requests.
+ */
+int RemoveRequestsFromQueue(std::vector<Request>* queue, const std::vector<Request>& requests);
+
 }  // namespace serve
 }  // namespace llm
 }  // namespace mlc
@@ -142,7 +142,7 @@ RequestStreamOutput RequestActionPostProcWorkspace::GetStreamOutput() {
 TVM_REGISTER_OBJECT_TYPE(RequestStateEntryNode);
 
 RequestStateEntry::RequestStateEntry(
-    Request request, int num_models, int64_t internal_id, int rng_seed,
+    Request request, int num_models, int64_t internal_id, int rng_seed, bool counter_based_rng,
     const std::vector<std::string>& token_table,
     const std::optional<xgrammar::CompiledGrammar>& compiled_grammar, int parent_idx) {
   ObjectPtr<RequestStateEntryNode> n = make_object<RequestStateEntryNode>();
@@ -156,7 +156,7 @@ RequestStateEntry::RequestStateEntry(
     mstates.push_back(RequestModelState(request, i, internal_id, inputs, compiled_grammar));
   }
   n->status = RequestStateStatus::kPending;
-  n->rng = RandomGenerator(rng_seed);
+  n->rng = RandomGenerator(rng_seed, counter_based_rng);
   n->stop_str_handler = StopStrHandler(!request->generation_cfg->debug_config.ignore_eos
                                            ? request->generation_cfg->stop_strs
                                            : Array<String>(),
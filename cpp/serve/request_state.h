@@ -255,7 +255,7 @@ class RequestStateEntryNode : public Object {
 class RequestStateEntry : public ObjectRef {
  public:
   explicit RequestStateEntry(Request request, int num_models, int64_t internal_id, int rng_seed,
-                             const std::vector<std::string>& token_table,
+                             bool counter_based_rng, const std::vector<std::string>& token_table,
                              const std::optional<xgrammar::CompiledGrammar>& compiled_grammar,
                              int parent_idx = -1);
 
@@ -9,9 +9,17 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
 
 #include "../../support/random.h"
+#include "cpu_sampler.h"
+#include "cpu_sampler_kernels.h"
+#include "deterministic_sampling.h"
 #include "sampler.h"
 
 namespace mlc {
@@ -47,37 +55,19 @@ TokenProbPair SampleTopPFromProb(NDArray prob, int unit_offset, int input_prob_o
   const float* __restrict p_prob =
       static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (input_prob_offset * ndata);
   constexpr double one = 1.0f - 1e-5f;
+  const CPUSamplerKernels& kernels = GetCPUSamplerKernels();
 
   if (top_p == 0) {
     // Specially handle case where top_p == 0.
     // This case is equivalent to doing argmax.
-    int argmax_pos = -1;
-    float max_prob = 0.0;
-    float sum_prob = 0.0;
-    for (int i = 0; i < ndata; ++i) {
-      if (p_prob[i] > max_prob) {
-        max_prob = p_prob[i];
-        argmax_pos = i;
-      }
-      // Early exit.
-      sum_prob += p_prob[i];
-      if (1 - sum_prob <= max_prob) {
-        break;
-      }
-    }
-    return {argmax_pos, 1.0};
+    return {kernels.argmax(p_prob, ndata), 1.0};
   }
 
   if (top_p >= one) {
     // Specially handle case where top_p == 1.
-    double prob_sum = 0.0f;
-    for (int64_t i = 0; i < ndata; ++i) {
-      prob_sum += p_prob[i];
-      if (prob_sum >= uniform_sample) {
-        return {i, p_prob[i]};
-      }
-    }
-    ICHECK(false) << "Possibly prob distribution contains NAN.";
+    int64_t i = kernels.sample_prefix_sum(p_prob, ndata, uniform_sample);
+    ICHECK_GE(i, 0) << "Possibly prob distribution contains NAN.";
+    return {i, p_prob[i]};
   }
 
   // Key observation: when we are doing top_p sampling
@@ -89,15 +79,14 @@ TokenProbPair SampleTopPFromProb(NDArray prob, int unit_offset, int input_prob_o
     data.clear();
     // filter the data with cuttoff
     float cutoff_sum = 0.0f;
-    for (int64_t i = 0; i < ndata; ++i) {
-      if (p_prob[i] >= cuttoff) {
-        cutoff_sum += p_prob[i];
-        data.emplace_back(std::make_pair(p_prob[i], static_cast<int>(i)));
-        if (cutoff_sum > 1 - cuttoff) {
-          // Short cut. When the remaining parts cannot have total
-          // probability larger than cutoff, we can quit.
-          break;
-        }
+    for (int64_t i = kernels.find_next_at_least(p_prob, 0, ndata, cuttoff); i < ndata;
+         i = kernels.find_next_at_least(p_prob, i + 1, ndata, cuttoff)) {
+      cutoff_sum += p_prob[i];
+      data.emplace_back(std::make_pair(p_prob[i], static_cast<int>(i)));
+      if (cutoff_sum > 1 - cuttoff) {
+        // Short cut. When the remaining parts cannot have total
+        // probability larger than cutoff, we can quit.
+        break;
       }
     }
     if (data.size() == 0) return std::make_pair(-1, -1);
@@ -161,164 +150,257 @@ TokenProbPair SampleTopPFromProb(NDArray prob, int unit_offset, int input_prob_o
   return {sampled_index.second, sampled_index.first};
 }
 
-/*!
- * \brief Renormalize the probability distribution by the top p value.
- * \param prob The input batch of probability distributions.
- * \param unit_offset The offset specifying which distribution to output
- * \param top_p The top p value for renormalization.
- * \param eps A small epsilon value for comparison stability.
- */
-void RenormalizeProbByTopP(NDArray prob, int unit_offset, double top_p, double eps) {
+void RenormalizeProbByTopKTopPMinP(NDArray prob, int unit_offset, int top_k, double top_p,
+                                   double min_p, double eps) {
   // prob: (*, v)
   // The prob array may have arbitrary ndim and shape.
   // The last dimension corresponds to the prob distribution size.
   // We use the `unit_offset` parameter to determine which slice
   // of the prob array we will renormalize.
+  // Each of top-k, top-p and min-p keeps a prefix of the tokens in descending order of
+  // probability, so the kept tokens are the shortest of the prefixes. Instead of sorting the
+  // distribution, the boundary of the prefix is selected by a radix histogram over the leading
+  // bits of the probabilities, whose bit patterns have the same order as the non-negative values.
+  // Only the tokens in the bucket holding the boundary are sorted.
   ICHECK(prob.IsContiguous());
   ICHECK(prob.DataType() == DataType::Float(32));
   ICHECK_EQ(prob->device.device_type, DLDeviceType::kDLCPU);
 
-  if (top_p == 1.0) {
-    // No renormalization is needed if top_p is 1.
+  int vocab_size = prob->shape[prob->ndim - 1];
+  if (top_p == 1.0 && (top_k == 0 || top_k >= vocab_size) && min_p == 0.0) {
+    // No renormalization is needed.
     return;
   }
-
-  int vocab_size = prob->shape[prob->ndim - 1];
   float* __restrict p_prob =
       static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (unit_offset * vocab_size);
 
-  // We manually choice the cutoff values of "top_p / 256" and "top_p / 8192".
-  // In most of the cases, only one round is needed.
-  std::vector<double> cutoff_values{top_p / 256, top_p / 8192, 0.0f};
-
-  // Create the upper partition vector and the lower partition rolling vectors.
-  std::vector<float> upper_partition;
-  std::vector<float> lower_partitions[2];
-  upper_partition.reserve(vocab_size);
-  lower_partitions[0].reserve(vocab_size);
-  lower_partitions[1].reserve(vocab_size);
-  float upper_partition_sum = 0.0;
-  for (int round = 0; round < static_cast<int>(cutoff_values.size()); ++round) {
-    const float* lower_partition_begin;
-    const float* lower_partition_end;
-    if (round == 0) {
-      lower_partition_begin = p_prob;
-      lower_partition_end = p_prob + vocab_size;
-    } else {
-      int idx = (round - 1) & 1;
-      lower_partition_begin = lower_partitions[idx].data();
-      lower_partition_end = lower_partitions[idx].data() + lower_partitions[idx].size();
-    }
-
-    // - Partition the last round lower partition into upper and lower
-    // based on the new cutoff value.
-    std::vector<float>& lower_partition = lower_partitions[round & 1];
-    lower_partition.clear();
-    for (const float* ptr = lower_partition_begin; ptr != lower_partition_end; ++ptr) {
-      if (*ptr >= cutoff_values[round]) {
-        upper_partition.push_back(*ptr);
-        upper_partition_sum += *ptr;
-      } else {
-        lower_partition.push_back(*ptr);
-      }
-    }
-    // - If the upper partition sum is at least top p, exit the loop.
-    if (upper_partition_sum >= top_p - eps) {
+  // 4096 buckets, each of which covers 1/16 of a power of two.
+  constexpr int kNumRadixBits = 12;
+  constexpr int kRadixShift = 31 - kNumRadixBits;
+  constexpr int kNumBuckets = 1 << kNumRadixBits;
+  auto f_bucket = [](float value) -> int {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return static_cast<int>((bits & 0x7fffffffU) >> kRadixShift);
+  };
+  thread_local std::vector<int> bucket_counts;
+  thread_local std::vector<double> bucket_sums;
+  thread_local std::vector<std::pair<float, int>> candidates;
+  bucket_counts.assign(kNumBuckets, 0);
+  bucket_sums.assign(kNumBuckets, 0.0);
+
+  // - Build the histogram of probabilities in one pass.
+  float max_prob = 0.0f;
+  for (int i = 0; i < vocab_size; ++i) {
+    int bucket = f_bucket(p_prob[i]);
+    ++bucket_counts[bucket];
+    bucket_sums[bucket] += p_prob[i];
+    max_prob = std::max(max_prob, p_prob[i]);
+  }
+  float min_p_cutoff = static_cast<float>(min_p * max_prob);
+
+  // - Walk the buckets in descending order to the one holding the boundary, which is no lower
+  // than the bucket of the min p cutoff.
+  int boundary_bucket = f_bucket(min_p_cutoff);
+  int num_upper = 0;
+  double upper_sum = 0.0;
+  for (int bucket = kNumBuckets - 1; bucket > boundary_bucket; --bucket) {
+    num_upper += bucket_counts[bucket];
+    upper_sum += bucket_sums[bucket];
+    if ((top_k > 0 && num_upper >= top_k) || upper_sum >= top_p - eps) {
+      boundary_bucket = bucket;
       break;
     }
   }
 
-  // - Sort the upper partition in descending order.
-  std::sort(upper_partition.begin(), upper_partition.end(), std::greater<>());
-  // - Find the top p boundary prob value.
-  float boundary_value = -1.0;
-  upper_partition_sum = 0.0;
-  for (float upper_value : upper_partition) {
-    upper_partition_sum += upper_value;
-    if (upper_partition_sum >= top_p - eps) {
-      boundary_value = upper_value;
-      break;
-    }
+  // - Collect the tokens from the boundary bucket upward. The tokens above the boundary bucket
+  // are all kept, and only the tokens in the boundary bucket are sorted.
+  uint32_t boundary_bits = static_cast<uint32_t>(boundary_bucket) << kRadixShift;
+  float boundary_value;
+  std::memcpy(&boundary_value, &boundary_bits, sizeof(boundary_value));
+  float cutoff = std::max(boundary_value, min_p_cutoff);
+  const CPUSamplerKernels& kernels = GetCPUSamplerKernels();
+  candidates.clear();
+  for (int64_t i = kernels.find_next_at_least(p_prob, 0, vocab_size, cutoff); i < vocab_size;
+       i = kernels.find_next_at_least(p_prob, i + 1, vocab_size, cutoff)) {
+    candidates.emplace_back(p_prob[i], static_cast<int>(i));
   }
-  // - Mask all values smaller than the boundary to 0.
+  auto boundary_begin = std::partition(
+      candidates.begin(), candidates.end(), [&f_bucket, boundary_bucket](const auto& candidate) {
+        return f_bucket(candidate.first) > boundary_bucket;
+      });
+  std::sort(boundary_begin, candidates.end(),
+            [](const std::pair<float, int>& lhs, const std::pair<float, int>& rhs) {
+              return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+            });
+
+  // - Find the kept tokens. The first token is always kept.
+  int num_kept = boundary_begin - candidates.begin();
   float renormalize_sum = 0.0;
-  std::vector<int> upper_partition_indices;
-  upper_partition_indices.reserve(vocab_size);
-  for (int i = 0; i < vocab_size; ++i) {
-    if (p_prob[i] >= boundary_value) {
-      upper_partition_indices.push_back(i);
-      renormalize_sum += p_prob[i];
-    } else {
-      p_prob[i] = 0.0;
+  for (auto it = candidates.begin(); it != boundary_begin; ++it) {
+    renormalize_sum += it->first;
+  }
+  for (auto it = boundary_begin; it != candidates.end(); ++it) {
+    if (num_kept > 0 && ((top_k > 0 && num_kept >= top_k) || it->first < min_p_cutoff ||
+                         renormalize_sum >= top_p - eps)) {
+      break;
     }
+    renormalize_sum += it->first;
+    ++num_kept;
+  }
+  if (num_kept == 0 || num_kept == vocab_size) {
+    return;
   }
-  // - Renormalize.
-  for (int idx : upper_partition_indices) {
-    p_prob[idx] /= renormalize_sum;
+
+  // - Mask all other values to 0 and renormalize.
+  std::fill(p_prob, p_prob + vocab_size, 0.0f);
+  for (int i = 0; i < num_kept; ++i) {
+    p_prob[candidates[i].second] = candidates[i].first / renormalize_sum;
   }
 }
 
-namespace detail {
+std::vector<TokenProbPair> ComputeTopProbs(NDArray prob, int unit_offset, int num_top_probs) {
+  // A min-heap keeps the top probabilities so far. Only the probabilities greater than the heap
+  // top can enter the heap, which the vectorized filter kernel finds without visiting the others.
+  ICHECK_EQ(prob->ndim, 2);
+  int ndata = prob->shape[1];
+  num_top_probs = std::min(num_top_probs, ndata);
+  if (num_top_probs == 0) {
+    return {};
+  }
+  const float* __restrict p_prob =
+      static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (unit_offset * ndata);
 
-/*! \brief Implementation of getting top probs on CPU. */
-template <int num_top_probs>
-std::vector<TokenProbPair> ComputeTopProbsImpl(const float* p_prob, int ndata) {
+  // The heap top has the lowest probability, and the largest token index among ties, so that
+  // the earlier tokens win ties.
+  auto fcmp = [](const TokenProbPair& lhs, const TokenProbPair& rhs) {
+    return lhs.second > rhs.second || (lhs.second == rhs.second && lhs.first < rhs.first);
+  };
   std::vector<TokenProbPair> top_probs;
   top_probs.reserve(num_top_probs);
   for (int i = 0; i < num_top_probs; ++i) {
-    top_probs.emplace_back(-1, -1.0f);
+    top_probs.emplace_back(i, p_prob[i]);
   }
+  std::make_heap(top_probs.begin(), top_probs.end(), fcmp);
 
-  float sum_prob = 0.0;
-  // Selection argsort.
-  for (int p = 0; p < ndata; ++p) {
-    int i = num_top_probs - 1;
-    for (; i >= 0; --i) {
-      if (p_prob[p] > top_probs[i].second) {
-        if (i != num_top_probs - 1) {
-          top_probs[i + 1] = top_probs[i];
-        }
-      } else {
-        break;
-      }
-    }
-    if (i != num_top_probs - 1) {
-      top_probs[i + 1] = {p, p_prob[p]};
-    }
-
-    // Early exit.
-    sum_prob += p_prob[p];
-    if (1 - sum_prob <= top_probs[num_top_probs - 1].second) {
-      break;
-    }
+  const CPUSamplerKernels& kernels = GetCPUSamplerKernels();
+  auto f_threshold = [&top_probs]() {
+    return std::nextafter(top_probs.front().second, std::numeric_limits<float>::infinity());
+  };
+  for (int64_t i = kernels.find_next_at_least(p_prob, num_top_probs, ndata, f_threshold());
+       i < ndata; i = kernels.find_next_at_least(p_prob, i + 1, ndata, f_threshold())) {
+    std::pop_heap(top_probs.begin(), top_probs.end(), fcmp);
+    top_probs.back() = TokenProbPair(i, p_prob[i]);
+    std::push_heap(top_probs.begin(), top_probs.end(), fcmp);
   }
+  std::sort_heap(top_probs.begin(), top_probs.end(), fcmp);
   return top_probs;
 }
 
-}  // namespace detail
+/*!
+ * \brief Sample from the residual distribution norm(max(p - q, 0)) of speculative decoding, where
+ * p is the distribution at the given offset of the batch and q is the draft distribution.
+ * The unnormalized residual overwrites p, and the normalization is fused into the resample scan
+ * by scaling the uniform sample with the residual sum.
+ * \return The sampled value with its normalized probability, and the residual sum.
+ */
+inline std::pair<TokenProbPair, double> SampleFromResidualProb(NDArray prob, int unit_offset,
+                                                               const float* draft_prob,
+                                                               double uniform_sample) {
+  ICHECK_EQ(prob->ndim, 2);
+  int64_t ndata = prob->shape[1];
+  float* __restrict p_prob =
+      static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (unit_offset * ndata);
+  const CPUSamplerKernels& kernels = GetCPUSamplerKernels();
+
+  double residual_sum = kernels.residual(p_prob, draft_prob, ndata);
+  ICHECK_GT(residual_sum, 0) << "Possibly prob distribution contains NAN.";
+  int64_t i = kernels.sample_prefix_sum(p_prob, ndata, uniform_sample * residual_sum);
+  if (i == -1) {
+    // The prefix sum falls short of the scaled sample only by rounding.
+    for (i = ndata - 1; i > 0 && p_prob[i] == 0.0f; --i) {
+    }
+  }
+  return {TokenProbPair(i, p_prob[i] / residual_sum), residual_sum};
+}
 
-/*! \brief Get the probs of a few number of tokens with top probabilities. */
-inline std::vector<TokenProbPair> ComputeTopProbs(NDArray prob, int unit_offset,
-                                                  int num_top_probs) {
-  ICHECK_LE(num_top_probs, 5);
+TokenProbPair SampleDeterministicFromProb(NDArray prob, int input_prob_offset,
+                                          const DeterministicSamplingParams& params,
+                                          double uniform_sample) {
   ICHECK_EQ(prob->ndim, 2);
-  int ndata = prob->shape[1];
+  int64_t ndata = prob->shape[1];
   const float* __restrict p_prob =
-      static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (unit_offset * ndata);
-  switch (num_top_probs) {
-    case 0:
-      return {};
-    case 1:
-      return detail::ComputeTopProbsImpl<1>(p_prob, ndata);
-    case 2:
-      return detail::ComputeTopProbsImpl<2>(p_prob, ndata);
-    case 3:
-      return detail::ComputeTopProbsImpl<3>(p_prob, ndata);
-    case 4:
-      return detail::ComputeTopProbsImpl<4>(p_prob, ndata);
-    case 5:
-      return detail::ComputeTopProbsImpl<5>(p_prob, ndata);
+      static_cast<float*>(__builtin_assume_aligned(prob->data, 4)) + (input_prob_offset * ndata);
+
+  thread_local std::vector<int64_t> quantized_prob;
+  quantized_prob.resize(ndata);
+  int64_t prob_sum = 0;
+  int64_t max_prob = 0;
+  for (int64_t i = 0; i < ndata; ++i) {
+    quantized_prob[i] = QuantizeDeterministicProb(p_prob[i]);
+    prob_sum += quantized_prob[i];
+    max_prob = std::max(max_prob, quantized_prob[i]);
+  }
+  ICHECK_GT(prob_sum, 0) << "Possibly prob distribution contains NAN.";
+  int64_t cutoff = DeterministicMinPCutoff(params.min_p, max_prob);
+
+  if (params.top_p < kDeterministicFractionOne || params.top_k < ndata) {
+    // The top-p and top-k cutoffs are probabilities in descending order. Usually only the
+    // probabilities no less than 2^-10 need sorting, and all of them otherwise.
+    int64_t top_p_target = DeterministicTopPTarget(params.top_p, prob_sum);
+    thread_local std::vector<int64_t> sorted_prob;
+    for (int64_t filter : {int64_t{1} << (kDeterministicProbBits - 10), int64_t{1}}) {
+      sorted_prob.clear();
+      for (int64_t q : quantized_prob) {
+        if (q >= filter) {
+          sorted_prob.push_back(q);
+        }
+      }
+      std::sort(sorted_prob.begin(), sorted_prob.end(), std::greater<int64_t>());
+      int64_t top_p_cutoff = -1;
+      if (params.top_p >= kDeterministicFractionOne) {
+        top_p_cutoff = 0;
+      } else {
+        int64_t cum_sum = 0;
+        for (int64_t q : sorted_prob) {
+          cum_sum += q;
+          if (cum_sum >= top_p_target) {
+            top_p_cutoff = q;
+            break;
+          }
+        }
+      }
+      int64_t top_k_cutoff = -1;
+      if (params.top_k >= ndata) {
+        top_k_cutoff = 0;
+      } else if (static_cast<int64_t>(sorted_prob.size()) >= params.top_k) {
+        top_k_cutoff = sorted_prob[params.top_k - 1];
+      }
+      if (filter == 1) {
+        // The zero probabilities left out are never sampled.
+        top_p_cutoff = std::max<int64_t>(top_p_cutoff, 0);
+        top_k_cutoff = std::max<int64_t>(top_k_cutoff, 0);
+      }
+      if (top_p_cutoff != -1 && top_k_cutoff != -1) {
+        cutoff = std::max({cutoff, top_p_cutoff, top_k_cutoff});
+        break;
+      }
+    }
   }
+
+  int64_t kept_prob_sum = 0;
+  for (int64_t q : quantized_prob) {
+    kept_prob_sum += q >= cutoff ? q : 0;
+  }
+  int64_t target = DeterministicSampleTarget(uniform_sample, kept_prob_sum);
+  int64_t cum_sum = 0;
+  for (int64_t i = 0; i < ndata; ++i) {
+    cum_sum += quantized_prob[i] >= cutoff ? quantized_prob[i] : 0;
+    if (cum_sum > target) {
+      return {i, p_prob[i]};
+    }
+  }
+  LOG(FATAL) << "The kept probabilities of deterministic sampling do not exceed the target.";
   throw;
 }
 
@@ -328,8 +410,9 @@ TVM_REGISTER_OBJECT_TYPE(SamplerObj);
 
 class CPUSampler : public SamplerObj {
  public:
-  explicit CPUSampler(Optional<EventTraceRecorder> trace_recorder)
-      : trace_recorder_(std::move(trace_recorder)) {
+  explicit CPUSampler(bool deterministic_sampling, Optional<EventTraceRecorder> trace_recorder)
+      : deterministic_sampling_(deterministic_sampling),
+        trace_recorder_(std::move(trace_recorder)) {
     // Set customized "logits -> prob" function.
     const PackedFunc* f_logits_to_probs =
         Registry::Get("mlc.llm.compute_probs_from_logits_inplace");
@@ -348,6 +431,10 @@ class CPUSampler : public SamplerObj {
     RECORD_EVENT(trace_recorder_, request_ids, "start copy probs to CPU");
     NDArray probs_on_host = CopyProbsToCPU(probs_on_device);
     RECORD_EVENT(trace_recorder_, request_ids, "finish copy probs to CPU");
+    if (deterministic_sampling_) {
+      // Deterministic sampling truncates the distributions in fixed point when sampling.
+      return probs_on_host;
+    }
     int num_samples = sample_indices.size();
     int num_probs = probs_on_device->shape[0];
     int vocab_size = probs_on_device->shape[1];
@@ -356,13 +443,21 @@ class CPUSampler : public SamplerObj {
 
     std::vector<int> top_p_indices;
     std::vector<double> top_p_values;
+    std::vector<int> top_k_values;
+    std::vector<double> min_p_values;
     for (int i = 0; i < num_samples; ++i) {
       if (top_p_indices.empty() || top_p_indices.back() != sample_indices[i]) {
         top_p_indices.push_back(sample_indices[i]);
         top_p_values.push_back(generation_cfg[i]->top_p);
+        top_k_values.push_back(generation_cfg[i]->top_k);
+        min_p_values.push_back(generation_cfg[i]->min_p);
       } else {
         CHECK(fabs(top_p_values.back() - generation_cfg[i]->top_p) < eps_)
             << "Sampler requires the top_p values for each prob distribution are the same.";
+        CHECK(top_k_values.back() == generation_cfg[i]->top_k &&
+              fabs(min_p_values.back() - generation_cfg[i]->min_p) < eps_)
+            << "Sampler requires the top_k and min_p values for each prob distribution are the "
+               "same.";
       }
     }
     if (top_p_indices.empty()) {
@@ -371,9 +466,11 @@ class CPUSampler : public SamplerObj {
     }
 
     tvm::runtime::parallel_for_with_threading_backend(
-        [this, &probs_on_host, &request_ids, &top_p_indices, &top_p_values](int i) {
+        [this, &probs_on_host, &request_ids, &top_p_indices, &top_p_values, &top_k_values,
+         &min_p_values](int i) {
           RECORD_EVENT(this->trace_recorder_, request_ids[i], "start renormalize by top p");
-          RenormalizeProbByTopP(probs_on_host, top_p_indices[i], top_p_values[i], eps_);
+          RenormalizeProbByTopKTopPMinP(probs_on_host, top_p_indices[i], top_k_values[i],
+                                        top_p_values[i], min_p_values[i], eps_);
           RECORD_EVENT(this->trace_recorder_, request_ids[i], "finish renormalize by top p");
         },
         0, static_cast<int64_t>(top_p_indices.size()));
@@ -389,6 +486,15 @@ class CPUSampler : public SamplerObj {
       const std::vector<RandomGenerator*>& rngs) final {
     // probs_on_device: (n, v)
     CHECK_EQ(probs_on_device->ndim, 2);
+    // - Top-k and min-p are applied only by renormalization, except in deterministic sampling.
+    for (const GenerationConfig& cfg : generation_cfg) {
+      if (!deterministic_sampling_ && (cfg->top_k > 0 || cfg->min_p > 0)) {
+        NDArray renormalized_probs = BatchRenormalizeProbsByTopP(probs_on_device, sample_indices,
+                                                                 request_ids, generation_cfg);
+        return BatchSampleTokensWithProbAfterTopP(renormalized_probs, sample_indices, request_ids,
+                                                  generation_cfg, rngs);
+      }
+    }
     // - Copy probs to CPU
     RECORD_EVENT(trace_recorder_, request_ids, "start copy probs to CPU");
     NDArray probs_on_host = CopyProbsToCPU(probs_on_device);
@@ -432,81 +538,93 @@ class CPUSampler : public SamplerObj {
     int vocab_size = probs_on_host->shape[1];
 
     std::vector<int> last_accepted_tree_node(num_sequence, 0);
-    tvm::runtime::parallel_for_with_threading_backend(
-        [&](int i) {
-          int verify_start = cum_verify_lengths[i];
-          int verify_end = cum_verify_lengths[i + 1];
-
-          CHECK_EQ(token_tree_parent_ptr[verify_start], -1);
-          for (int j = verify_start + 1; j < verify_end; ++j) {
-            CHECK_EQ(token_tree_parent_ptr[j], j - verify_start - 1)
-                << "CPU sampler only supports chain-style draft tokens.";
-          }
+    auto f_verify_sequence = [&](int i) {
+      int verify_start = cum_verify_lengths[i];
+      int verify_end = cum_verify_lengths[i + 1];
+
+      CHECK_EQ(token_tree_parent_ptr[verify_start], -1);
+      for (int j = verify_start + 1; j < verify_end; ++j) {
+        CHECK_EQ(token_tree_parent_ptr[j], j - verify_start - 1)
+            << "CPU sampler only supports chain-style draft tokens.";
+      }
 
-          int cur_token_idx = 0;
-          // Sub 1 to ignore the last prediction.
-          for (; cur_token_idx < verify_end - verify_start - 1; ++cur_token_idx) {
-            float* p_probs = global_p_probs + (verify_start + cur_token_idx) * vocab_size;
-            int cur_token = draft_output_tokens[i][cur_token_idx].GetTokenId();
-            float q_value = draft_output_tokens[i][cur_token_idx].sampled_token_id.second;
-            float p_value = p_probs[cur_token];
-
-            if (p_value >= q_value) {
-              sample_results[i].push_back(
-                  SampleResult{{cur_token, p_value},
-                               ComputeTopProbs(probs_on_host, verify_start + cur_token_idx,
-                                               generation_cfg[i]->top_logprobs)});
-              continue;
-            }
-            float r = rngs[i]->GetRandomNumber();
-            if (r < p_value / (q_value + eps_)) {
-              sample_results[i].push_back(
-                  SampleResult{{cur_token, p_value},
-                               ComputeTopProbs(probs_on_host, verify_start + cur_token_idx,
-                                               generation_cfg[i]->top_logprobs)});
-              continue;
-            }
-
-            // normalize a new probability distribution
-            double sum_v = 0.0;
-            const float* __restrict p_qdist =
-                static_cast<float*>(__builtin_assume_aligned(draft_probs_on_host->data, 4)) +
-                (verify_start + cur_token_idx + 1) * vocab_size;
-
-            for (int j = 0; j < vocab_size; ++j) {
-              p_probs[j] = std::max(p_probs[j] - p_qdist[j], 0.0f);
-              sum_v += p_probs[j];
-            }
-            for (int j = 0; j < vocab_size; ++j) {
-              p_probs[j] /= sum_v;
-            }
-
-            // sample a new token from the new distribution
-            SampleResult sample_result;
-            sample_result.sampled_token_id = SampleTopPFromProb(
-                probs_on_host, verify_start + cur_token_idx, verify_start + cur_token_idx,
-                /*top_p=*/1.0f, rngs[i]->GetRandomNumber());
-            sample_result.top_prob_tokens = ComputeTopProbs(
-                probs_on_host, verify_start + cur_token_idx, generation_cfg[i]->top_logprobs);
-            sample_results[i].push_back(sample_result);
-            break;
-          }
-          last_accepted_tree_node[i] = cur_token_idx;
-          // if cur_token_idx == verify_end - verify_start - 1
-          // all draft tokens are accepted
-          // we sample a new token
-          if (cur_token_idx == verify_end - verify_start - 1) {
-            SampleResult sample_result;
-            // sample a new token from the original distribution
-            sample_result.sampled_token_id = SampleTopPFromProb(
-                probs_on_host, verify_start + cur_token_idx, verify_start + cur_token_idx,
-                /*top_p=*/1.0f, rngs[i]->GetRandomNumber());
-            sample_result.top_prob_tokens = ComputeTopProbs(
-                probs_on_host, verify_start + cur_token_idx, generation_cfg[i]->top_logprobs);
-            sample_results[i].push_back(sample_result);
+      int cur_token_idx = 0;
+      // Sub 1 to ignore the last prediction.
+      for (; cur_token_idx < verify_end - verify_start - 1; ++cur_token_idx) {
+        float* p_probs = global_p_probs + (verify_start + cur_token_idx) * vocab_size;
+        int cur_token = draft_output_tokens[i][cur_token_idx].GetTokenId();
+        float q_value = draft_output_tokens[i][cur_token_idx].sampled_token_id.second;
+        float p_value = p_probs[cur_token];
+
+        if (p_value >= q_value) {
+          sample_results[i].push_back(
+              SampleResult{{cur_token, p_value},
+                           ComputeTopProbs(probs_on_host, verify_start + cur_token_idx,
+                                           generation_cfg[i]->top_logprobs)});
+          continue;
+        }
+        float r = rngs[i]->GetRandomNumber();
+        if (r < p_value / (q_value + eps_)) {
+          sample_results[i].push_back(
+              SampleResult{{cur_token, p_value},
+                           ComputeTopProbs(probs_on_host, verify_start + cur_token_idx,
+                                           generation_cfg[i]->top_logprobs)});
+          continue;
+        }
+
+        // sample a new token from the residual distribution
+        const float* __restrict p_qdist =
+            static_cast<float*>(__builtin_assume_aligned(draft_probs_on_host->data, 4)) +
+            (verify_start + cur_token_idx + 1) * vocab_size;
+        auto [sampled_token_id, residual_sum] =
+            SampleFromResidualProb(probs_on_host, verify_start + cur_token_idx, p_qdist,
+                                   rngs[i]->GetRandomNumber());
+        SampleResult sample_result;
+        sample_result.sampled_token_id = sampled_token_id;
+        // The normalization does not change which tokens have the top probs, so the top probs
+        // are normalized afterwards.
+        sample_result.top_prob_tokens = ComputeTopProbs(
+            probs_on_host, verify_start + cur_token_idx, generation_cfg[i]->top_logprobs);
+        for (TokenProbPair& top_prob : sample_result.top_prob_tokens) {
+          top_prob.second /= residual_sum;
+        }
+        sample_results[i].push_back(sample_result);
+        break;
+      }
+      last_accepted_tree_node[i] = cur_token_idx;
+      // if cur_token_idx == verify_end - verify_start - 1
+      // all draft tokens are accepted
+      // we sample a new token
+      if (cur_token_idx == verify_end - verify_start - 1) {
+        SampleResult sample_result;
+        // sample a new token from the original distribution
+        sample_result.sampled_token_id = SampleTopPFromProb(
+            probs_on_host, verify_start + cur_token_idx, verify_start + cur_token_idx,
+            /*top_p=*/1.0f, rngs[i]->GetRandomNumber());
+        sample_result.top_prob_tokens = ComputeTopProbs(
+            probs_on_host, verify_start + cur_token_idx, generation_cfg[i]->top_logprobs);
+        sample_results[i].push_back(sample_result);
+      }
+    };
+
+    // - Balance the sequences of unequal draft lengths across threads. Rather than statically
+    // chunking the sequences, every thread takes the next sequence once it finishes one, and the
+    // sequences are taken in descending order of verify length so that the long ones start first.
+    std::vector<int> sequence_order(num_sequence);
+    std::iota(sequence_order.begin(), sequence_order.end(), 0);
+    std::stable_sort(sequence_order.begin(), sequence_order.end(), [&](int lhs, int rhs) {
+      return cum_verify_lengths[lhs + 1] - cum_verify_lengths[lhs] >
+             cum_verify_lengths[rhs + 1] - cum_verify_lengths[rhs];
+    });
+    std::atomic<int> next_sequence{0};
+    int num_workers = std::min(num_sequence, tvm::runtime::threading::MaxConcurrency());
+    tvm::runtime::parallel_for_with_threading_backend(
+        [&](int worker_id) {
+          for (int k = next_sequence++; k < num_sequence; k = next_sequence++) {
+            f_verify_sequence(sequence_order[k]);
           }
         },
-        0, num_sequence);
+        0, num_workers);
     RECORD_EVENT(trace_recorder_, request_ids, "finish draft verification");
     return {sample_results, last_accepted_tree_node};
   }
@@ -535,13 +653,23 @@ class CPUSampler : public SamplerObj {
         [this, &sample_results, &probs_on_host, &generation_cfg, &rngs, &request_ids, top_p_applied,
          sample_indices](int i) {
           RECORD_EVENT(this->trace_recorder_, request_ids[i], "start sample token");
-          // Sample top p from probability.
-          double top_p =
-              top_p_applied
-                  ? 1.0f
-                  : (generation_cfg[i]->temperature < eps_ ? 0.0 : generation_cfg[i]->top_p);
-          sample_results[i].sampled_token_id = SampleTopPFromProb(
-              probs_on_host, i, sample_indices[i], top_p, rngs[i]->GetRandomNumber());
+          if (deterministic_sampling_) {
+            // Deterministic sampling never renormalizes, and applies top p in fixed point. With
+            // zero temperature, it samples among the tied maximum probabilities.
+            sample_results[i].sampled_token_id = SampleDeterministicFromProb(
+                probs_on_host, sample_indices[i],
+                DeterministicSamplingParams::FromGenerationConfig(generation_cfg[i],
+                                                                  probs_on_host->shape[1]),
+                rngs[i]->GetRandomNumber());
+          } else {
+            // Sample top p from probability.
+            double top_p =
+                top_p_applied
+                    ? 1.0f
+                    : (generation_cfg[i]->temperature < eps_ ? 0.0 : generation_cfg[i]->top_p);
+            sample_results[i].sampled_token_id = SampleTopPFromProb(
+                probs_on_host, i, sample_indices[i], top_p, rngs[i]->GetRandomNumber());
+          }
           sample_results[i].top_prob_tokens =
               ComputeTopProbs(probs_on_host, i, generation_cfg[i]->top_logprobs);
           RECORD_EVENT(this->trace_recorder_, request_ids[i], "finish sample token");
@@ -575,6 +703,8 @@ class CPUSampler : public SamplerObj {
     return view;
   }
 
+  /*! \brief Whether to sample deterministically in fixed point. */
+  const bool deterministic_sampling_;
   /*! \brief The event trace recorder for requests. */
   Optional<EventTraceRecorder> trace_recorder_;
   /*! \brief Customized function which computes prob distribution from logits */
@@ -584,8 +714,9 @@ class CPUSampler : public SamplerObj {
   const float eps_ = 1e-5;
 };
 
-Sampler Sampler::CreateCPUSampler(Optional<EventTraceRecorder> trace_recorder) {
-  return Sampler(make_object<CPUSampler>(std::move(trace_recorder)));
+Sampler Sampler::CreateCPUSampler(bool deterministic_sampling,
+                                  Optional<EventTraceRecorder> trace_recorder) {
+  return Sampler(make_object<CPUSampler>(deterministic_sampling, std::move(trace_recorder)));
 }
 
 }  // namespace serve
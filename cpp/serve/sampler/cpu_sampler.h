@@ -0,0 +1,64 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/sampler/cpu_sampler.h
+ * \brief The routines of the CPU sampler over a batch of probability distributions on host.
+ */
+#ifndef MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_H_
+#define MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_H_
+
+#include <tvm/runtime/ndarray.h>
+
+#include <vector>
+
+#include "../data.h"
+#include "deterministic_sampling.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+using tvm::runtime::NDArray;
+
+/*!
+ * \brief Renormalize the probability distribution in place by the top-k, top-p and min-p values.
+ * The kept tokens are the shortest prefix of the tokens in descending order of probability, with
+ * ties broken by the token index, that meets any of the three. The first token is always kept.
+ * \param prob The input batch of probability distributions, in shape (*, v).
+ * \param unit_offset The offset specifying which distribution to renormalize.
+ * \param top_k The top k value for renormalization, or 0 for no top-k truncation.
+ * \param top_p The top p value for renormalization.
+ * \param min_p The min p value for renormalization, or 0 for no min-p truncation.
+ * \param eps A small epsilon value for comparison stability.
+ */
+void RenormalizeProbByTopKTopPMinP(NDArray prob, int unit_offset, int top_k, double top_p,
+                                   double min_p, double eps);
+
+/*!
+ * \brief Get the probs of the tokens with top probabilities, in descending order of probability.
+ * Ties are broken by the token index, the smaller one first.
+ * \param prob The input batch of probability distributions, in shape (n, v).
+ * \param unit_offset The offset specifying which distribution to get the top probs of.
+ * \param num_top_probs The number of top probs to get.
+ * \return The tokens with top probabilities and their probabilities.
+ */
+std::vector<TokenProbPair> ComputeTopProbs(NDArray prob, int unit_offset, int num_top_probs);
+
+/*!
+ * \brief Sample a value from the input probability distribution deterministically with top-k,
+ * top-p and min-p truncation, in the fixed-point definition of deterministic_sampling.h that the
+ * GPU sampler shares.
+ * \param prob The input batch of probability distributions.
+ * \param input_prob_offset The offset specifying which distribution to sample from.
+ * \param params The fixed-point truncation parameters.
+ * \param uniform_sample The random number in [0, 1) for sampling.
+ * \return The sampled value and probability.
+ */
+TokenProbPair SampleDeterministicFromProb(NDArray prob, int input_prob_offset,
+                                          const DeterministicSamplingParams& params,
+                                          double uniform_sample);
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_H_
@@ -0,0 +1,504 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/sampler/cpu_sampler_kernels.cc
+ * \brief The vectorized kernels of the CPU sampler, dispatched by the instruction set at runtime.
+ */
+#include "cpu_sampler_kernels.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MLC_CPU_SAMPLER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define MLC_CPU_SAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*! \brief The number of probabilities argmax scans between the checks of early exit. */
+constexpr const int64_t kArgMaxBlockSize = 256;
+/*! \brief The number of probabilities summed up together in the prefix sum. */
+constexpr const int64_t kPrefixSumBlockSize = 64;
+
+/*!
+ * \brief Return the first position of the maximum among the per-lane maximums and positions, or
+ * -1 when no lane has a position.
+ */
+inline int64_t ReduceArgMaxLanes(const float* lane_max, const int32_t* lane_pos, int num_lanes) {
+  int64_t argmax_pos = -1;
+  float max_prob = 0.0f;
+  for (int lane = 0; lane < num_lanes; ++lane) {
+    if (lane_pos[lane] < 0) {
+      continue;
+    }
+    if (argmax_pos == -1 || lane_max[lane] > max_prob ||
+        (lane_max[lane] == max_prob && lane_pos[lane] < argmax_pos)) {
+      max_prob = lane_max[lane];
+      argmax_pos = lane_pos[lane];
+    }
+  }
+  return argmax_pos;
+}
+
+/*!
+ * \brief Continue argmax over the tail [begin, n) with scalar loop from the maximum found so far.
+ */
+inline int64_t ArgMaxTail(const float* prob, int64_t begin, int64_t n, int64_t argmax_pos,
+                          float sum_prob) {
+  float max_prob = argmax_pos == -1 ? 0.0f : prob[argmax_pos];
+  for (int64_t i = begin; i < n; ++i) {
+    if (prob[i] > max_prob) {
+      max_prob = prob[i];
+      argmax_pos = i;
+    }
+    sum_prob += prob[i];
+    if (1 - sum_prob <= max_prob) {
+      break;
+    }
+  }
+  return argmax_pos;
+}
+
+/*! \brief Continue the prefix sum over the tail [begin, n) with scalar loop. */
+inline int64_t SamplePrefixSumTail(const float* prob, int64_t begin, int64_t n, double prob_sum,
+                                   double uniform_sample) {
+  for (int64_t i = begin; i < n; ++i) {
+    prob_sum += prob[i];
+    if (prob_sum >= uniform_sample) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*! \brief Continue the residual over the tail [begin, n) with scalar loop. */
+inline double ResidualTail(float* prob, const float* other_prob, int64_t begin, int64_t n) {
+  double residual_sum = 0.0;
+  for (int64_t i = begin; i < n; ++i) {
+    prob[i] = std::max(prob[i] - other_prob[i], 0.0f);
+    residual_sum += prob[i];
+  }
+  return residual_sum;
+}
+
+/****************** Scalar ******************/
+
+inline int64_t ArgMaxScalar(const float* prob, int64_t n) {
+  return ArgMaxTail(prob, 0, n, -1, 0.0f);
+}
+
+inline int64_t SamplePrefixSumScalar(const float* prob, int64_t n, double uniform_sample) {
+  return SamplePrefixSumTail(prob, 0, n, 0.0, uniform_sample);
+}
+
+inline int64_t FindNextAtLeastScalar(const float* prob, int64_t begin, int64_t n, float cutoff) {
+  for (int64_t i = begin; i < n; ++i) {
+    if (prob[i] >= cutoff) {
+      return i;
+    }
+  }
+  return n;
+}
+
+inline double ResidualScalar(float* prob, const float* other_prob, int64_t n) {
+  return ResidualTail(prob, other_prob, 0, n);
+}
+
+/****************** AVX2 ******************/
+
+#ifdef MLC_CPU_SAMPLER_X86
+
+__attribute__((target("avx2"))) inline float HorizontalSumAVX2(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2"))) inline float HorizontalMaxAVX2(__m256 v) {
+  __m128 max = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+  max = _mm_max_ss(max, _mm_movehdup_ps(max));
+  return _mm_cvtss_f32(max);
+}
+
+__attribute__((target("avx2"))) inline int64_t ArgMaxAVX2(const float* prob, int64_t n) {
+  constexpr int kLanes = 8;
+  int64_t n_vec = n / kLanes * kLanes;
+  __m256 vmax = _mm256_setzero_ps();
+  __m256 vsum = _mm256_setzero_ps();
+  __m256i vpos = _mm256_set1_epi32(-1);
+  __m256i vcur = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i vstep = _mm256_set1_epi32(kLanes);
+  int64_t i = 0;
+  bool early_exit = false;
+  while (i < n_vec && !early_exit) {
+    int64_t block_end = std::min(i + kArgMaxBlockSize, n_vec);
+    for (; i < block_end; i += kLanes) {
+      __m256 v = _mm256_loadu_ps(prob + i);
+      __m256 gt = _mm256_cmp_ps(v, vmax, _CMP_GT_OQ);
+      vmax = _mm256_blendv_ps(vmax, v, gt);
+      vpos = _mm256_castps_si256(
+          _mm256_blendv_ps(_mm256_castsi256_ps(vpos), _mm256_castsi256_ps(vcur), gt));
+      vcur = _mm256_add_epi32(vcur, vstep);
+      vsum = _mm256_add_ps(vsum, v);
+    }
+    early_exit = 1 - HorizontalSumAVX2(vsum) <= HorizontalMaxAVX2(vmax);
+  }
+  alignas(32) float lane_max[kLanes];
+  alignas(32) int32_t lane_pos[kLanes];
+  _mm256_store_ps(lane_max, vmax);
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lane_pos), vpos);
+  int64_t argmax_pos = ReduceArgMaxLanes(lane_max, lane_pos, kLanes);
+  if (early_exit) {
+    return argmax_pos;
+  }
+  return ArgMaxTail(prob, i, n, argmax_pos, HorizontalSumAVX2(vsum));
+}
+
+__attribute__((target("avx2"))) inline int64_t SamplePrefixSumAVX2(const float* prob, int64_t n,
+                                                                   double uniform_sample) {
+  double prob_sum = 0.0;
+  int64_t i = 0;
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    __m256 vsum = _mm256_setzero_ps();
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 8) {
+      vsum = _mm256_add_ps(vsum, _mm256_loadu_ps(prob + j));
+    }
+    double block_sum = HorizontalSumAVX2(vsum);
+    if (prob_sum + block_sum < uniform_sample) {
+      prob_sum += block_sum;
+      continue;
+    }
+    // The sample falls in this block, or the block sum is off by rounding.
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; ++j) {
+      prob_sum += prob[j];
+      if (prob_sum >= uniform_sample) {
+        return j;
+      }
+    }
+  }
+  return SamplePrefixSumTail(prob, i, n, prob_sum, uniform_sample);
+}
+
+__attribute__((target("avx2"))) inline int64_t FindNextAtLeastAVX2(const float* prob,
+                                                                   int64_t begin, int64_t n,
+                                                                   float cutoff) {
+  const __m256 vcutoff = _mm256_set1_ps(cutoff);
+  int64_t i = begin;
+  for (; i + 32 <= n; i += 32) {
+    uint32_t mask =
+        static_cast<uint32_t>(_mm256_movemask_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(prob + i), vcutoff, _CMP_GE_OQ))) |
+        static_cast<uint32_t>(_mm256_movemask_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(prob + i + 8), vcutoff, _CMP_GE_OQ)))
+            << 8 |
+        static_cast<uint32_t>(_mm256_movemask_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(prob + i + 16), vcutoff, _CMP_GE_OQ)))
+            << 16 |
+        static_cast<uint32_t>(_mm256_movemask_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(prob + i + 24), vcutoff, _CMP_GE_OQ)))
+            << 24;
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return FindNextAtLeastScalar(prob, i, n, cutoff);
+}
+
+__attribute__((target("avx2"))) inline double ResidualAVX2(float* prob, const float* other_prob,
+                                                           int64_t n) {
+  const __m256 vzero = _mm256_setzero_ps();
+  double residual_sum = 0.0;
+  int64_t i = 0;
+  // Sum up by blocks in float and across blocks in double, like the prefix sum.
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    __m256 vsum = vzero;
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 8) {
+      __m256 v = _mm256_max_ps(
+          _mm256_sub_ps(_mm256_loadu_ps(prob + j), _mm256_loadu_ps(other_prob + j)), vzero);
+      _mm256_storeu_ps(prob + j, v);
+      vsum = _mm256_add_ps(vsum, v);
+    }
+    residual_sum += HorizontalSumAVX2(vsum);
+  }
+  return residual_sum + ResidualTail(prob, other_prob, i, n);
+}
+
+/****************** AVX-512 ******************/
+
+__attribute__((target("avx512f"))) inline int64_t ArgMaxAVX512(const float* prob, int64_t n) {
+  constexpr int kLanes = 16;
+  int64_t n_vec = n / kLanes * kLanes;
+  __m512 vmax = _mm512_setzero_ps();
+  __m512 vsum = _mm512_setzero_ps();
+  __m512i vpos = _mm512_set1_epi32(-1);
+  __m512i vcur = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m512i vstep = _mm512_set1_epi32(kLanes);
+  int64_t i = 0;
+  bool early_exit = false;
+  while (i < n_vec && !early_exit) {
+    int64_t block_end = std::min(i + kArgMaxBlockSize, n_vec);
+    for (; i < block_end; i += kLanes) {
+      __m512 v = _mm512_loadu_ps(prob + i);
+      __mmask16 gt = _mm512_cmp_ps_mask(v, vmax, _CMP_GT_OQ);
+      vmax = _mm512_mask_blend_ps(gt, vmax, v);
+      vpos = _mm512_mask_blend_epi32(gt, vpos, vcur);
+      vcur = _mm512_add_epi32(vcur, vstep);
+      vsum = _mm512_add_ps(vsum, v);
+    }
+    early_exit = 1 - _mm512_reduce_add_ps(vsum) <= _mm512_reduce_max_ps(vmax);
+  }
+  alignas(64) float lane_max[kLanes];
+  alignas(64) int32_t lane_pos[kLanes];
+  _mm512_store_ps(lane_max, vmax);
+  _mm512_store_si512(lane_pos, vpos);
+  int64_t argmax_pos = ReduceArgMaxLanes(lane_max, lane_pos, kLanes);
+  if (early_exit) {
+    return argmax_pos;
+  }
+  return ArgMaxTail(prob, i, n, argmax_pos, _mm512_reduce_add_ps(vsum));
+}
+
+__attribute__((target("avx512f"))) inline int64_t SamplePrefixSumAVX512(const float* prob,
+                                                                        int64_t n,
+                                                                        double uniform_sample) {
+  double prob_sum = 0.0;
+  int64_t i = 0;
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    __m512 vsum = _mm512_setzero_ps();
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 16) {
+      vsum = _mm512_add_ps(vsum, _mm512_loadu_ps(prob + j));
+    }
+    double block_sum = _mm512_reduce_add_ps(vsum);
+    if (prob_sum + block_sum < uniform_sample) {
+      prob_sum += block_sum;
+      continue;
+    }
+    // The sample falls in this block, or the block sum is off by rounding.
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; ++j) {
+      prob_sum += prob[j];
+      if (prob_sum >= uniform_sample) {
+        return j;
+      }
+    }
+  }
+  return SamplePrefixSumTail(prob, i, n, prob_sum, uniform_sample);
+}
+
+__attribute__((target("avx512f"))) inline int64_t FindNextAtLeastAVX512(const float* prob,
+                                                                        int64_t begin, int64_t n,
+                                                                        float cutoff) {
+  const __m512 vcutoff = _mm512_set1_ps(cutoff);
+  int64_t i = begin;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t mask =
+        static_cast<uint64_t>(
+            _mm512_cmp_ps_mask(_mm512_loadu_ps(prob + i), vcutoff, _CMP_GE_OQ)) |
+        static_cast<uint64_t>(
+            _mm512_cmp_ps_mask(_mm512_loadu_ps(prob + i + 16), vcutoff, _CMP_GE_OQ))
+            << 16 |
+        static_cast<uint64_t>(
+            _mm512_cmp_ps_mask(_mm512_loadu_ps(prob + i + 32), vcutoff, _CMP_GE_OQ))
+            << 32 |
+        static_cast<uint64_t>(
+            _mm512_cmp_ps_mask(_mm512_loadu_ps(prob + i + 48), vcutoff, _CMP_GE_OQ))
+            << 48;
+    if (mask != 0) {
+      return i + __builtin_ctzll(mask);
+    }
+  }
+  return FindNextAtLeastScalar(prob, i, n, cutoff);
+}
+
+__attribute__((target("avx512f"))) inline double ResidualAVX512(float* prob,
+                                                                const float* other_prob,
+                                                                int64_t n) {
+  const __m512 vzero = _mm512_setzero_ps();
+  double residual_sum = 0.0;
+  int64_t i = 0;
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    __m512 vsum = vzero;
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 16) {
+      __m512 v = _mm512_max_ps(
+          _mm512_sub_ps(_mm512_loadu_ps(prob + j), _mm512_loadu_ps(other_prob + j)), vzero);
+      _mm512_storeu_ps(prob + j, v);
+      vsum = _mm512_add_ps(vsum, v);
+    }
+    residual_sum += _mm512_reduce_add_ps(vsum);
+  }
+  return residual_sum + ResidualTail(prob, other_prob, i, n);
+}
+
+#endif  // MLC_CPU_SAMPLER_X86
+
+/****************** NEON ******************/
+
+#ifdef MLC_CPU_SAMPLER_NEON
+
+inline int64_t ArgMaxNEON(const float* prob, int64_t n) {
+  constexpr int kLanes = 4;
+  int64_t n_vec = n / kLanes * kLanes;
+  float32x4_t vmax = vdupq_n_f32(0.0f);
+  float32x4_t vsum = vdupq_n_f32(0.0f);
+  int32x4_t vpos = vdupq_n_s32(-1);
+  int32x4_t vcur = {0, 1, 2, 3};
+  const int32x4_t vstep = vdupq_n_s32(kLanes);
+  int64_t i = 0;
+  bool early_exit = false;
+  while (i < n_vec && !early_exit) {
+    int64_t block_end = std::min(i + kArgMaxBlockSize, n_vec);
+    for (; i < block_end; i += kLanes) {
+      float32x4_t v = vld1q_f32(prob + i);
+      uint32x4_t gt = vcgtq_f32(v, vmax);
+      vmax = vbslq_f32(gt, v, vmax);
+      vpos = vbslq_s32(gt, vcur, vpos);
+      vcur = vaddq_s32(vcur, vstep);
+      vsum = vaddq_f32(vsum, v);
+    }
+    early_exit = 1 - vaddvq_f32(vsum) <= vmaxvq_f32(vmax);
+  }
+  float lane_max[kLanes];
+  int32_t lane_pos[kLanes];
+  vst1q_f32(lane_max, vmax);
+  vst1q_s32(lane_pos, vpos);
+  int64_t argmax_pos = ReduceArgMaxLanes(lane_max, lane_pos, kLanes);
+  if (early_exit) {
+    return argmax_pos;
+  }
+  return ArgMaxTail(prob, i, n, argmax_pos, vaddvq_f32(vsum));
+}
+
+inline int64_t SamplePrefixSumNEON(const float* prob, int64_t n, double uniform_sample) {
+  double prob_sum = 0.0;
+  int64_t i = 0;
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 4) {
+      vsum = vaddq_f32(vsum, vld1q_f32(prob + j));
+    }
+    double block_sum = vaddvq_f32(vsum);
+    if (prob_sum + block_sum < uniform_sample) {
+      prob_sum += block_sum;
+      continue;
+    }
+    // The sample falls in this block, or the block sum is off by rounding.
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; ++j) {
+      prob_sum += prob[j];
+      if (prob_sum >= uniform_sample) {
+        return j;
+      }
+    }
+  }
+  return SamplePrefixSumTail(prob, i, n, prob_sum, uniform_sample);
+}
+
+inline int64_t FindNextAtLeastNEON(const float* prob, int64_t begin, int64_t n, float cutoff) {
+  const float32x4_t vcutoff = vdupq_n_f32(cutoff);
+  int64_t i = begin;
+  for (; i + 16 <= n; i += 16) {
+    uint32x4_t mask = vorrq_u32(vorrq_u32(vcgeq_f32(vld1q_f32(prob + i), vcutoff),
+                                          vcgeq_f32(vld1q_f32(prob + i + 4), vcutoff)),
+                                vorrq_u32(vcgeq_f32(vld1q_f32(prob + i + 8), vcutoff),
+                                          vcgeq_f32(vld1q_f32(prob + i + 12), vcutoff)));
+    if (vmaxvq_u32(mask) != 0) {
+      return FindNextAtLeastScalar(prob, i, i + 16, cutoff);
+    }
+  }
+  return FindNextAtLeastScalar(prob, i, n, cutoff);
+}
+
+inline double ResidualNEON(float* prob, const float* other_prob, int64_t n) {
+  const float32x4_t vzero = vdupq_n_f32(0.0f);
+  double residual_sum = 0.0;
+  int64_t i = 0;
+  for (; i + kPrefixSumBlockSize <= n; i += kPrefixSumBlockSize) {
+    float32x4_t vsum = vzero;
+    for (int64_t j = i; j < i + kPrefixSumBlockSize; j += 4) {
+      float32x4_t v = vmaxq_f32(vsubq_f32(vld1q_f32(prob + j), vld1q_f32(other_prob + j)), vzero);
+      vst1q_f32(prob + j, v);
+      vsum = vaddq_f32(vsum, v);
+    }
+    residual_sum += vaddvq_f32(vsum);
+  }
+  return residual_sum + ResidualTail(prob, other_prob, i, n);
+}
+
+#endif  // MLC_CPU_SAMPLER_NEON
+
+/****************** Dispatch ******************/
+
+bool CPUSamplerISASupported(CPUSamplerISA isa) {
+  switch (isa) {
+    case CPUSamplerISA::kScalar:
+      return true;
+#ifdef MLC_CPU_SAMPLER_X86
+    case CPUSamplerISA::kAVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+    case CPUSamplerISA::kAVX512:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f");
+#endif
+#ifdef MLC_CPU_SAMPLER_NEON
+    case CPUSamplerISA::kNEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+const CPUSamplerKernels& GetCPUSamplerKernels(CPUSamplerISA isa) {
+  CHECK(CPUSamplerISASupported(isa))
+      << "The CPU does not support the " << CPUSamplerISAToString(isa) << " sampler kernels";
+  static const CPUSamplerKernels scalar_kernels{CPUSamplerISA::kScalar, ArgMaxScalar,
+                                                SamplePrefixSumScalar, FindNextAtLeastScalar,
+                                                ResidualScalar};
+#ifdef MLC_CPU_SAMPLER_X86
+  static const CPUSamplerKernels avx2_kernels{CPUSamplerISA::kAVX2, ArgMaxAVX2,
+                                              SamplePrefixSumAVX2, FindNextAtLeastAVX2,
+                                              ResidualAVX2};
+  static const CPUSamplerKernels avx512_kernels{CPUSamplerISA::kAVX512, ArgMaxAVX512,
+                                                SamplePrefixSumAVX512, FindNextAtLeastAVX512,
+                                                ResidualAVX512};
+  if (isa == CPUSamplerISA::kAVX2) {
+    return avx2_kernels;
+  } else if (isa == CPUSamplerISA::kAVX512) {
+    return avx512_kernels;
+  }
+#endif
+#ifdef MLC_CPU_SAMPLER_NEON
+  static const CPUSamplerKernels neon_kernels{CPUSamplerISA::kNEON, ArgMaxNEON,
+                                              SamplePrefixSumNEON, FindNextAtLeastNEON,
+                                              ResidualNEON};
+  if (isa == CPUSamplerISA::kNEON) {
+    return neon_kernels;
+  }
+#endif
+  return scalar_kernels;
+}
+
+const CPUSamplerKernels& GetCPUSamplerKernels() {
+  static const CPUSamplerKernels& kernels = []() -> const CPUSamplerKernels& {
+    for (CPUSamplerISA isa : {CPUSamplerISA::kAVX512, CPUSamplerISA::kAVX2, CPUSamplerISA::kNEON}) {
+      if (CPUSamplerISASupported(isa)) {
+        return GetCPUSamplerKernels(isa);
+      }
+    }
+    return GetCPUSamplerKernels(CPUSamplerISA::kScalar);
+  }();
+  return kernels;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,79 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/sampler/cpu_sampler_kernels.h
+ * \brief The vectorized kernels of the CPU sampler over a probability distribution.
+ */
+#ifndef MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_KERNELS_H_
+#define MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_KERNELS_H_
+
+#include <cstdint>
+#include <string>
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*! \brief The instruction set the CPU sampler kernels are vectorized with. */
+enum class CPUSamplerISA : int {
+  kScalar = 0,
+  kAVX2 = 1,
+  kAVX512 = 2,
+  kNEON = 3,
+};
+
+inline std::string CPUSamplerISAToString(CPUSamplerISA isa) {
+  if (isa == CPUSamplerISA::kScalar) {
+    return "scalar";
+  } else if (isa == CPUSamplerISA::kAVX2) {
+    return "avx2";
+  } else if (isa == CPUSamplerISA::kAVX512) {
+    return "avx512";
+  } else {
+    return "neon";
+  }
+}
+
+/*!
+ * \brief The kernels of the CPU sampler over a probability distribution, vectorized with an
+ * instruction set. The kernels of every instruction set return the same results as the scalar
+ * ones, except that the prefix sums and the residual sums may differ in rounding.
+ */
+struct CPUSamplerKernels {
+  /*! \brief The instruction set of the kernels. */
+  CPUSamplerISA isa;
+  /*!
+   * \brief Return the position of the first maximum probability, or -1 when all probabilities are
+   * zero. The scan stops once the remaining probability mass cannot exceed the maximum.
+   */
+  int64_t (*argmax)(const float* prob, int64_t n);
+  /*!
+   * \brief Return the first position whose inclusive prefix sum of probabilities is at least the
+   * given uniform sample, or -1 when there is none.
+   */
+  int64_t (*sample_prefix_sum)(const float* prob, int64_t n, double uniform_sample);
+  /*!
+   * \brief Return the first position in [begin, n) whose probability is at least the cutoff, or n
+   * when there is none.
+   */
+  int64_t (*find_next_at_least)(const float* prob, int64_t begin, int64_t n, float cutoff);
+  /*!
+   * \brief Replace the probabilities in place by the residual max(prob - other_prob, 0), and
+   * return the sum of the residual.
+   */
+  double (*residual)(float* prob, const float* other_prob, int64_t n);
+};
+
+/*! \brief Return whether the CPU supports the given instruction set. */
+bool CPUSamplerISASupported(CPUSamplerISA isa);
+
+/*! \brief Return the kernels of the given instruction set, which the CPU must support. */
+const CPUSamplerKernels& GetCPUSamplerKernels(CPUSamplerISA isa);
+
+/*! \brief Return the kernels of the widest instruction set the CPU supports. */
+const CPUSamplerKernels& GetCPUSamplerKernels();
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_SAMPLER_CPU_SAMPLER_KERNELS_H_
@@ -0,0 +1,101 @@
+/*!
+ *  Copyright (c) 2023-2024 by Contributors
+ * \file serve/sampler/deterministic_sampling.h
+ * \brief The fixed-point definition of deterministic sampling, which the CPU sampler implements
+ * on host and the GPU sampler with the "sample_deterministic" function of the model library.
+ *
+ * Each probability p is quantized to floor(p * 2^32) in int64. Integer sums are exact in any
+ * order, so the sampled token does not depend on how a device reduces the probabilities.
+ * Top p and min p are quantized to multiples of 2^-24 on host, and so is the uniform sample, which
+ * the counter-based random generator returns exactly. Given the quantized probabilities q:
+ * - top p keeps the probabilities no less than the first one in descending order whose
+ *   inclusive prefix sum reaches (top_p * sum(q)) >> 24, or all when top_p is 2^24;
+ * - top k keeps the probabilities no less than the k-th largest one, or all when k is the
+ *   vocabulary size;
+ * - min p keeps the probabilities q with q * 2^24 >= min_p * max(q);
+ * - the sampled token is the first one in vocabulary order whose inclusive prefix sum of the kept
+ *   probabilities exceeds (uniform_sample * sum(kept q)) >> 24.
+ * Ties are kept together, so the result does not depend on the order of sorting either.
+ */
+#ifndef MLC_LLM_SERVE_SAMPLER_DETERMINISTIC_SAMPLING_H_
+#define MLC_LLM_SERVE_SAMPLER_DETERMINISTIC_SAMPLING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "../config.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*! \brief The number of fractional bits of a quantized probability. */
+constexpr const int kDeterministicProbBits = 32;
+/*! \brief The number of fractional bits of quantized top p, min p and uniform sample. */
+constexpr const int kDeterministicFractionBits = 24;
+/*! \brief The quantized one of top p, min p and uniform sample. */
+constexpr const int32_t kDeterministicFractionOne = 1 << kDeterministicFractionBits;
+
+/*! \brief Quantize a probability, where scaling by a power of two is exact in float32. */
+inline int64_t QuantizeDeterministicProb(float prob) {
+  return static_cast<int64_t>(std::ldexp(prob, kDeterministicProbBits));
+}
+
+/*! \brief Quantize top p or min p in [0, 1] to the nearest. */
+inline int32_t QuantizeDeterministicFraction(double value) {
+  double quantized = std::round(std::ldexp(value, kDeterministicFractionBits));
+  return static_cast<int32_t>(std::clamp(quantized, 0.0, double{kDeterministicFractionOne}));
+}
+
+/*!
+ * \brief Quantize a uniform sample in [0, 1) down, which is exact for the multiples of 2^-24 that
+ * the counter-based random generator returns, in both double and float32.
+ */
+inline int32_t QuantizeDeterministicUniform(double uniform_sample) {
+  double quantized = std::floor(std::ldexp(uniform_sample, kDeterministicFractionBits));
+  return static_cast<int32_t>(std::clamp(quantized, 0.0, double{kDeterministicFractionOne - 1}));
+}
+
+/*! \brief The fixed-point truncation parameters of deterministic sampling. */
+struct DeterministicSamplingParams {
+  /*! \brief The quantized top p. */
+  int32_t top_p;
+  /*! \brief The top k, which is the vocabulary size when there is no top-k truncation. */
+  int32_t top_k;
+  /*! \brief The quantized min p. */
+  int32_t min_p;
+
+  static DeterministicSamplingParams FromGenerationConfig(const GenerationConfig& cfg,
+                                                          int vocab_size) {
+    return {QuantizeDeterministicFraction(cfg->top_p),
+            cfg->top_k > 0 ? std::min(cfg->top_k, vocab_size) : vocab_size,
+            QuantizeDeterministicFraction(cfg->min_p)};
+  }
+
+  bool operator==(const DeterministicSamplingParams& other) const {
+    return top_p == other.top_p && top_k == other.top_k && min_p == other.min_p;
+  }
+};
+
+/*! \brief Return the quantized prefix sum that top p keeps the probabilities up to. */
+inline int64_t DeterministicTopPTarget(int32_t top_p, int64_t prob_sum) {
+  return (top_p * prob_sum) >> kDeterministicFractionBits;
+}
+
+/*! \brief Return the smallest quantized probability that min p keeps. */
+inline int64_t DeterministicMinPCutoff(int32_t min_p, int64_t max_prob) {
+  return (min_p * max_prob + kDeterministicFractionOne - 1) >> kDeterministicFractionBits;
+}
+
+/*! \brief Return the quantized prefix sum that the sampled token is the first to exceed. */
+inline int64_t DeterministicSampleTarget(double uniform_sample, int64_t kept_prob_sum) {
+  return (QuantizeDeterministicUniform(uniform_sample) * kept_prob_sum) >>
+         kDeterministicFractionBits;
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
+
+#endif  // MLC_LLM_SERVE_SAMPLER_DETERMINISTIC_SAMPLING_H_
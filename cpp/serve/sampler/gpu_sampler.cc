@@ -10,6 +10,7 @@
 #include <tvm/runtime/registry.h>
 
 #include "../../support/random.h"
+#include "deterministic_sampling.h"
 #include "sampler.h"
 
 namespace mlc {
@@ -50,22 +51,29 @@ inline void SyncCopyStream(Device device, TVMStreamHandle compute_stream,
 class GPUSampler : public SamplerObj {
  public:
   explicit GPUSampler(int max_num_sample, int vocab_size, FunctionTable* ft, DLDevice device,
-                      Optional<EventTraceRecorder> trace_recorder)
+                      bool deterministic_sampling, Optional<EventTraceRecorder> trace_recorder)
       : max_num_sample_(max_num_sample),
         vocab_size_(vocab_size),
         flashinfer_sampling_available_(FlashInferSamplingAvailable(device)),
+        deterministic_sampling_(deterministic_sampling),
         device_(device),
         gpu_multinomial_from_uniform_func_(ft->gpu_multinomial_from_uniform_func_),
         gpu_argsort_probs_func_(ft->gpu_argsort_probs_func_),
         gpu_sample_with_top_p_func_(ft->gpu_sample_with_top_p_func_),
+        gpu_sample_with_top_k_top_p_func_(ft->gpu_sample_with_top_k_top_p_func_),
         gpu_sampler_take_probs_func_(ft->gpu_sampler_take_probs_func_),
         gpu_verify_draft_tokens_func_(ft->gpu_verify_draft_tokens_func_),
         gpu_renormalize_by_top_p_func_(ft->gpu_renormalize_by_top_p_func_),
+        gpu_renormalize_by_top_k_top_p_func_(ft->gpu_renormalize_by_top_k_top_p_func_),
+        gpu_sample_deterministic_func_(ft->gpu_sample_deterministic_func_),
         trace_recorder_(std::move(trace_recorder)) {
     ICHECK(gpu_multinomial_from_uniform_func_.defined());
     ICHECK(gpu_argsort_probs_func_.defined());
     ICHECK(gpu_sample_with_top_p_func_.defined());
     ICHECK(gpu_sampler_take_probs_func_.defined());
+    CHECK(!deterministic_sampling_ || gpu_sample_deterministic_func_.defined())
+        << "The model library does not support deterministic sampling on GPU. Please recompile "
+           "the model library.";
 
     flashinfer_multinomial_sample_func_ =
         Registry::Get("flashinfer.sampling.parallel_sampling_from_prob");
@@ -76,6 +84,10 @@ class GPUSampler : public SamplerObj {
     uniform_samples_host_ = NDArray::Empty({max_num_sample}, dtype_f32_, preferred_host_device);
     sample_indices_host_ = NDArray::Empty({max_num_sample}, dtype_i32_, preferred_host_device);
     top_p_host_ = NDArray::Empty({max_num_sample}, dtype_f32_, preferred_host_device);
+    top_k_host_ = NDArray::Empty({max_num_sample}, dtype_i32_, preferred_host_device);
+    min_p_host_ = NDArray::Empty({max_num_sample}, dtype_f32_, preferred_host_device);
+    top_p_fixed_point_host_ = NDArray::Empty({max_num_sample}, dtype_i32_, preferred_host_device);
+    min_p_fixed_point_host_ = NDArray::Empty({max_num_sample}, dtype_i32_, preferred_host_device);
     top_p_init_pivots_host_ = NDArray::Empty({max_num_sample, num_top_p_cutoff_pivots_}, dtype_f32_,
                                              preferred_host_device);
     top_prob_offsets_host_ =
@@ -96,6 +108,10 @@ class GPUSampler : public SamplerObj {
     uniform_samples_device_ = NDArray::Empty({max_num_sample}, dtype_f32_, device);
     sample_indices_device_ = NDArray::Empty({max_num_sample}, dtype_i32_, device);
     top_p_device_ = NDArray::Empty({max_num_sample}, dtype_f32_, device);
+    top_k_device_ = NDArray::Empty({max_num_sample}, dtype_i32_, device);
+    min_p_device_ = NDArray::Empty({max_num_sample}, dtype_f32_, device);
+    top_p_fixed_point_device_ = NDArray::Empty({max_num_sample}, dtype_i32_, device);
+    min_p_fixed_point_device_ = NDArray::Empty({max_num_sample}, dtype_i32_, device);
     top_p_init_pivots_device_ =
         NDArray::Empty({max_num_sample, num_top_p_cutoff_pivots_}, dtype_f32_, device);
     top_prob_offsets_device_ = NDArray::Empty({max_num_sample * 5}, dtype_i32_, device);
@@ -135,18 +151,47 @@ class GPUSampler : public SamplerObj {
     int vocab_size = probs_on_device->shape[1];
     ICHECK_LE(num_probs, max_num_sample_);
     ICHECK_EQ(generation_cfg.size(), num_samples);
+    if (deterministic_sampling_) {
+      // Deterministic sampling truncates the distributions in fixed point when sampling.
+      return probs_on_device;
+    }
 
-    // - Check if there is need for applying top p.
+    // - Check if there is need for applying top p, top k or min p.
     bool need_top_p = CheckTopP(generation_cfg, sample_indices, num_probs, num_samples, vocab_size);
-    if (!need_top_p) {
+    bool need_top_k =
+        CheckTopKMinP(generation_cfg, sample_indices, num_probs, num_samples, vocab_size);
+    if (!need_top_p && !need_top_k) {
       return probs_on_device;
     }
 
-    // - Copy auxiliary array for top-p and initial pivots.
+    // - Copy auxiliary array for top-p.
     NDArray top_p_host = top_p_host_.CreateView({num_probs}, dtype_f32_);
     NDArray top_p_device = top_p_device_.CreateView({num_probs}, dtype_f32_);
     CopyArray(/*src=*/top_p_host, /*dst=*/top_p_device, copy_stream_);
 
+    if (need_top_k) {
+      // - Renormalize the prob with top k, top p and min p over the sorted prob, which keeps the
+      // same tokens as the CPU sampler, so that draft verification does not depend on the sampler.
+      CHECK(gpu_renormalize_by_top_k_top_p_func_.defined())
+          << "The model library does not support top_k or min_p renormalization on GPU. Please "
+             "recompile the model library.";
+      NDArray top_k_host = top_k_host_.CreateView({num_probs}, dtype_i32_);
+      NDArray top_k_device = top_k_device_.CreateView({num_probs}, dtype_i32_);
+      CopyArray(/*src=*/top_k_host, /*dst=*/top_k_device, copy_stream_);
+      NDArray min_p_host = min_p_host_.CreateView({num_probs}, dtype_f32_);
+      NDArray min_p_device = min_p_device_.CreateView({num_probs}, dtype_f32_);
+      CopyArray(/*src=*/min_p_host, /*dst=*/min_p_device, copy_stream_);
+      SyncCopyStream(device_, compute_stream_, copy_stream_);
+
+      Array<NDArray> argsort_results = gpu_argsort_probs_func_(probs_on_device);
+      ICHECK_EQ(argsort_results.size(), 2);
+      NDArray renormed_probs_on_device = gpu_renormalize_by_top_k_top_p_func_(
+          argsort_results[0], argsort_results[1], top_p_device, top_k_device, min_p_device);
+      RECORD_EVENT(trace_recorder_, request_ids, "finish renormalization by top p");
+      return renormed_probs_on_device;
+    }
+
+    // - Copy the initial pivots for top-p.
     NDArray top_p_init_pivots_host =
         top_p_init_pivots_host_.CreateView({num_probs, num_top_p_cutoff_pivots_}, dtype_f32_);
     NDArray top_p_init_pivots_device =
@@ -323,7 +368,8 @@ class GPUSampler : public SamplerObj {
       }
       auto device_arrays =
           SampleOnGPU(probs_on_device, uniform_samples_device, sample_indices_device,
-                      /*need_top_p=*/false, need_prob_values, num_nodes, top_prob_offset_indptr);
+                      /*need_top_p=*/false, /*need_top_k=*/false, need_prob_values, num_nodes,
+                      top_prob_offset_indptr);
       auto host_arrays = CopyArraysToCPU(device_arrays, num_sequence, need_prob_values,
                                          top_prob_offset_indptr.back());
       additional_sample_result =
@@ -455,8 +501,19 @@ class GPUSampler : public SamplerObj {
     // - Check if there is need for applying top p or prob values,
     //   so that argsort is needed.
     bool need_top_p = false;
-    if (!top_p_applied) {
-      need_top_p = CheckTopP(generation_cfg, sample_indices, num_probs, num_samples, vocab_size);
+    bool need_top_k = false;
+    if (deterministic_sampling_) {
+      // - Deterministic sampling applies top-p, top-k and min-p in fixed point, where top p and
+      // top k need argsort.
+      need_top_p = CheckDeterministicParams(generation_cfg, sample_indices, num_probs, num_samples,
+                                            vocab_size);
+    } else {
+      // - Top-k and min-p are applied in renormalization together with top-p.
+      if (!top_p_applied) {
+        need_top_p = CheckTopP(generation_cfg, sample_indices, num_probs, num_samples, vocab_size);
+        need_top_k =
+            CheckTopKMinP(generation_cfg, sample_indices, num_probs, num_samples, vocab_size);
+      }
     }
     // The indptr array of the number of top probs for each sample.
     std::vector<int> top_prob_offset_indptr;
@@ -465,8 +522,13 @@ class GPUSampler : public SamplerObj {
 
     // - Sample tokens on GPU, and take out the probability values if needed.
     std::vector<NDArray> device_arrays =
-        SampleOnGPU(probs_on_device, uniform_samples_device, sample_indices_device, need_top_p,
-                    need_prob_values, num_probs, top_prob_offset_indptr);
+        deterministic_sampling_
+            ? SampleDeterministicOnGPU(probs_on_device, uniform_samples_device,
+                                       sample_indices_device, need_top_p, need_prob_values,
+                                       num_probs, top_prob_offset_indptr)
+            : SampleOnGPU(probs_on_device, uniform_samples_device, sample_indices_device,
+                          need_top_p, need_top_k, need_prob_values, num_probs,
+                          top_prob_offset_indptr);
 
     // - Copy the GPU sampling function results to CPU.
     std::vector<NDArray> host_arrays = CopyArraysToCPU(device_arrays, num_samples, need_prob_values,
@@ -543,6 +605,80 @@ class GPUSampler : public SamplerObj {
     return need_top_p;
   }
 
+  /*!
+   * \brief Check if top k or min p is needed. Update host top k and min p arrays in place, where
+   * no top k is represented by the vocabulary size.
+   */
+  bool CheckTopKMinP(const Array<GenerationConfig>& generation_cfg,
+                     const std::vector<int>& sample_indices, int num_probs, int num_samples,
+                     int vocab_size) {
+    int* p_top_k = static_cast<int*>(top_k_host_->data);
+    float* p_min_p = static_cast<float*>(min_p_host_->data);
+    std::fill(p_top_k, p_top_k + num_probs, -1);
+    std::fill(p_min_p, p_min_p + num_probs, 0.0f);
+    bool need_top_k = false;
+    for (int i = 0; i < num_samples; ++i) {
+      int top_k = generation_cfg[i]->top_k > 0 ? std::min(generation_cfg[i]->top_k, vocab_size)
+                                               : vocab_size;
+      if (p_top_k[sample_indices[i]] == -1) {
+        p_top_k[sample_indices[i]] = top_k;
+        p_min_p[sample_indices[i]] = generation_cfg[i]->min_p;
+        need_top_k |= top_k != vocab_size || generation_cfg[i]->min_p != 0.0;
+      } else {
+        CHECK(p_top_k[sample_indices[i]] == top_k &&
+              fabs(p_min_p[sample_indices[i]] - generation_cfg[i]->min_p) < eps_)
+            << "GPU sampler requires the top_k and min_p values for each prob distribution are "
+               "the same.";
+      }
+    }
+    for (int i = 0; i < num_probs; ++i) {
+      if (p_top_k[i] == -1) {
+        p_top_k[i] = vocab_size;
+      }
+    }
+    CHECK(!need_top_k || gpu_sample_with_top_k_top_p_func_.defined())
+        << "The model library does not support top_k or min_p sampling on GPU. Please recompile "
+           "the model library.";
+    return need_top_k;
+  }
+
+  /*!
+   * \brief Check if top p or top k is needed in deterministic sampling. Update host fixed-point top
+   * p, top k and fixed-point min p arrays in place.
+   */
+  bool CheckDeterministicParams(const Array<GenerationConfig>& generation_cfg,
+                                const std::vector<int>& sample_indices, int num_probs,
+                                int num_samples, int vocab_size) {
+    int* p_top_p = static_cast<int*>(top_p_fixed_point_host_->data);
+    int* p_top_k = static_cast<int*>(top_k_host_->data);
+    int* p_min_p = static_cast<int*>(min_p_fixed_point_host_->data);
+    std::fill(p_top_p, p_top_p + num_probs, kDeterministicFractionOne);
+    std::fill(p_top_k, p_top_k + num_probs, -1);
+    std::fill(p_min_p, p_min_p + num_probs, 0);
+    bool need_top_p = false;
+    for (int i = 0; i < num_samples; ++i) {
+      DeterministicSamplingParams params =
+          DeterministicSamplingParams::FromGenerationConfig(generation_cfg[i], vocab_size);
+      int row = sample_indices[i];
+      if (p_top_k[row] == -1) {
+        p_top_p[row] = params.top_p;
+        p_top_k[row] = params.top_k;
+        p_min_p[row] = params.min_p;
+        need_top_p |= params.top_p < kDeterministicFractionOne || params.top_k < vocab_size;
+      } else {
+        CHECK(params == DeterministicSamplingParams{p_top_p[row], p_top_k[row], p_min_p[row]})
+            << "GPU sampler requires the top_p, top_k and min_p values for each prob distribution "
+               "are the same.";
+      }
+    }
+    for (int i = 0; i < num_probs; ++i) {
+      if (p_top_k[i] == -1) {
+        p_top_k[i] = vocab_size;
+      }
+    }
+    return need_top_p;
+  }
+
   /*! \brief Check whether prob values are needed, and collect info when necessary. */
   bool CheckProbValues(const Array<GenerationConfig>& generation_cfg,
                        const std::vector<int>& sample_indices, int num_probs, int num_samples,
@@ -567,15 +703,17 @@ class GPUSampler : public SamplerObj {
   /*! \brief Sample tokens on GPU. Take out the probability values when needed. */
   std::vector<NDArray> SampleOnGPU(NDArray probs_on_device, NDArray uniform_samples_device,
                                    NDArray sample_indices_device,  //
-                                   bool need_top_p, bool need_prob_values, int num_probs,
+                                   bool need_top_p, bool need_top_k, bool need_prob_values,
+                                   int num_probs,
                                    const std::vector<int>& top_prob_offset_indptr) {
     NDArray sampled_token_ids_device{nullptr};
     NDArray sampled_probs_device{nullptr};
     NDArray top_prob_probs_device{nullptr};
     NDArray top_prob_indices_device{nullptr};
 
-    if (!need_top_p && !need_prob_values) {
-      // - Short path: If top_p and prob values are not needed, we directly sample from multinomial.
+    if (!need_top_p && !need_top_k && !need_prob_values) {
+      // - Short path: If top_p, top_k and prob values are not needed, we directly sample from
+      // multinomial.
       SyncCopyStream(device_, compute_stream_, copy_stream_);
       if (flashinfer_sampling_available_) {
         sampled_token_ids_device =
@@ -598,12 +736,22 @@ class GPUSampler : public SamplerObj {
 
     // - Copy auxiliary array for top-p and prob values in ahead.
     NDArray top_p_device;
+    NDArray top_k_device;
+    NDArray min_p_device;
     NDArray top_prob_offsets_device;
-    if (need_top_p) {
+    if (need_top_p || need_top_k) {
       NDArray top_p_host = top_p_host_.CreateView({num_probs}, dtype_f32_);
       top_p_device = top_p_device_.CreateView({num_probs}, dtype_f32_);
       CopyArray(/*src=*/top_p_host, /*dst=*/top_p_device, copy_stream_);
     }
+    if (need_top_k) {
+      NDArray top_k_host = top_k_host_.CreateView({num_probs}, dtype_i32_);
+      top_k_device = top_k_device_.CreateView({num_probs}, dtype_i32_);
+      CopyArray(/*src=*/top_k_host, /*dst=*/top_k_device, copy_stream_);
+      NDArray min_p_host = min_p_host_.CreateView({num_probs}, dtype_f32_);
+      min_p_device = min_p_device_.CreateView({num_probs}, dtype_f32_);
+      CopyArray(/*src=*/min_p_host, /*dst=*/min_p_device, copy_stream_);
+    }
     if (need_prob_values) {
       int num_top_probs = top_prob_offset_indptr.back();
       NDArray top_prob_offsets_host =
@@ -613,7 +761,12 @@ class GPUSampler : public SamplerObj {
     }
     SyncCopyStream(device_, compute_stream_, copy_stream_);
 
-    if (need_top_p) {
+    if (need_top_k) {
+      // - Sample with top_k, min_p and top_p applied.
+      sampled_token_ids_device = gpu_sample_with_top_k_top_p_func_(
+          sorted_probs_on_device, sorted_indices_on_device, uniform_samples_device,
+          sample_indices_device, top_p_device, top_k_device, min_p_device);
+    } else if (need_top_p) {
       // - Sample with top_p applied.
       sampled_token_ids_device =
           gpu_sample_with_top_p_func_(sorted_probs_on_device, sorted_indices_on_device,
@@ -645,6 +798,67 @@ class GPUSampler : public SamplerObj {
             top_prob_indices_device};
   }
 
+  /*!
+   * \brief Sample tokens deterministically on GPU. Take out the probability values when needed.
+   */
+  std::vector<NDArray> SampleDeterministicOnGPU(NDArray probs_on_device,
+                                                NDArray uniform_samples_device,
+                                                NDArray sample_indices_device,  //
+                                                bool need_top_p, bool need_prob_values,
+                                                int num_probs,
+                                                const std::vector<int>& top_prob_offset_indptr) {
+    // - Copy auxiliary array for the fixed-point parameters and prob values in ahead.
+    NDArray top_p_host = top_p_fixed_point_host_.CreateView({num_probs}, dtype_i32_);
+    NDArray top_p_device = top_p_fixed_point_device_.CreateView({num_probs}, dtype_i32_);
+    CopyArray(/*src=*/top_p_host, /*dst=*/top_p_device, copy_stream_);
+    NDArray top_k_host = top_k_host_.CreateView({num_probs}, dtype_i32_);
+    NDArray top_k_device = top_k_device_.CreateView({num_probs}, dtype_i32_);
+    CopyArray(/*src=*/top_k_host, /*dst=*/top_k_device, copy_stream_);
+    NDArray min_p_host = min_p_fixed_point_host_.CreateView({num_probs}, dtype_i32_);
+    NDArray min_p_device = min_p_fixed_point_device_.CreateView({num_probs}, dtype_i32_);
+    CopyArray(/*src=*/min_p_host, /*dst=*/min_p_device, copy_stream_);
+    NDArray top_prob_offsets_device;
+    if (need_prob_values) {
+      int num_top_probs = top_prob_offset_indptr.back();
+      NDArray top_prob_offsets_host =
+          top_prob_offsets_host_.CreateView({num_top_probs}, dtype_i32_);
+      top_prob_offsets_device = top_prob_offsets_device_.CreateView({num_top_probs}, dtype_i32_);
+      CopyArray(/*src=*/top_prob_offsets_host, /*dst=*/top_prob_offsets_device, copy_stream_);
+    }
+    SyncCopyStream(device_, compute_stream_, copy_stream_);
+
+    // - Argsort the probability. Without top p and top k, the unsorted probs stand in for the
+    // sorted ones, whose cutoffs are unused then.
+    NDArray sorted_probs_on_device = probs_on_device;
+    NDArray sorted_indices_on_device{nullptr};
+    if (need_top_p || need_prob_values) {
+      Array<NDArray> argsort_results = gpu_argsort_probs_func_(probs_on_device);
+      ICHECK_EQ(argsort_results.size(), 2);
+      sorted_probs_on_device = argsort_results[0];
+      sorted_indices_on_device = argsort_results[1];
+    }
+
+    NDArray sampled_token_ids_device = gpu_sample_deterministic_func_(
+        probs_on_device, sorted_probs_on_device, uniform_samples_device, sample_indices_device,
+        top_p_device, top_k_device, min_p_device);
+
+    NDArray sampled_probs_device{nullptr};
+    NDArray top_prob_probs_device{nullptr};
+    NDArray top_prob_indices_device{nullptr};
+    if (need_prob_values) {
+      // - Take the probability values.
+      Array<NDArray> prob_value_results = gpu_sampler_take_probs_func_(
+          probs_on_device, sorted_indices_on_device, sample_indices_device,
+          sampled_token_ids_device, top_prob_offsets_device);
+      sampled_probs_device = prob_value_results[0];
+      top_prob_probs_device = prob_value_results[1];
+      top_prob_indices_device = prob_value_results[2];
+    }
+
+    return {sampled_token_ids_device, sampled_probs_device, top_prob_probs_device,
+            top_prob_indices_device};
+  }
+
   /*! \brief Copy the results of GPU sampling functions back to CPU. */
   std::vector<NDArray> CopyArraysToCPU(const std::vector<NDArray>& device_arrays,  //
                                        int num_samples, bool need_prob_values, int num_top_probs) {
@@ -693,19 +907,27 @@ class GPUSampler : public SamplerObj {
   const DLDataType dtype_i32_ = DataType::Int(32);
   const DLDataType dtype_f32_ = DataType::Float(32);
   const bool flashinfer_sampling_available_;
+  const bool deterministic_sampling_;
   // Functions for sampling on GPU.
   Device device_;
   PackedFunc gpu_multinomial_from_uniform_func_;
   PackedFunc gpu_argsort_probs_func_;
   PackedFunc gpu_sample_with_top_p_func_;
+  PackedFunc gpu_sample_with_top_k_top_p_func_;
   PackedFunc gpu_sampler_take_probs_func_;
   PackedFunc gpu_verify_draft_tokens_func_;
   PackedFunc gpu_renormalize_by_top_p_func_;
+  PackedFunc gpu_renormalize_by_top_k_top_p_func_;
+  PackedFunc gpu_sample_deterministic_func_;
   const PackedFunc* flashinfer_multinomial_sample_func_;
   // Auxiliary NDArrays on CPU
   NDArray uniform_samples_host_;
   NDArray sample_indices_host_;
   NDArray top_p_host_;
+  NDArray top_k_host_;
+  NDArray min_p_host_;
+  NDArray top_p_fixed_point_host_;
+  NDArray min_p_fixed_point_host_;
   NDArray top_p_init_pivots_host_;
   NDArray top_prob_offsets_host_;
   NDArray draft_tokens_host_;
@@ -720,6 +942,10 @@ class GPUSampler : public SamplerObj {
   NDArray uniform_samples_device_;
   NDArray sample_indices_device_;
   NDArray top_p_device_;
+  NDArray top_k_device_;
+  NDArray min_p_device_;
+  NDArray top_p_fixed_point_device_;
+  NDArray min_p_fixed_point_device_;
   NDArray top_p_init_pivots_device_;
   NDArray top_prob_offsets_device_;
   NDArray draft_tokens_device_;
@@ -738,9 +964,10 @@ class GPUSampler : public SamplerObj {
 };
 
 Sampler Sampler::CreateGPUSampler(int max_num_sample, int vocab_size, FunctionTable* ft,
-                                  DLDevice device, Optional<EventTraceRecorder> trace_recorder) {
-  return Sampler(
-      make_object<GPUSampler>(max_num_sample, vocab_size, ft, device, std::move(trace_recorder)));
+                                  DLDevice device, bool deterministic_sampling,
+                                  Optional<EventTraceRecorder> trace_recorder) {
+  return Sampler(make_object<GPUSampler>(max_num_sample, vocab_size, ft, device,
+                                         deterministic_sampling, std::move(trace_recorder)));
 }
 
 }  // namespace serve
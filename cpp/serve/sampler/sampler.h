@@ -34,6 +34,8 @@ class SamplerObj : public Object {
  public:
   /*!
    * \brief Renormalize the input batch of probability distributions with top p values.
+   * Both samplers also truncate the distributions with top k and min p values here, so that the
+   * draft verification of speculative decoding sees the same distributions.
    * \param probs_on_device The batch of prob distributions before normalization.
    * \param sample_indices Specifying which request we will sample for
    * in i-th output for the sampling later on.
@@ -128,18 +130,25 @@ class SamplerObj : public Object {
 
 class Sampler : public ObjectRef {
  public:
-  /*! * \brief Create a CPU sampler. */
-  static Sampler CreateCPUSampler(Optional<EventTraceRecorder> trace_recorder);
+  /*!
+   * \brief Create a CPU sampler.
+   * \param deterministic_sampling Whether to sample deterministically.
+   * \param trace_recorder The event trace recorder.
+   */
+  static Sampler CreateCPUSampler(bool deterministic_sampling,
+                                  Optional<EventTraceRecorder> trace_recorder);
   /*!
    * \brief Create a GPU sampler.
    * \param max_num_sample The max number of samples to sample at a time.
    * \param vocab_size The model's vocabulary size.
    * \param ft The packed function table.
    * \param device The device that the model runs on.
+   * \param deterministic_sampling Whether to sample deterministically.
    * \param trace_recorder The event trace recorder.
    */
   static Sampler CreateGPUSampler(int max_num_sample, int vocab_size, FunctionTable* ft,
-                                  DLDevice device, Optional<EventTraceRecorder> trace_recorder);
+                                  DLDevice device, bool deterministic_sampling,
+                                  Optional<EventTraceRecorder> trace_recorder);
 
   /*! \brief Check if the given device supports GPU sampling. */
   static bool SupportGPUSampler(Device device) {
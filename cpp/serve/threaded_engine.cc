@@ -107,6 +107,7 @@ class ThreadedEngineImpl : public ThreadedEngine {
   }
 
   void AddRequest(Request request) final {
+    EstimateCachedPrefixLength(request);
     bool need_notify = false;
     {
       std::lock_guard<std::mutex> lock(background_loop_mutex_);
@@ -183,6 +184,7 @@ class ThreadedEngineImpl : public ThreadedEngine {
       }
       if (background_engine_ != nullptr) {
         background_engine_->Step();
+        PublishPrefixCacheSnapshot(background_engine_->GetPrefixCacheSnapshot());
       }
     }
   }
@@ -267,6 +269,46 @@ class ThreadedEngineImpl : public ThreadedEngine {
   }
 
  private:
+  /*!
+   * \brief Match the pre-tokenized request against the latest prefix cache snapshot, so that the
+   * engine can rank the waiting requests by cached prefix length without touching prefix cache.
+   * It runs on the thread adding the request. The requests with untokenized inputs are skipped,
+   * as they are tokenized in the background loop.
+   */
+  void EstimateCachedPrefixLength(const Request& request) {
+    std::vector<int32_t> tokens;
+    for (const Data& input : request->inputs) {
+      const auto* token_data = input.as<TokenDataNode>();
+      if (token_data == nullptr) {
+        return;
+      }
+      tokens.insert(tokens.end(), token_data->token_ids.begin(), token_data->token_ids.end());
+    }
+    PagedRadixTreeSnapshot snapshot;
+    {
+      std::lock_guard<std::mutex> lock(prefix_cache_snapshot_mutex_);
+      snapshot = prefix_cache_snapshot_;
+    }
+    if (snapshot.defined()) {
+      request->cached_prefix_length = static_cast<int>(snapshot->MatchPrefixLength(tokens));
+      request->cached_prefix_snapshot_version = snapshot->version;
+    }
+  }
+
+  /*!
+   * \brief Publish the prefix cache snapshot to the threads adding requests. The old snapshot is
+   * swapped into the argument and released out of the critical region, and it is reclaimed when
+   * its last reader finishes. Publishing is skipped when the snapshot is unchanged, which is only
+   * written by the background loop.
+   */
+  void PublishPrefixCacheSnapshot(PagedRadixTreeSnapshot snapshot) {
+    if (snapshot.same_as(prefix_cache_snapshot_)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(prefix_cache_snapshot_mutex_);
+    std::swap(prefix_cache_snapshot_, snapshot);
+  }
+
   void EngineReloadImpl(const std::string& engine_config_json_str) {
     auto frequest_stream_callback_wrapper = [this](Array<RequestStreamOutput> delta_outputs) {
       bool need_notify = false;
@@ -301,6 +343,7 @@ class ThreadedEngineImpl : public ThreadedEngine {
     if (background_engine_ != nullptr) {
       background_engine_->AbortAllRequests();
       background_engine_ = nullptr;
+      PublishPrefixCacheSnapshot(PagedRadixTreeSnapshot());
       // Clear the allocated memory in cached memory pool.
       const PackedFunc* fclear_memory_manager =
           tvm::runtime::Registry::Get("vm.builtin.memory_manager.clear");
@@ -335,6 +378,7 @@ class ThreadedEngineImpl : public ThreadedEngine {
   std::mutex background_loop_mutex_;
   std::mutex request_stream_callback_mutex_;
   std::mutex reload_unload_mutex_;
+  std::mutex prefix_cache_snapshot_mutex_;
   /*! \brief The condition variable preventing threaded engine from spinning. */
   std::condition_variable background_loop_cv_;
   std::condition_variable request_stream_callback_cv_;
@@ -378,6 +422,11 @@ class ThreadedEngineImpl : public ThreadedEngine {
   bool reload_finished_ = false;
   /*! \brief A boolean indicating if the engine unload has finished. */
   bool unload_finished_ = false;
+  /*!
+   * \brief The latest prefix cache snapshot published by the background loop, which is read by
+   * the threads adding requests. It is undefined when prefix cache is disabled.
+   */
+  PagedRadixTreeSnapshot prefix_cache_snapshot_;
 };
 
 /*! \brief The implementation of ThreadedEngine. */
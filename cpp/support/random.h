@@ -7,28 +7,89 @@
 #ifndef MLC_LLM_SUPPORT_RANDOM_H_
 #define MLC_LLM_SUPPORT_RANDOM_H_
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <random>
 
 namespace mlc {
 namespace llm {
 
+/*!
+ * \brief The Philox4x32-10 counter-based random function, which maps a 128-bit counter and a
+ * 64-bit key to 128 random bits. Unlike a sequential generator, the random bits at any counter
+ * are computed directly without the ones before it.
+ */
+inline std::array<uint32_t, 4> Philox4x32(std::array<uint32_t, 4> counter,
+                                          std::array<uint32_t, 2> key) {
+  constexpr uint32_t kMultiplier0 = 0xD2511F53;
+  constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+  constexpr uint32_t kWeyl0 = 0x9E3779B9;
+  constexpr uint32_t kWeyl1 = 0xBB67AE85;
+  for (int round = 0; round < 10; ++round) {
+    uint64_t product0 = static_cast<uint64_t>(kMultiplier0) * counter[0];
+    uint64_t product1 = static_cast<uint64_t>(kMultiplier1) * counter[2];
+    counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+               static_cast<uint32_t>(product1),
+               static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+               static_cast<uint32_t>(product0)};
+    key[0] += kWeyl0;
+    key[1] += kWeyl1;
+  }
+  return counter;
+}
+
 // Random number generator
 class RandomGenerator {
  private:
   std::mt19937 gen;
   std::uniform_real_distribution<> dis;
+  /*! \brief Whether the random numbers come from the counter-based stream of the seed. */
+  bool counter_based_ = false;
+  /*! \brief The seed, which keys the counter-based stream. */
+  uint64_t seed_ = 0;
+  /*!
+   * \brief The number of random numbers drawn from the counter-based stream so far, which is the
+   * index of the next draw. It counts the draws rather than the token positions of the request.
+   */
+  uint64_t num_draws_ = 0;
 
  public:
-  RandomGenerator(int seed = std::random_device{}()) : gen(seed), dis(0.0, 1.0) {}
+  RandomGenerator(int seed = std::random_device{}(), bool counter_based = false)
+      : gen(seed),
+        dis(0.0, 1.0),
+        counter_based_(counter_based),
+        seed_(static_cast<uint32_t>(seed)) {}
 
   static RandomGenerator& GetInstance(int seed = std::random_device{}()) {
     static RandomGenerator instance(seed);
     return instance;
   }
 
-  double GetRandomNumber() { return dis(gen); }
+  double GetRandomNumber() {
+    if (counter_based_) {
+      return GetCounterBasedRandomNumber(seed_, num_draws_++);
+    }
+    return dis(gen);
+  }
+
+  void SetSeed(int seed) {
+    gen.seed(seed);
+    seed_ = static_cast<uint32_t>(seed);
+    num_draws_ = 0;
+  }
 
-  void SetSeed(int seed) { gen.seed(seed); }
+  /*!
+   * \brief Return the random number in [0, 1) of the given draw index in the counter-based stream
+   * of the seed. The number is a multiple of 2^-24, which is exact in float32, so that it is the
+   * same whether a sampler consumes it in double or in float32.
+   */
+  static double GetCounterBasedRandomNumber(uint64_t seed, uint64_t draw_index) {
+    std::array<uint32_t, 4> bits = Philox4x32(
+        {static_cast<uint32_t>(draw_index), static_cast<uint32_t>(draw_index >> 32), 0, 0},
+        {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)});
+    return std::ldexp(static_cast<double>(bits[0] >> 8), -24);
+  }
 };
 
 }  // namespace llm
@@ -39,9 +39,12 @@ class AttachGPUSamplingFunc:  # pylint: disable=too-few-public-methods
                 _attach_multinomial_sampling_func(bb),
                 _attach_argsort_func(bb),
                 _attach_sample_with_top_p(bb),
+                _attach_sample_with_top_k_top_p(bb),
                 _attach_take_probs_func(bb),
                 _attach_batch_verifier(bb),
                 _attach_renormalize_by_top_p(bb, self.target),
+                _attach_renormalize_by_top_k_top_p(bb),
+                _attach_sample_deterministic(bb),
             ]
         ]
 
@@ -223,6 +226,254 @@ def _attach_sample_with_top_p(bb: relax.BlockBuilder):  # pylint: disable=too-ma
     return gv
 
 
+def _attach_sample_with_top_k_top_p(bb: relax.BlockBuilder):  # pylint: disable=too-many-locals
+    batch_size = tir.SizeVar("batch_size", "int64")
+    num_samples = tir.SizeVar("num_samples", "int64")
+    vocab_size = tir.SizeVar("vocab_size", "int64")
+    sorted_probs = relax.Var(
+        "sorted_probs", relax.TensorStructInfo((batch_size, vocab_size), "float32")
+    )
+    sorted_indices = relax.Var(
+        "sorted_indices", relax.TensorStructInfo((batch_size, vocab_size), "int32")
+    )
+    uniform_samples = relax.Var(
+        "uniform_samples", relax.TensorStructInfo((num_samples,), "float32")
+    )
+    sample_indices = relax.Var("sample_indices", relax.TensorStructInfo((num_samples,), "int32"))
+    top_p = relax.Var("top_p", relax.TensorStructInfo((batch_size,), "float32"))
+    top_k = relax.Var("top_k", relax.TensorStructInfo((batch_size,), "int32"))
+    min_p = relax.Var("min_p", relax.TensorStructInfo((batch_size,), "float32"))
+
+    def _top_k_with_min_p(sorted_probs: te.Tensor, top_k: te.Tensor, min_p: te.Tensor):
+        # The sorted probs no less than min p of the maximum form a prefix, so min p
+        # truncates the sorted probs to the number of such probs.
+        k = te.reduce_axis((0, vocab_size), name="k")
+        num_above_min_p = te.compute(
+            (batch_size,),
+            lambda i: te.sum(
+                tir.Select(sorted_probs[i, k] >= min_p[i] * sorted_probs[i, 0], 1, 0), axis=k
+            ),
+            name="num_above_min_p",
+        )
+        return te.compute(
+            (batch_size, 1),
+            lambda i, _: tir.max(tir.min(top_k[i], num_above_min_p[i]), 1),
+            name="top_k_with_min_p",
+        )
+
+    with bb.function(
+        "sample_with_top_k_top_p",
+        [sorted_probs, sorted_indices, uniform_samples, sample_indices, top_p, top_k, min_p],
+    ):
+        with bb.dataflow():
+            sample_shape = relax.ShapeExpr([num_samples, 1])
+            top_p_shape = relax.ShapeExpr([batch_size, 1])
+            sorted_probs_tensor = nn.wrap_nested(sorted_probs, name="sorted_probs")
+            sorted_indices_tensor = nn.wrap_nested(sorted_indices, name="sorted_indices")
+            uniform_samples_tensor = nn.wrap_nested(
+                relax.call_pure_packed(
+                    "vm.builtin.reshape",
+                    uniform_samples,
+                    sample_shape,
+                    sinfo_args=relax.TensorStructInfo(sample_shape, "float32"),
+                ),
+                name="uniform_samples",
+            )
+            sample_indices_tensor = nn.wrap_nested(
+                relax.call_pure_packed(
+                    "vm.builtin.reshape",
+                    sample_indices,
+                    sample_shape,
+                    sinfo_args=relax.TensorStructInfo(sample_shape, "int32"),
+                ),
+                name="sample_indices",
+            )
+            top_p_tensor = nn.wrap_nested(
+                relax.call_pure_packed(
+                    "vm.builtin.reshape",
+                    top_p,
+                    top_p_shape,
+                    sinfo_args=relax.TensorStructInfo(top_p_shape, "float32"),
+                ),
+                name="top_p",
+            )
+            top_k_tensor = nn.wrap_nested(
+                bb.emit_te(
+                    _top_k_with_min_p,
+                    sorted_probs,
+                    top_k,
+                    min_p,
+                    primfunc_name_hint="top_k_with_min_p",
+                ),
+                name="top_k",
+            )
+
+            result_tensor = (
+                nn.sample_top_p_top_k_from_sorted_prob(  # pylint:disable=too-many-function-args
+                    sorted_probs_tensor,
+                    sorted_indices_tensor,
+                    top_p_tensor,
+                    top_k_tensor,
+                    uniform_samples_tensor,
+                    sample_indices_tensor,
+                )
+            )
+            result = bb.emit_output(
+                relax.call_pure_packed(
+                    "vm.builtin.reshape",
+                    result_tensor._expr,  # pylint: disable=protected-access
+                    sample_indices.struct_info.shape,  # pylint: disable=no-member
+                    sinfo_args=sample_indices.struct_info,  # pylint: disable=no-member
+                )
+            )
+        gv = bb.emit_func_output(result)
+    return gv
+
+
+def _attach_sample_deterministic(bb: relax.BlockBuilder):  # pylint: disable=too-many-locals
+    """Sample tokens in the fixed-point definition of deterministic sampling, which the CPU sampler
+    shares (see cpp/serve/sampler/deterministic_sampling.h). The probabilities are quantized to
+    int64, whose sums are exact in any reduction order. The top p and min p are quantized on host,
+    and the top k of the rows without top-k truncation is the vocabulary size."""
+    batch_size = tir.SizeVar("batch_size", "int64")
+    num_samples = tir.SizeVar("num_samples", "int64")
+    vocab_size = tir.SizeVar("vocab_size", "int64")
+    probs = relax.Var("probs", relax.TensorStructInfo((batch_size, vocab_size), "float32"))
+    sorted_probs = relax.Var(
+        "sorted_probs", relax.TensorStructInfo((batch_size, vocab_size), "float32")
+    )
+    uniform_samples = relax.Var(
+        "uniform_samples", relax.TensorStructInfo((num_samples,), "float32")
+    )
+    sample_indices = relax.Var("sample_indices", relax.TensorStructInfo((num_samples,), "int32"))
+    top_p = relax.Var("top_p", relax.TensorStructInfo((batch_size,), "int32"))
+    top_k = relax.Var("top_k", relax.TensorStructInfo((batch_size,), "int32"))
+    min_p = relax.Var("min_p", relax.TensorStructInfo((batch_size,), "int32"))
+
+    # The fixed-point constants, which are kDeterministicProbBits and kDeterministicFractionBits.
+    prob_bits = 32
+    fraction_bits = 24
+    shift = tir.const(fraction_bits, "int64")
+    fraction_one = tir.const(1 << fraction_bits, "int64")
+    zero = tir.const(0, "int64")
+
+    def _quantize(value: tir.PrimExpr, num_bits: int):
+        return tir.floor(value * tir.const(2.0**num_bits, "float32")).astype("int64")
+
+    def _quantize_probs(probs: te.Tensor):
+        return te.compute(
+            (batch_size, vocab_size),
+            lambda i, j: _quantize(probs[i, j], prob_bits),
+            name="quantize_probs",
+        )
+
+    def _cutoff(  # pylint: disable=too-many-arguments
+        quantized_probs: te.Tensor,
+        sorted_quantized_probs: te.Tensor,
+        sorted_cumsum: te.Tensor,
+        top_p: te.Tensor,
+        top_k: te.Tensor,
+        min_p: te.Tensor,
+    ):
+        # The first sorted prob whose prefix sum reaches the target is the largest among the
+        # sorted probs whose prefix sums reach the target.
+        k = te.reduce_axis((0, vocab_size), name="k")
+        top_p_cutoff = te.compute(
+            (batch_size,),
+            lambda i: te.max(
+                tir.Select(
+                    sorted_cumsum[i, k]
+                    >= (top_p[i].astype("int64") * sorted_cumsum[i, vocab_size - 1]) >> shift,
+                    sorted_quantized_probs[i, k],
+                    zero,
+                ),
+                axis=k,
+            ),
+            name="top_p_cutoff",
+        )
+        k = te.reduce_axis((0, vocab_size), name="k")
+        max_prob = te.compute(
+            (batch_size,), lambda i: te.max(quantized_probs[i, k], axis=k), name="max_prob"
+        )
+        return te.compute(
+            (batch_size,),
+            lambda i: tir.max(
+                tir.max(
+                    tir.Select(top_p[i].astype("int64") < fraction_one, top_p_cutoff[i], zero),
+                    tir.Select(
+                        top_k[i].astype("int64") < vocab_size,
+                        sorted_quantized_probs[i, top_k[i] - 1],
+                        zero,
+                    ),
+                ),
+                (min_p[i].astype("int64") * max_prob[i] + fraction_one - 1) >> shift,
+            ),
+            name="cutoff",
+        )
+
+    def _keep_probs(quantized_probs: te.Tensor, cutoff: te.Tensor):
+        return te.compute(
+            (batch_size, vocab_size),
+            lambda i, j: tir.Select(
+                quantized_probs[i, j] >= cutoff[i], quantized_probs[i, j], zero
+            ),
+            name="keep_probs",
+        )
+
+    def _sample(kept_cumsum: te.Tensor, uniform_samples: te.Tensor, sample_indices: te.Tensor):
+        # The sampled token is the number of positions whose prefix sums do not exceed the target.
+        def _target(s: tir.PrimExpr):
+            uniform_sample = tir.min(_quantize(uniform_samples[s], fraction_bits), fraction_one - 1)
+            return (uniform_sample * kept_cumsum[sample_indices[s], vocab_size - 1]) >> shift
+
+        k = te.reduce_axis((0, vocab_size), name="k")
+        return te.compute(
+            (num_samples,),
+            lambda s: te.sum(
+                tir.Select(kept_cumsum[sample_indices[s], k] <= _target(s), 1, 0), axis=k
+            ),
+            name="sample_deterministic",
+        )
+
+    with bb.function(
+        "sample_deterministic",
+        [probs, sorted_probs, uniform_samples, sample_indices, top_p, top_k, min_p],
+    ):
+        with bb.dataflow():
+            quantized_probs = bb.emit_te(
+                _quantize_probs, probs, primfunc_name_hint="quantize_probs"
+            )
+            sorted_quantized_probs = bb.emit_te(
+                _quantize_probs, sorted_probs, primfunc_name_hint="quantize_probs"
+            )
+            sorted_cumsum = bb.emit(relax.op.cumsum(sorted_quantized_probs, axis=1, dtype="int64"))
+            cutoff = bb.emit_te(
+                _cutoff,
+                quantized_probs,
+                sorted_quantized_probs,
+                sorted_cumsum,
+                top_p,
+                top_k,
+                min_p,
+                primfunc_name_hint="deterministic_cutoff",
+            )
+            kept_probs = bb.emit_te(
+                _keep_probs, quantized_probs, cutoff, primfunc_name_hint="keep_probs"
+            )
+            kept_cumsum = bb.emit(relax.op.cumsum(kept_probs, axis=1, dtype="int64"))
+            result = bb.emit_output(
+                bb.emit_te(
+                    _sample,
+                    kept_cumsum,
+                    uniform_samples,
+                    sample_indices,
+                    primfunc_name_hint="sample_deterministic",
+                )
+            )
+        gv = bb.emit_func_output(result)
+    return gv
+
+
 def _attach_renormalize_by_top_p(bb: relax.BlockBuilder, target: tvm.target.Target):
     batch_size = tir.SizeVar("batch_size", "int64")
     vocab_size = tir.SizeVar("vocab_size", "int64")
@@ -254,6 +505,91 @@ def _attach_renormalize_by_top_p(bb: relax.BlockBuilder, target: tvm.target.Targ
     return gv
 
 
+def _attach_renormalize_by_top_k_top_p(bb: relax.BlockBuilder):  # pylint: disable=too-many-locals
+    """Renormalize the probs with top k, top p and min p in the definition of the CPU sampler
+    (see RenormalizeProbByTopKTopPMinP in cpp/serve/sampler/cpu_sampler.cc). Each of them keeps a
+    prefix of the sorted probs, and the kept tokens are the shortest of the prefixes, which
+    always contains the first token."""
+    batch_size = tir.SizeVar("batch_size", "int64")
+    vocab_size = tir.SizeVar("vocab_size", "int64")
+    sorted_probs = relax.Var(
+        "sorted_probs", relax.TensorStructInfo((batch_size, vocab_size), "float32")
+    )
+    sorted_indices = relax.Var(
+        "sorted_indices", relax.TensorStructInfo((batch_size, vocab_size), "int32")
+    )
+    top_p = relax.Var("top_p", relax.TensorStructInfo((batch_size,), "float32"))
+    top_k = relax.Var("top_k", relax.TensorStructInfo((batch_size,), "int32"))
+    min_p = relax.Var("min_p", relax.TensorStructInfo((batch_size,), "float32"))
+    # The epsilon of top p comparison in the CPU sampler.
+    eps = tir.const(1e-5, "float32")
+
+    def _renormalize_sorted(  # pylint: disable=too-many-arguments
+        sorted_probs: te.Tensor,
+        sorted_cumsum: te.Tensor,
+        top_p: te.Tensor,
+        top_k: te.Tensor,
+        min_p: te.Tensor,
+    ):
+        # A sorted prob is kept when the probs before it do not reach top p, and it is within
+        # top k and no less than min p of the maximum. The conditions are monotone in the position.
+        k = te.reduce_axis((0, vocab_size), name="k")
+        num_kept = te.compute(
+            (batch_size,),
+            lambda i: te.sum(
+                tir.Select(
+                    tir.any(
+                        k == 0,
+                        tir.all(
+                            k < top_k[i].astype("int64"),
+                            sorted_probs[i, k] >= min_p[i] * sorted_probs[i, 0],
+                            sorted_cumsum[i, k] - sorted_probs[i, k] < top_p[i] - eps,
+                        ),
+                    ),
+                    1,
+                    0,
+                ),
+                axis=k,
+            ),
+            name="num_kept",
+        )
+        return te.compute(
+            (batch_size, vocab_size),
+            lambda i, j: tir.Select(
+                j < num_kept[i].astype("int64"),
+                sorted_probs[i, j] / sorted_cumsum[i, num_kept[i] - 1],
+                tir.const(0, "float32"),
+            ),
+            name="renormalize_sorted",
+        )
+
+    with bb.function(
+        "renormalize_by_top_k_top_p", [sorted_probs, sorted_indices, top_p, top_k, min_p]
+    ):
+        with bb.dataflow():
+            sorted_cumsum = bb.emit(relax.op.cumsum(sorted_probs, axis=1))
+            renormalized_sorted_probs = bb.emit_te(
+                _renormalize_sorted,
+                sorted_probs,
+                sorted_cumsum,
+                top_p,
+                top_k,
+                min_p,
+                primfunc_name_hint="renormalize_sorted_by_top_k_top_p",
+            )
+            # Scatter the renormalized probs back to the token order.
+            renormalized_probs = bb.emit_output(
+                relax.op.scatter_elements(
+                    relax.op.zeros_like(sorted_probs),
+                    sorted_indices,
+                    renormalized_sorted_probs,
+                    axis=1,
+                )
+            )
+        gv = bb.emit_func_output(renormalized_probs)
+    return gv
+
+
 def _attach_take_probs_func(bb: relax.BlockBuilder):
     batch_size = tir.SizeVar("batch_size", "int64")
     num_samples = tir.SizeVar("num_samples", "int64")
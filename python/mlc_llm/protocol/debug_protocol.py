@@ -36,6 +36,11 @@ class DebugConfig(BaseModel):
 
     ignore_eos: bool = False
     pinned_system_prompt: bool = False
+    # The tenant tag of the request, which decides its partition in prefix cache.
+    # A request only matches the prefixes of the same tenant, and the prefixes
+    # explicitly shared across tenants by "share_prefix_across_tenants".
+    prefix_cache_tenant: str = ""
+    share_prefix_across_tenants: bool = False
     special_request: Optional[Literal["query_engine_metrics"]] = None
     grammar_execution_mode: Literal["constraint", "jump_forward"] = "jump_forward"
     disagg_config: Optional[DisaggConfig] = None
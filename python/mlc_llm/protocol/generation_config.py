@@ -18,6 +18,10 @@ class GenerationConfig(BaseModel):  # pylint:
     n: int = 1
     temperature: Optional[float] = None
     top_p: Optional[float] = None
+    # The number of most probable tokens to sample from, 0 for no top-k truncation.
+    top_k: Optional[int] = None
+    # The minimum token probability relative to the maximum one, 0 for no min-p truncation.
+    min_p: Optional[float] = None
     frequency_penalty: Optional[float] = None
     presence_penalty: Optional[float] = None
     repetition_penalty: Optional[float] = None
@@ -29,5 +33,14 @@ class GenerationConfig(BaseModel):  # pylint:
     seed: Optional[int] = None
     stop_strs: Optional[List[str]] = None
     stop_token_ids: Optional[List[int]] = None
+    # Running requests of lower priority are preempted first.
+    priority: int = 0
+    # The deadline in milliseconds after the request is added, -1 for no deadline.
+    deadline_ms: int = -1
+    # The TTFT and TPOT targets in milliseconds of the SLO-aware scheduler, -1 for no target.
+    ttft_slo_ms: int = -1
+    tpot_slo_ms: int = -1
+    # The request class, among which the fair-share waiting queue order admits requests.
+    request_class: str = "default"
     response_format: Optional[RequestResponseFormat] = None
     debug_config: Optional[Optional[DebugConfig]] = None
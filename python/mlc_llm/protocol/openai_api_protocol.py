@@ -116,6 +116,9 @@ class CompletionRequest(BaseModel):
     suffix: Optional[str] = None
     temperature: Optional[float] = None
     top_p: Optional[float] = None
+    # NOTE: top_k and min_p are not part of OpenAI protocol
+    top_k: Optional[int] = None
+    min_p: Optional[float] = None
     user: Optional[str] = None
     response_format: Optional[RequestResponseFormat] = None
     debug_config: Optional[DebugConfig] = None
@@ -227,6 +230,9 @@ class ChatCompletionRequest(BaseModel):
     stream_options: Optional[StreamOptions] = None
     temperature: Optional[float] = None
     top_p: Optional[float] = None
+    # NOTE: top_k and min_p are not part of OpenAI protocol
+    top_k: Optional[int] = None
+    min_p: Optional[float] = None
     tools: Optional[List[ChatTool]] = None
     tool_choice: Optional[Union[Literal["none", "auto"], Dict]] = None
     user: Optional[str] = None
@@ -5,6 +5,6 @@ from .. import base
 from .config import EngineConfig
 from .data import Data, ImageData, RequestStreamOutput, TextData, TokenData
 from .engine import AsyncMLCEngine, MLCEngine
-from .radix_tree import PagedRadixTree
+from .radix_tree import PagedRadixTree, PagedRadixTreeSnapshot
 from .request import Request
 from .server import PopenServer
@@ -2,7 +2,7 @@
 
 import json
 from dataclasses import asdict, dataclass, field
-from typing import List, Literal, Optional, Tuple, Union
+from typing import Dict, List, Literal, Optional, Tuple, Union
 
 
 @dataclass
@@ -124,12 +124,134 @@ class EngineConfig:  # pylint: disable=too-many-instance-attributes
         The maximum number of recycling sequences in prefix cache, default as max_num_sequence.
         And set 0 to disable prefix cache, set -1 to have infinite capacity prefix cache.
 
+    prefix_cache_eviction_policy : Literal["lru", "lfu", "gdsf", "max_freed_pages"]
+        The policy to choose which recycling sequence to evict from prefix cache.
+        "lru" evicts the least recently recycled sequence.
+        "lfu" evicts the least frequently reused or forked sequence.
+        "gdsf" (Greedy-Dual-Size-Frequency) evicts the sequence with the lowest
+        "frequency * re-prefill cost / freed memory", aged by the last eviction.
+        "max_freed_pages" evicts the sequence which frees the most KV cache memory.
+
+    prefix_cache_tenant_max_num_recycling_seqs : int
+        The maximum number of recycling sequences of each tenant in prefix cache.
+        The tenant of a request is tagged by "prefix_cache_tenant" in its debug config.
+        When a tenant reaches the quota, its own recycling sequence is evicted.
+        Set -1 for no quota.
+
+    prefix_cache_tenant_max_recycling_tokens : int
+        The maximum total number of tokens of recycling sequences of each tenant
+        in prefix cache. When memory is freed from prefix cache, the tenants beyond
+        the quota are evicted first. Set -1 for no quota.
+
     prefill_mode : Literal["chunked", "hybrid"]
         The prefill mode.
         "chunked" means the basic prefill with chunked input enabled.
         "hybrid" means the hybrid prefill or split-fuse,
         so that decode step will be converted into prefill.
 
+    prefill_chunk_latency_target_ms : float
+        The target latency in milliseconds of a prefill step. When positive, the
+        prefill chunk size is tuned online from a latency model fitted to the
+        measured prefill step time, between "min_prefill_chunk_size" and
+        "prefill_chunk_size", which bounds the inter-token latency of the requests
+        decoded together under hybrid prefill. -1 means the static "prefill_chunk_size".
+
+    min_prefill_chunk_size : int
+        The minimum prefill chunk size under adaptive prefill chunk sizing.
+
+    scheduler_mode : Literal["greedy", "slo"]
+        The mode of scheduling prefill and decode in each engine step.
+        "greedy" prefills whenever the waiting requests can be prefilled, and
+        decodes otherwise.
+        "slo" chooses between prefill and decode, and caps the prefill chunk size,
+        in each step to maximize the number of requests meeting their
+        "ttft_slo_ms" and "tpot_slo_ms" in generation config, using the measured
+        decode time by batch size and prefill time per token.
+
+    max_decode_steps : int
+        The maximum number of decode steps to run in an engine step without
+        returning to the scheduler, when there is no request to admit. The number
+        decreases with the batch size, so that an engine step decodes at most
+        "prefill_chunk_size" tokens. The requests finishing by stop tokens or
+        max tokens stop decoding in the later steps, and the requests with stop
+        strings decode one step only.
+
+    waiting_queue_order : Literal["fifo", "prefix_aware", "fair_share"]
+        The order of prefilling the requests in waiting queue.
+        "fifo" prefills the requests in the first-come-first-serve order.
+        "prefix_aware" prefills first the requests with the longest prefix in
+        prefix cache, and groups the requests sharing prefixes, so that a prefix
+        is reused by its requests while it is resident in prefix cache.
+        "fair_share" admits the requests of different request classes, tagged by
+        "request_class" in generation config, by deficit round robin, so that each
+        class is prefilled tokens in proportion to its weight.
+
+    waiting_queue_max_wait_ms : int
+        The maximum time in milliseconds a request waits before it is prefilled
+        ahead of the reordered requests, which bounds the starvation under
+        the "prefix_aware" waiting queue order.
+
+    request_class_weights : Dict[str, int]
+        The weight of each request class under the "fair_share" waiting queue order.
+        The classes not listed have weight 1.
+
+    preemption_policy : Literal["last_running", "fewest_pages_lost",
+                                "furthest_from_completion", "deadline"]
+        The policy to choose the running request to preempt when KV cache runs out
+        of memory. Only the running requests of the lowest "priority" in generation
+        config are candidates, and the latest admitted one is preempted on ties.
+        "last_running" preempts the latest admitted request.
+        "fewest_pages_lost" preempts the request holding the fewest KV cache pages,
+        not counting the pages of the prefix shared with other sequences.
+        "furthest_from_completion" preempts the request with the most tokens left
+        to generate before "max_tokens", and the requests without "max_tokens" first.
+        "deadline" preempts the request with the most time left before its
+        "deadline_ms" in generation config, and the requests without deadline first.
+
+    admission_policy : Literal["prompt", "max_tokens", "predicted"]
+        The policy to reserve KV cache pages for the future decode of requests
+        when admitting waiting requests to prefill, which reduces the preemption
+        of running requests as they grow.
+        "prompt" admits a request when its prompt fits, without reservation.
+        "max_tokens" reserves the pages of the tokens left to generate before
+        "max_tokens" of each running and admitted request.
+        "predicted" reserves the pages of the tokens left to generate before the
+        output length predicted from the recent completions of the same prompt
+        template, capped by "max_tokens". Nothing is reserved before any request
+        completes.
+        The first request to run is always admitted. The preemptions and the
+        tokens to prefill again are reported in the "preemption" metrics.
+
+    admission_overcommit_ratio : float
+        The ratio by which the reserved KV cache pages for decode are
+        overcommitted, i.e., the pages reserved are the expected pages divided by
+        the ratio. It is at least 1, which reserves all expected pages.
+
+    overlap_post_process : bool
+        A boolean indicating whether to overlap the post-process of an engine step,
+        i.e., the detokenization, stop checking, prefix cache update and stream
+        callback, with the device execution of the next decode step. A request
+        finishing in the overlapped post-process is decoded for one more token,
+        which is discarded. It is disabled under speculative decoding or
+        disaggregation.
+
+    cpu_sampler_num_threads : int
+        The maximum concurrency of the process-wide TVM threading backend, which
+        the CPU sampler samples tokens and computes top logprobs with in parallel
+        across samples. It applies to all parallel host work of TVM in the
+        process, not only the CPU sampler, and a positive value is used as is
+        without reserving the host threads the models require. 0 means the
+        threads left on the host besides the threads the models require.
+
+    deterministic_sampling : bool
+        A boolean indicating whether to sample deterministically, so that the CPU
+        and GPU samplers sample the same tokens from the same probability
+        distributions and seeds. The random numbers come from counter-based streams
+        per request, indexed by the number of draws before, and the sampling sums up
+        fixed-point probabilities, which is exact in any order. It does not support
+        speculative decoding, and GPU sampling requires the model library to be
+        recompiled.
+
     verbose : bool
         A boolean indicating whether to print logging info in engine.
     """
@@ -156,7 +278,25 @@ class EngineConfig:  # pylint: disable=too-many-instance-attributes
     spec_tree_width: int = 1
     prefix_cache_mode: Literal["disable", "radix"] = "radix"
     prefix_cache_max_num_recycling_seqs: Optional[int] = None
+    prefix_cache_eviction_policy: Literal["lru", "lfu", "gdsf", "max_freed_pages"] = "lru"
+    prefix_cache_tenant_max_num_recycling_seqs: int = -1
+    prefix_cache_tenant_max_recycling_tokens: int = -1
     prefill_mode: Literal["chunked", "hybrid"] = "hybrid"
+    prefill_chunk_latency_target_ms: float = -1
+    min_prefill_chunk_size: int = 128
+    scheduler_mode: Literal["greedy", "slo"] = "greedy"
+    max_decode_steps: int = 1
+    waiting_queue_order: Literal["fifo", "prefix_aware", "fair_share"] = "fifo"
+    waiting_queue_max_wait_ms: int = 2000
+    request_class_weights: Dict[str, int] = field(default_factory=dict)
+    preemption_policy: Literal[
+        "last_running", "fewest_pages_lost", "furthest_from_completion", "deadline"
+    ] = "last_running"
+    admission_policy: Literal["prompt", "max_tokens", "predicted"] = "prompt"
+    admission_overcommit_ratio: float = 1.0
+    overlap_post_process: bool = False
+    cpu_sampler_num_threads: int = 0
+    deterministic_sampling: bool = False
     verbose: bool = True
 
     def asjson(self) -> str:
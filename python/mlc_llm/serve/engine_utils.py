@@ -30,6 +30,8 @@ def openai_api_get_generation_config(request: RequestProtocol) -> Dict[str, Any]
         "n",
         "temperature",
         "top_p",
+        "top_k",
+        "min_p",
         "max_tokens",
         "frequency_penalty",
         "presence_penalty",
@@ -9,6 +9,29 @@ from tvm.runtime import Object, ShapeTuple
 from . import _ffi_api
 
 
+@tvm._ffi.register_object("mlc.serve.PagedRadixTreeSnapshot")  # pylint: disable=protected-access
+class PagedRadixTreeSnapshot(Object):
+    """The immutable snapshot of a paged radix tree, which is safe to match from any thread."""
+
+    def match_length(self, tokens: Union[ShapeTuple, List, Tuple]) -> int:
+        """
+        Get the length of longest common prefix of given tokens and sequences in the snapshot.
+
+        Parameters
+        ----------
+        tokens : Union[ShapeTuple, List, Tuple]
+            The prefix tokens for reference.
+
+        Returns
+        ------
+        matched_offset : int
+            The matched prefix length.
+        """
+        if isinstance(tokens, (list, tuple)):
+            tokens = ShapeTuple(tokens)
+        return _ffi_api.PagedRadixTreeSnapshotMatchPrefixLength(self, tokens)  # type: ignore  # pylint: disable=no-member
+
+
 @tvm._ffi.register_object("mlc.serve.PagedRadixTree")  # pylint: disable=protected-access
 class PagedRadixTree(Object):
     """The paged radix tree to manage prefix and sequence."""
@@ -142,6 +165,23 @@ class PagedRadixTree(Object):
         """
         return _ffi_api.PagedRadixTreeGetSequenceLength(self, seq_id)  # type: ignore  # pylint: disable=no-member
 
+    def get_exclusive_length(self, seq_id: int) -> int:
+        """
+        Get the number of tokens exclusively owned by a sequence, which are not shared with
+        any other sequence. These tokens are released when the sequence is removed.
+
+        Parameters
+        ----------
+        seq_id : int
+            The sequence ID for index.
+
+        Returns
+        ------
+        length : int
+            The number of exclusively owned tokens.
+        """
+        return _ffi_api.PagedRadixTreeGetSequenceExclusiveLength(self, seq_id)  # type: ignore  # pylint: disable=no-member
+
     def free_capacity(self) -> int:
         """
         Get the remaining token capacity of the paged radix tree.
@@ -152,3 +192,44 @@ class PagedRadixTree(Object):
             The remaining token capacity of the paged radix tree.
         """
         return _ffi_api.PagedRadixTreeFreeCapacity(self)  # type: ignore  # pylint: disable=no-member
+
+    def export_binary(self) -> bytes:
+        """
+        Export the structure and token content of the paged radix tree into a compact
+        binary format, where the tokens shared by sequences are stored only once.
+
+        Returns
+        ------
+        data : bytes
+            The exported binary data.
+        """
+        return bytes(_ffi_api.PagedRadixTreeExportBinary(self))  # type: ignore  # pylint: disable=no-member
+
+    def import_binary(self, data: bytes) -> List[int]:
+        """
+        Import the sequences from binary data exported by `export_binary`.
+        The sequences are added with their original sequence IDs.
+
+        Parameters
+        ----------
+        data : bytes
+            The binary data to import.
+
+        Returns
+        ------
+        seq_ids : List[int]
+            The imported sequence IDs.
+        """
+        return list(_ffi_api.PagedRadixTreeImportBinary(self, bytearray(data)))  # type: ignore  # pylint: disable=no-member
+
+    def snapshot(self) -> PagedRadixTreeSnapshot:
+        """
+        Create an immutable snapshot of the paged radix tree, which is unaffected by
+        later modifications of the paged radix tree.
+
+        Returns
+        ------
+        snapshot : PagedRadixTreeSnapshot
+            The created snapshot.
+        """
+        return _ffi_api.PagedRadixTreeCreateSnapshot(self)  # type: ignore  # pylint: disable=no-member
@@ -13,6 +13,7 @@ from typing import Any, Callable, Dict, List, Literal, Optional, Sequence, Tuple
 
 import tvm
 
+from mlc_llm.protocol.debug_protocol import DebugConfig
 from mlc_llm.protocol.generation_config import GenerationConfig
 from mlc_llm.serve import data
 from mlc_llm.serve.config import EngineConfig
@@ -25,6 +26,7 @@ from mlc_llm.serve.engine_base import (
     detect_device,
 )
 from mlc_llm.serve.event_trace_recorder import EventTraceRecorder
+from mlc_llm.serve.radix_tree import PagedRadixTree
 from mlc_llm.serve.request import Request
 from mlc_llm.support import logging
 from mlc_llm.tokenizers import TextStreamer, Tokenizer
@@ -356,3 +358,39 @@ class SyncMLCEngine:
     def metrics(self) -> EngineMetrics:
         """Reset the engine, clean up all running data and metrics."""
         return EngineMetrics(json.loads(self._ffi["json_metrics"]()))
+
+    def export_prefix_cache(self) -> bytes:
+        """Export the token content of the prefix cache in the compact binary
+        format of `PagedRadixTree.export_binary`. The data can be passed to
+        `warm_up_prefix_cache` of an engine after restart."""
+        return bytes(self._ffi["export_prefix_cache"]())
+
+    def warm_up_prefix_cache(
+        self, prompts: Union[bytes, List[List[int]]], pinned: bool = False
+    ) -> None:
+        """Warm up the prefix cache by prefilling the given prompts, so that
+        the later requests sharing prefixes with them hit the prefix cache.
+
+        Parameters
+        ----------
+        prompts : Union[bytes, List[List[int]]]
+            The binary data exported by `export_prefix_cache`, or a list of
+            token id lists to prefill.
+
+        pinned : bool
+            Whether to pin the prompts in the prefix cache, so that they are
+            never evicted. See `DebugConfig.pinned_system_prompt`.
+        """
+        if isinstance(prompts, (bytes, bytearray)):
+            radix_tree = PagedRadixTree()
+            seq_ids = radix_tree.import_binary(prompts)
+            prompts = [list(radix_tree.get(seq_id)) for seq_id in seq_ids]
+        prompts = [prompt for prompt in prompts if len(prompt) > 0]
+        if len(prompts) == 0:
+            return
+        self.generate(
+            prompts,
+            GenerationConfig(
+                max_tokens=1, debug_config=DebugConfig(pinned_system_prompt=pinned)
+            ),
+        )
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "support/random.h"
+
+namespace mlc {
+namespace llm {
+
+void _TestPhilox4x32KnownAnswers() {
+  // The known-answer vectors of Philox4x32-10 from the Random123 library.
+  using Counter = std::array<uint32_t, 4>;
+  ASSERT_EQ(Philox4x32({0, 0, 0, 0}, {0, 0}),
+            (Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  ASSERT_EQ(Philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+            (Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  ASSERT_EQ(Philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                       {0xa4093822, 0x299f31d0}),
+            (Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+void _TestCounterBasedRandomGenerator() {
+  RandomGenerator rng(/*seed=*/42, /*counter_based=*/true);
+  for (uint64_t i = 0; i < 16; ++i) {
+    double number = rng.GetRandomNumber();
+    ASSERT_EQ(number, RandomGenerator::GetCounterBasedRandomNumber(42, i));
+    ASSERT_GE(number, 0.0);
+    ASSERT_LT(number, 1.0);
+    // The numbers are multiples of 2^-24, which are exact in float32.
+    ASSERT_EQ(number, static_cast<double>(static_cast<float>(number)));
+    ASSERT_EQ(std::ldexp(number, 24), std::floor(std::ldexp(number, 24)));
+  }
+  // Setting the seed restarts the stream from the first draw.
+  rng.SetSeed(42);
+  ASSERT_EQ(rng.GetRandomNumber(), RandomGenerator::GetCounterBasedRandomNumber(42, 0));
+}
+
+TEST(RandomTest, Philox4x32KnownAnswersTest) { _TestPhilox4x32KnownAnswers(); }
+TEST(RandomTest, CounterBasedRandomGeneratorTest) { _TestCounterBasedRandomGenerator(); }
+
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "serve/sampler/cpu_sampler_kernels.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+std::vector<const CPUSamplerKernels*> _GetSupportedKernels() {
+  std::vector<const CPUSamplerKernels*> kernels;
+  for (CPUSamplerISA isa : {CPUSamplerISA::kScalar, CPUSamplerISA::kAVX2, CPUSamplerISA::kAVX512,
+                            CPUSamplerISA::kNEON}) {
+    if (CPUSamplerISASupported(isa)) {
+      kernels.push_back(&GetCPUSamplerKernels(isa));
+    }
+  }
+  return kernels;
+}
+
+/*!
+ * \brief Create a probability distribution of the given shape over the vocabulary.
+ * "peaked" puts 0.9 on one token, "flat" is uniform, and "zipf" follows Zipf's law over shuffled
+ * tokens, which is close to the distribution of a language model at a moderate temperature.
+ */
+std::vector<float> _CreateProb(int64_t vocab_size, const std::string& shape, std::mt19937* rng) {
+  std::vector<float> prob(vocab_size);
+  if (shape == "peaked") {
+    std::fill(prob.begin(), prob.end(), 0.1f / (vocab_size - 1));
+    prob[(*rng)() % vocab_size] = 0.9f;
+  } else if (shape == "flat") {
+    std::fill(prob.begin(), prob.end(), 1.0f / vocab_size);
+  } else {
+    double sum = 0.0;
+    for (int64_t i = 0; i < vocab_size; ++i) {
+      prob[i] = 1.0f / std::pow(static_cast<float>(i + 1), 1.1f);
+      sum += prob[i];
+    }
+    for (float& p : prob) {
+      p /= sum;
+    }
+    std::shuffle(prob.begin(), prob.end(), *rng);
+  }
+  return prob;
+}
+
+void _TestCPUSamplerKernels() {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const CPUSamplerKernels& scalar = GetCPUSamplerKernels(CPUSamplerISA::kScalar);
+  for (const CPUSamplerKernels* kernels : _GetSupportedKernels()) {
+    // Odd sizes exercise the scalar tails of the vectorized kernels.
+    for (int64_t vocab_size : {1, 7, 33, 1000, 32003}) {
+      for (const std::string& shape : {"peaked", "flat", "zipf"}) {
+        std::vector<float> prob = _CreateProb(vocab_size, shape, &rng);
+        const float* p = prob.data();
+        ASSERT_EQ(kernels->argmax(p, vocab_size), scalar.argmax(p, vocab_size));
+
+        std::vector<double> prefix_sum(vocab_size);
+        for (int64_t i = 0; i < vocab_size; ++i) {
+          prefix_sum[i] = (i == 0 ? 0.0 : prefix_sum[i - 1]) + p[i];
+        }
+        for (int trial = 0; trial < 16; ++trial) {
+          double u = uniform(rng) * prefix_sum.back();
+          int64_t pos = kernels->sample_prefix_sum(p, vocab_size, u);
+          // The block sums may round differently from the sequential prefix sum.
+          ASSERT_GE(pos, 0);
+          ASSERT_GE(prefix_sum[pos], u - 1e-5);
+          ASSERT_TRUE(pos == 0 || prefix_sum[pos - 1] < u + 1e-5);
+        }
+
+        float cutoff = 1.0f / vocab_size + 1e-7f;
+        for (int64_t begin = 0; begin < vocab_size; begin += std::max<int64_t>(vocab_size / 8, 1)) {
+          ASSERT_EQ(kernels->find_next_at_least(p, begin, vocab_size, cutoff),
+                    scalar.find_next_at_least(p, begin, vocab_size, cutoff));
+        }
+
+        std::vector<float> draft_prob = _CreateProb(vocab_size, shape, &rng);
+        std::vector<float> residual = prob;
+        std::vector<float> scalar_residual = prob;
+        double residual_sum = kernels->residual(residual.data(), draft_prob.data(), vocab_size);
+        double scalar_residual_sum =
+            scalar.residual(scalar_residual.data(), draft_prob.data(), vocab_size);
+        ASSERT_EQ(residual, scalar_residual);
+        ASSERT_NEAR(residual_sum, scalar_residual_sum, 1e-5);
+      }
+    }
+    // Ties go to the first position, and all-zero distributions have no argmax.
+    std::vector<float> ties(100, 0.0f);
+    ASSERT_EQ(kernels->argmax(ties.data(), ties.size()), -1);
+    ASSERT_EQ(kernels->sample_prefix_sum(ties.data(), ties.size(), 0.5), -1);
+    ties[37] = ties[90] = ties[45] = 0.25f;
+    ASSERT_EQ(kernels->argmax(ties.data(), ties.size()), 37);
+    ASSERT_EQ(kernels->find_next_at_least(ties.data(), 38, ties.size(), 0.25f), 45);
+    ASSERT_EQ(kernels->find_next_at_least(ties.data(), 91, ties.size(), 0.25f), 100);
+  }
+}
+
+/*!
+ * \brief Compare the time of the kernels of every supported instruction set across vocabulary
+ * sizes and distribution shapes.
+ */
+void _BenchmarkCPUSamplerKernels() {
+  constexpr int kNumRepeats = 200;
+  std::mt19937 rng(0);
+  std::cout << "isa     vocab-size   shape   argmax (us)  prefix-sum (us)  top-p filter (us)"
+            << "  residual (us)" << std::endl;
+  for (int64_t vocab_size : {32000, 128256, 256000}) {
+    for (const std::string& shape : {"peaked", "flat", "zipf"}) {
+      std::vector<float> prob = _CreateProb(vocab_size, shape, &rng);
+      std::vector<float> draft_prob = _CreateProb(vocab_size, shape, &rng);
+      std::vector<float> residual(vocab_size);
+      const float* p = prob.data();
+      // The first cutoff of top-p 0.9 sampling.
+      float cutoff = 0.9f / 1024;
+      for (const CPUSamplerKernels* kernels : _GetSupportedKernels()) {
+        int64_t checksum = 0;
+        auto tstart = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < kNumRepeats; ++r) {
+          checksum += kernels->argmax(p, vocab_size);
+        }
+        auto tend = std::chrono::high_resolution_clock::now();
+        double argmax_us = static_cast<double>((tend - tstart).count()) / 1e3 / kNumRepeats;
+
+        tstart = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < kNumRepeats; ++r) {
+          checksum += kernels->sample_prefix_sum(p, vocab_size, 0.999);
+        }
+        tend = std::chrono::high_resolution_clock::now();
+        double prefix_sum_us = static_cast<double>((tend - tstart).count()) / 1e3 / kNumRepeats;
+
+        tstart = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < kNumRepeats; ++r) {
+          for (int64_t i = kernels->find_next_at_least(p, 0, vocab_size, cutoff); i < vocab_size;
+               i = kernels->find_next_at_least(p, i + 1, vocab_size, cutoff)) {
+            checksum += i;
+          }
+        }
+        tend = std::chrono::high_resolution_clock::now();
+        double filter_us = static_cast<double>((tend - tstart).count()) / 1e3 / kNumRepeats;
+
+        double residual_us = 0.0;
+        for (int r = 0; r < kNumRepeats; ++r) {
+          residual = prob;
+          tstart = std::chrono::high_resolution_clock::now();
+          checksum += kernels->residual(residual.data(), draft_prob.data(), vocab_size) > 0.5;
+          tend = std::chrono::high_resolution_clock::now();
+          residual_us += static_cast<double>((tend - tstart).count()) / 1e3 / kNumRepeats;
+        }
+
+        ASSERT_NE(checksum, -1);
+        std::cout << std::left << std::setw(7) << CPUSamplerISAToString(kernels->isa) << std::right
+                  << " " << std::setw(10) << vocab_size << " " << std::setw(7) << shape << " "
+                  << std::setw(13) << argmax_us << " " << std::setw(16) << prefix_sum_us << " "
+                  << std::setw(18) << filter_us << " " << std::setw(14) << residual_us
+                  << std::endl;
+      }
+    }
+  }
+}
+
+TEST(ServeCPUSamplerKernelsTest, KernelsMatchScalarTest) { _TestCPUSamplerKernels(); }
+// The benchmark runs only with "--gtest_also_run_disabled_tests".
+TEST(ServeCPUSamplerKernelsTest, DISABLED_KernelsBenchmark) { _BenchmarkCPUSamplerKernels(); }
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
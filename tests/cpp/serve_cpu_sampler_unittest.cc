@@ -0,0 +1,288 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "serve/sampler/cpu_sampler.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*!
+ * \brief Create a batch of two probability distributions over the vocabulary, where the second
+ * one is of the given shape. "random" draws independent values, "tied" rounds the random values
+ * to a few levels so that many tokens tie, "flat" ties all tokens, and "zipf" follows Zipf's law
+ * over shuffled tokens.
+ */
+NDArray _CreateProbBatch(int64_t vocab_size, const std::string& shape, std::mt19937* rng) {
+  NDArray prob = NDArray::Empty({2, vocab_size}, DataType::Float(32), DLDevice{kDLCPU, 0});
+  float* p_prob = static_cast<float*>(prob->data);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  for (int64_t i = 0; i < 2 * vocab_size; ++i) {
+    p_prob[i] = uniform(*rng);
+  }
+  float* p_row = p_prob + vocab_size;
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    if (shape == "tied") {
+      p_row[i] = std::floor(p_row[i] * 8.0f) / 8.0f;
+    } else if (shape == "flat") {
+      p_row[i] = 1.0f;
+    } else if (shape == "zipf") {
+      p_row[i] = 1.0f / std::pow(static_cast<float>(i + 1), 1.1f);
+    }
+  }
+  if (shape == "zipf") {
+    std::shuffle(p_row, p_row + vocab_size, *rng);
+  }
+  for (float* p = p_prob; p < p_prob + 2 * vocab_size; p += vocab_size) {
+    float sum = std::accumulate(p, p + vocab_size, 0.0f);
+    std::transform(p, p + vocab_size, p, [sum](float x) { return x / sum; });
+  }
+  return prob;
+}
+
+/*! \brief The top probs by sorting the whole distribution, with ties in token index order. */
+std::vector<TokenProbPair> _SortTopProbs(const float* p_prob, int64_t vocab_size, int k) {
+  std::vector<TokenProbPair> sorted;
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    sorted.emplace_back(i, p_prob[i]);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const TokenProbPair& lhs, const TokenProbPair& rhs) {
+                     return lhs.second > rhs.second;
+                   });
+  sorted.resize(std::min<int64_t>(k, vocab_size));
+  return sorted;
+}
+
+void _TestComputeTopProbs() {
+  std::mt19937 rng(0);
+  // The odd vocabulary size exercises the scalar tails of the vectorized kernels.
+  for (int64_t vocab_size : {3, 20, 1001}) {
+    for (std::string shape : {"random", "tied", "flat"}) {
+      NDArray prob = _CreateProbBatch(vocab_size, shape, &rng);
+      for (int unit_offset : {0, 1}) {
+        const float* p_prob = static_cast<const float*>(prob->data) + unit_offset * vocab_size;
+        for (int k : {0, 1, 5, 20}) {
+          std::vector<TokenProbPair> expected = _SortTopProbs(p_prob, vocab_size, k);
+          std::vector<TokenProbPair> top_probs = ComputeTopProbs(prob, unit_offset, k);
+          ASSERT_EQ(top_probs, expected) << "vocab_size=" << vocab_size << ", shape=" << shape
+                                         << ", unit_offset=" << unit_offset << ", k=" << k;
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Sample deterministically by sorting all the quantized probabilities, straight from the
+ * definition of deterministic_sampling.h.
+ */
+TokenProbPair _SortSampleDeterministic(const float* p_prob, int64_t vocab_size,
+                                       const DeterministicSamplingParams& params,
+                                       double uniform_sample) {
+  std::vector<int64_t> quantized_prob(vocab_size);
+  std::transform(p_prob, p_prob + vocab_size, quantized_prob.begin(), QuantizeDeterministicProb);
+  std::vector<int64_t> sorted_prob = quantized_prob;
+  std::sort(sorted_prob.begin(), sorted_prob.end(), std::greater<int64_t>());
+  int64_t prob_sum = std::accumulate(sorted_prob.begin(), sorted_prob.end(), int64_t{0});
+
+  int64_t top_p_cutoff = 0;
+  if (params.top_p < kDeterministicFractionOne) {
+    int64_t top_p_target = DeterministicTopPTarget(params.top_p, prob_sum);
+    int64_t cum_sum = 0;
+    for (int64_t q : sorted_prob) {
+      cum_sum += q;
+      if (cum_sum >= top_p_target) {
+        top_p_cutoff = q;
+        break;
+      }
+    }
+  }
+  int64_t top_k_cutoff = params.top_k < vocab_size ? sorted_prob[params.top_k - 1] : 0;
+  int64_t min_p_cutoff = DeterministicMinPCutoff(params.min_p, sorted_prob[0]);
+  int64_t cutoff = std::max({top_p_cutoff, top_k_cutoff, min_p_cutoff});
+
+  int64_t kept_prob_sum = 0;
+  for (int64_t q : quantized_prob) {
+    kept_prob_sum += q >= cutoff ? q : 0;
+  }
+  int64_t target = DeterministicSampleTarget(uniform_sample, kept_prob_sum);
+  int64_t cum_sum = 0;
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    cum_sum += quantized_prob[i] >= cutoff ? quantized_prob[i] : 0;
+    if (cum_sum > target) {
+      return {i, p_prob[i]};
+    }
+  }
+  return {-1, 0.0f};
+}
+
+void _TestSampleDeterministicFromProb() {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int32_t> uniform_fraction(0, kDeterministicFractionOne - 1);
+  // The vocabulary of 4096 tokens has most probabilities below 2^-10, which the sampler sorts
+  // only when the larger ones do not reach the top-p or top-k cutoff.
+  for (int64_t vocab_size : {20, 4096}) {
+    for (std::string shape : {"random", "tied", "flat", "zipf"}) {
+      NDArray prob = _CreateProbBatch(vocab_size, shape, &rng);
+      const float* p_prob = static_cast<const float*>(prob->data) + vocab_size;
+      for (double top_p : {0.0, 0.3, 0.9, 1.0}) {
+        for (int32_t top_k : {1, 5, 20, 1000}) {
+          for (double min_p : {0.0, 0.5}) {
+            DeterministicSamplingParams params{
+                QuantizeDeterministicFraction(top_p),
+                static_cast<int32_t>(std::min<int64_t>(top_k, vocab_size)),
+                QuantizeDeterministicFraction(min_p)};
+            for (int i = 0; i < 8; ++i) {
+              // The counter-based random numbers are multiples of 2^-24.
+              double uniform_sample =
+                  std::ldexp(uniform_fraction(rng), -kDeterministicFractionBits);
+              ASSERT_EQ(SampleDeterministicFromProb(prob, 1, params, uniform_sample),
+                        _SortSampleDeterministic(p_prob, vocab_size, params, uniform_sample))
+                  << "vocab_size=" << vocab_size << ", shape=" << shape << ", top_p=" << top_p
+                  << ", top_k=" << top_k << ", min_p=" << min_p
+                  << ", uniform_sample=" << uniform_sample;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Round the probabilities to multiples of 2^-20, so that their sums are exact in float in
+ * any order, and the kept tokens do not depend on the summation order.
+ */
+void _QuantizeProb(float* p_prob, int64_t vocab_size) {
+  std::transform(p_prob, p_prob + vocab_size, p_prob,
+                 [](float x) { return std::ldexp(std::round(std::ldexp(x, 20)), -20); });
+}
+
+/*!
+ * \brief Create a distribution of 4096 tokens, where 64 tokens of distinct probabilities fall in
+ * the radix bucket of [2^-10, 2^-10 + 2^-14), one token holds most of the probability, and the
+ * others share the rest evenly. The tokens are shuffled.
+ * \return The distribution and the probabilities of the leading token and the median token of
+ * the bucket.
+ */
+std::tuple<NDArray, float, float> _CreateBucketProb(std::mt19937* rng) {
+  constexpr int64_t kVocabSize = 4096;
+  constexpr int kBucketSize = 64;
+  NDArray prob = NDArray::Empty({1, kVocabSize}, DataType::Float(32), DLDevice{kDLCPU, 0});
+  float* p_prob = static_cast<float*>(prob->data);
+  for (int i = 0; i < kBucketSize; ++i) {
+    p_prob[i] = std::ldexp(1024.0f + i, -20);
+  }
+  std::fill(p_prob + kBucketSize + 1, p_prob + kVocabSize, std::ldexp(1.0f, -14));
+  p_prob[kBucketSize] = 0.0f;
+  p_prob[kBucketSize] = 1.0f - std::accumulate(p_prob, p_prob + kVocabSize, 0.0f);
+  float max_prob = p_prob[kBucketSize];
+  float median_prob = p_prob[kBucketSize / 2];
+  std::shuffle(p_prob, p_prob + kVocabSize, *rng);
+  return {prob, max_prob, median_prob};
+}
+
+/*!
+ * \brief Renormalize by sorting the whole distribution, with ties in token index order, and
+ * keeping the shortest prefix that meets any of top-k, top-p and min-p.
+ */
+std::vector<float> _SortRenormalize(const float* p_prob, int64_t vocab_size, int top_k,
+                                    double top_p, double min_p, double eps) {
+  std::vector<float> renormalized(p_prob, p_prob + vocab_size);
+  if (top_p == 1.0 && (top_k == 0 || top_k >= vocab_size) && min_p == 0.0) {
+    return renormalized;
+  }
+  std::vector<int64_t> sorted_indices(vocab_size);
+  std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+  std::stable_sort(sorted_indices.begin(), sorted_indices.end(),
+                   [p_prob](int64_t lhs, int64_t rhs) { return p_prob[lhs] > p_prob[rhs]; });
+  float min_p_cutoff = static_cast<float>(min_p * p_prob[sorted_indices[0]]);
+  int64_t num_kept = 0;
+  double kept_sum = 0.0;
+  for (int64_t i : sorted_indices) {
+    if (num_kept > 0 && ((top_k > 0 && num_kept >= top_k) || p_prob[i] < min_p_cutoff ||
+                         kept_sum >= top_p - eps)) {
+      break;
+    }
+    kept_sum += p_prob[i];
+    ++num_kept;
+  }
+  if (num_kept == vocab_size) {
+    return renormalized;
+  }
+  std::fill(renormalized.begin(), renormalized.end(), 0.0f);
+  for (int64_t j = 0; j < num_kept; ++j) {
+    renormalized[sorted_indices[j]] = p_prob[sorted_indices[j]] / kept_sum;
+  }
+  return renormalized;
+}
+
+/*! \brief Check the renormalization of the distribution at the given offset against sorting. */
+void _CheckRenormalize(NDArray prob, int unit_offset, int top_k, double top_p, double min_p,
+                       const std::string& label) {
+  constexpr double kEps = 1e-5;
+  int64_t vocab_size = prob->shape[1];
+  float* p_prob = static_cast<float*>(prob->data) + unit_offset * vocab_size;
+  std::vector<float> original(p_prob, p_prob + vocab_size);
+  std::vector<float> expected =
+      _SortRenormalize(original.data(), vocab_size, top_k, top_p, min_p, kEps);
+  RenormalizeProbByTopKTopPMinP(prob, unit_offset, top_k, top_p, min_p, kEps);
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    ASSERT_EQ(p_prob[i] == 0.0f, expected[i] == 0.0f)
+        << label << ", top_k=" << top_k << ", top_p=" << top_p << ", min_p=" << min_p
+        << ", token=" << i;
+    ASSERT_FLOAT_EQ(p_prob[i], expected[i])
+        << label << ", top_k=" << top_k << ", top_p=" << top_p << ", min_p=" << min_p
+        << ", token=" << i;
+  }
+  std::copy(original.begin(), original.end(), p_prob);
+}
+
+void _TestRenormalizeProbByTopKTopPMinP() {
+  std::mt19937 rng(0);
+  for (int64_t vocab_size : {20, 4096}) {
+    for (std::string shape : {"random", "tied", "flat", "zipf"}) {
+      NDArray prob = _CreateProbBatch(vocab_size, shape, &rng);
+      _QuantizeProb(static_cast<float*>(prob->data) + vocab_size, vocab_size);
+      std::string label = "vocab_size=" + std::to_string(vocab_size) + ", shape=" + shape;
+      for (int top_k : {0, 1, 5, 20, 1000}) {
+        for (double top_p : {0.1, 0.3, 0.5, 0.9, 1.0}) {
+          for (double min_p : {0.0, 0.05, 0.5}) {
+            _CheckRenormalize(prob, 1, top_k, top_p, min_p, label);
+          }
+        }
+      }
+    }
+  }
+
+  // The boundaries of top-k, top-p and min-p fall inside the radix bucket of 64 tokens.
+  auto [prob, max_prob, median_prob] = _CreateBucketProb(&rng);
+  double median_min_p = static_cast<double>(median_prob) / max_prob;
+  double median_top_p = max_prob + 32 * std::ldexp(1024.0, -20);
+  for (int top_k : {0, 2, 10, 33, 64, 65, 66}) {
+    for (double top_p : {median_top_p - 1e-4, median_top_p, median_top_p + 1e-4, 1.0}) {
+      for (double min_p : {0.0, median_min_p, std::ldexp(1030.0, -20) / max_prob}) {
+        _CheckRenormalize(prob, 0, top_k, top_p, min_p, "bucket");
+      }
+    }
+  }
+}
+
+TEST(ServeCPUSamplerTest, ComputeTopProbsTest) { _TestComputeTopProbs(); }
+TEST(ServeCPUSamplerTest, SampleDeterministicFromProbTest) { _TestSampleDeterministicFromProb(); }
+TEST(ServeCPUSamplerTest, RenormalizeProbByTopKTopPMinPTest) {
+  _TestRenormalizeProbByTopKTopPMinP();
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <numeric>
+
+#include "serve/preemption_victim_selector.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+constexpr int kPageSize = 16;
+
+/*! \brief The running requests, whose states are kept alive for the back references. */
+struct RunningQueue {
+  std::vector<Request> requests;
+  std::vector<RequestState> rstates;
+
+  /*!
+   * \brief Admit a running request with one alive request state entry.
+   * \param num_kv_tokens The number of tokens in KV cache.
+   * \return The request state entry.
+   */
+  RequestStateEntry Admit(int64_t internal_id, int64_t num_kv_tokens, int priority = 0,
+                          int max_tokens = -1, int64_t deadline_ms = -1,
+                          int num_committed_tokens = 1) {
+    ObjectPtr<GenerationConfigNode> n = make_object<GenerationConfigNode>();
+    n->priority = priority;
+    n->max_tokens = max_tokens;
+    n->deadline_ms = deadline_ms;
+    Request request(std::to_string(requests.size()), {TokenData(std::vector<int32_t>{0})},
+                    GenerationConfig(n));
+    RequestStateEntry rsentry(request, /*num_models=*/1, internal_id, /*rng_seed=*/0,
+                              /*counter_based_rng=*/false, /*token_table=*/{}, std::nullopt);
+    rsentry->status = RequestStateStatus::kAlive;
+    // The last committed token is not in KV cache yet.
+    rsentry->mstates[0]->num_prefilled_tokens = num_kv_tokens - num_committed_tokens + 1;
+    for (int i = 0; i < num_committed_tokens; ++i) {
+      rsentry->mstates[0]->committed_tokens.push_back(SampleResult{{0, 1.0f}, {}});
+    }
+    RequestState rstate({rsentry}, /*num_response=*/1, std::chrono::high_resolution_clock::now());
+    rsentry->rstate = rstate.operator->();
+    request->rstate = rstate.operator->();
+    requests.push_back(request);
+    rstates.push_back(rstate);
+    return rsentry;
+  }
+};
+
+int _SelectVictim(PreemptionPolicy policy, const RunningQueue& queue,
+                  PrefixCache prefix_cache = PrefixCache::CreateNoPrefixCache()) {
+  return PreemptionVictimSelector::Create(policy, kPageSize, std::move(prefix_cache))
+      ->SelectVictim(queue.requests);
+}
+
+void _TestLastRunning() {
+  RunningQueue queue;
+  queue.Admit(0, 100);
+  queue.Admit(1, 10);
+  RequestStateEntry last = queue.Admit(2, 50);
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kLastRunning, queue), 2);
+  // The requests without alive entry are skipped.
+  last->status = RequestStateStatus::kPending;
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kLastRunning, queue), 1);
+}
+
+void _TestFewestPagesLost() {
+  RunningQueue queue;
+  queue.Admit(0, 48);
+  queue.Admit(1, 17);
+  queue.Admit(2, 40);
+  // 3, 2 and 3 pages.
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFewestPagesLost, queue), 1);
+  // The last committed token is not in KV cache: 32 tokens are 2 pages on ties with request 1,
+  // which is preempted as the latest admitted.
+  queue.Admit(3, 32, /*priority=*/0, /*max_tokens=*/-1, /*deadline_ms=*/-1,
+              /*num_committed_tokens=*/5);
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFewestPagesLost, queue), 3);
+}
+
+void _TestFewestPagesLostSharedPrefix() {
+  PrefixCache prefix_cache = PrefixCache::CreateRadixPrefixCache(/*max_recycling_seqs=*/8);
+  std::vector<int32_t> tokens(48);
+  std::iota(tokens.begin(), tokens.end(), 0);
+  prefix_cache->InsertSequence(0, {tokens[0]}, -1, 0, "", false);
+  prefix_cache->ExtendSequence(0, tokens);
+  // Sequence 2 forks the first 2 pages of sequence 0.
+  std::vector<int32_t> forked_tokens(tokens.begin(), tokens.begin() + 32);
+  forked_tokens.push_back(1000);
+  forked_tokens.push_back(1001);
+  ASSERT_EQ(prefix_cache->InsertSequence(2, forked_tokens, -1, 0, "", false).prefilled_offset, 32);
+  ASSERT_EQ(prefix_cache->GetSequenceSharedLength(0), 32);
+  ASSERT_EQ(prefix_cache->GetSequenceSharedLength(1), 0);
+
+  RunningQueue queue;
+  queue.Admit(0, 48);
+  queue.Admit(1, 20);
+  // Without prefix cache, request 0 loses 3 pages and request 1 loses 2 pages.
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFewestPagesLost, queue), 1);
+  // The 2 shared pages of request 0 stay in KV cache, so it loses only 1 page.
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFewestPagesLost, queue, prefix_cache), 0);
+}
+
+void _TestFurthestFromCompletion() {
+  RunningQueue queue;
+  queue.Admit(0, 100, /*priority=*/0, /*max_tokens=*/100, /*deadline_ms=*/-1,
+              /*num_committed_tokens=*/10);
+  queue.Admit(1, 100, /*priority=*/0, /*max_tokens=*/50, /*deadline_ms=*/-1,
+              /*num_committed_tokens=*/1);
+  // 90 and 49 tokens left.
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFurthestFromCompletion, queue), 0);
+  // The requests without "max_tokens" are preempted first.
+  queue.Admit(2, 10);
+  queue.Admit(3, 10, /*priority=*/0, /*max_tokens=*/1000);
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kFurthestFromCompletion, queue), 2);
+}
+
+void _TestDeadline() {
+  RunningQueue queue;
+  queue.Admit(0, 10, /*priority=*/0, /*max_tokens=*/-1, /*deadline_ms=*/100000);
+  queue.Admit(1, 10, /*priority=*/0, /*max_tokens=*/-1, /*deadline_ms=*/1000);
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kDeadline, queue), 0);
+  // The requests without deadline are preempted first, the latest admitted one on ties.
+  queue.Admit(2, 10);
+  queue.Admit(3, 10);
+  queue.Admit(4, 10, /*priority=*/0, /*max_tokens=*/-1, /*deadline_ms=*/1000000);
+  ASSERT_EQ(_SelectVictim(PreemptionPolicy::kDeadline, queue), 3);
+}
+
+void _TestPriority() {
+  for (PreemptionPolicy policy :
+       {PreemptionPolicy::kLastRunning, PreemptionPolicy::kFewestPagesLost,
+        PreemptionPolicy::kFurthestFromCompletion, PreemptionPolicy::kDeadline}) {
+    RunningQueue queue;
+    // Request 1 is the cheapest to preempt under every policy, but of higher priority.
+    queue.Admit(0, 100, /*priority=*/-1, /*max_tokens=*/200, /*deadline_ms=*/1000);
+    queue.Admit(1, 10, /*priority=*/0);
+    queue.Admit(2, 100, /*priority=*/-1, /*max_tokens=*/200, /*deadline_ms=*/1000);
+    queue.Admit(3, 100, /*priority=*/1, /*max_tokens=*/200, /*deadline_ms=*/1000);
+    // Only the requests of the lowest priority are candidates, and the latest admitted one is
+    // preempted on ties.
+    ASSERT_EQ(_SelectVictim(policy, queue), 2);
+  }
+}
+
+TEST(ServePreemptionVictimSelectorTest, LastRunningTest) { _TestLastRunning(); }
+TEST(ServePreemptionVictimSelectorTest, FewestPagesLostTest) { _TestFewestPagesLost(); }
+TEST(ServePreemptionVictimSelectorTest, FewestPagesLostSharedPrefixTest) {
+  _TestFewestPagesLostSharedPrefix();
+}
+TEST(ServePreemptionVictimSelectorTest, FurthestFromCompletionTest) {
+  _TestFurthestFromCompletion();
+}
+TEST(ServePreemptionVictimSelectorTest, DeadlineTest) { _TestDeadline(); }
+TEST(ServePreemptionVictimSelectorTest, PriorityTest) { _TestPriority(); }
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
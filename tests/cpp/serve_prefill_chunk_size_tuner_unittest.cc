@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "serve/prefill_chunk_size_tuner.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+constexpr double kIntercept = 0.01;
+constexpr double kPerToken = 1e-4;
+
+/*! \brief Update the tuner with prefill steps of the linear step time. */
+void _UpdateLinearSteps(PrefillChunkSizeTuner* tuner) {
+  for (int i = 0; i < 4; ++i) {
+    for (int64_t num_tokens : {128, 256, 512, 1024}) {
+      tuner->Update(num_tokens, kIntercept + kPerToken * num_tokens);
+    }
+  }
+}
+
+void _TestFit() {
+  PrefillChunkMetrics metrics;
+  // 404 tokens fit the target, aligned down to 400.
+  PrefillChunkSizeTuner tuner(/*latency_target=*/0.0504, /*min_prefill_chunk_size=*/128,
+                              /*max_prefill_chunk_size=*/2048, /*kv_cache_page_size=*/16,
+                              &metrics);
+  ASSERT_EQ(tuner.GetPrefillChunkSize(0), 2048);
+  _UpdateLinearSteps(&tuner);
+  ASSERT_NEAR(metrics.step_time_intercept, kIntercept, 1e-9);
+  ASSERT_NEAR(metrics.step_time_per_token, kPerToken, 1e-12);
+  ASSERT_EQ(metrics.num_updates, 16);
+  ASSERT_EQ(tuner.GetPrefillChunkSize(0), 400);
+  ASSERT_EQ(metrics.prefill_chunk_size, 400);
+  tuner.Reset();
+  ASSERT_EQ(tuner.GetPrefillChunkSize(0), 2048);
+  ASSERT_EQ(metrics.num_updates, 0);
+}
+
+void _TestNoFitWithoutSpread() {
+  PrefillChunkMetrics metrics;
+  PrefillChunkSizeTuner tuner(/*latency_target=*/0.02, /*min_prefill_chunk_size=*/128,
+                              /*max_prefill_chunk_size=*/2048, /*kv_cache_page_size=*/16,
+                              &metrics);
+  // Steps of the same number of tokens do not tell the slope apart.
+  for (int i = 0; i < 8; ++i) {
+    tuner.Update(512, 0.1);
+  }
+  // The steps without tokens are skipped.
+  tuner.Update(0, 1.0);
+  ASSERT_EQ(metrics.num_updates, 8);
+  ASSERT_EQ(tuner.GetPrefillChunkSize(0), 2048);
+}
+
+void _TestClamp() {
+  PrefillChunkMetrics metrics;
+  // The target fits only 10 tokens, below the minimum.
+  PrefillChunkSizeTuner min_tuner(/*latency_target=*/0.011, /*min_prefill_chunk_size=*/128,
+                                  /*max_prefill_chunk_size=*/2048, /*kv_cache_page_size=*/16,
+                                  &metrics);
+  _UpdateLinearSteps(&min_tuner);
+  ASSERT_EQ(min_tuner.GetPrefillChunkSize(0), 128);
+  // The target fits more tokens than the maximum.
+  PrefillChunkSizeTuner max_tuner(/*latency_target=*/1.0, /*min_prefill_chunk_size=*/128,
+                                  /*max_prefill_chunk_size=*/2048, /*kv_cache_page_size=*/16,
+                                  &metrics);
+  _UpdateLinearSteps(&max_tuner);
+  ASSERT_EQ(max_tuner.GetPrefillChunkSize(0), 2048);
+}
+
+void _TestRunningBatchFloor() {
+  PrefillChunkMetrics metrics;
+  PrefillChunkSizeTuner tuner(/*latency_target=*/0.011, /*min_prefill_chunk_size=*/16,
+                              /*max_prefill_chunk_size=*/2048, /*kv_cache_page_size=*/16,
+                              &metrics);
+  _UpdateLinearSteps(&tuner);
+  ASSERT_EQ(tuner.GetPrefillChunkSize(0), 16);
+  // The decode inputs of the running requests leave a page for prefill.
+  ASSERT_EQ(tuner.GetPrefillChunkSize(100), 116);
+  ASSERT_EQ(tuner.GetPrefillChunkSize(4000), 2048);
+}
+
+TEST(ServePrefillChunkSizeTunerTest, FitTest) { _TestFit(); }
+TEST(ServePrefillChunkSizeTunerTest, NoFitWithoutSpreadTest) { _TestNoFitWithoutSpread(); }
+TEST(ServePrefillChunkSizeTunerTest, ClampTest) { _TestClamp(); }
+TEST(ServePrefillChunkSizeTunerTest, RunningBatchFloorTest) { _TestRunningBatchFloor(); }
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
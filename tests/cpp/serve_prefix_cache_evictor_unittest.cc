@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+#include "serve/prefix_cache_evictor.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+/*! \brief Return the tokens "begin, begin + 1, ..., begin + length - 1". */
+std::vector<int32_t> _Tokens(int32_t begin, size_t length) {
+  std::vector<int32_t> tokens(length);
+  std::iota(tokens.begin(), tokens.end(), begin);
+  return tokens;
+}
+
+void _TestGDSFEvictsBySizeOnEqualFrequency() {
+  PagedRadixTree radix_tree = PagedRadixTree::Create();
+  std::unique_ptr<PrefixCacheEvictor> evictor =
+      PrefixCacheEvictor::Create(PrefixCacheEvictionPolicy::kGDSF, radix_tree);
+  // A running sequence holds the shared prefix of 60 tokens, and is never a candidate.
+  radix_tree->AddSequence(0);
+  radix_tree->ExtendSequence(0, _Tokens(0, 60));
+  // Three recycling sequences, never hit, with 10, 20 and 40 exclusive tokens after the prefix.
+  // Their priorities are 70 / 10, 80 / 20 and 100 / 40.
+  std::vector<std::pair<int64_t, size_t>> seqs = {{1, 10}, {2, 20}, {3, 40}};
+  for (const auto& [seq_id, exclusive_length] : seqs) {
+    radix_tree->ForkSequence(seq_id, 0, 60);
+    radix_tree->ExtendSequence(seq_id, _Tokens(1000 * seq_id, exclusive_length));
+    ASSERT_EQ(radix_tree->GetSequenceExclusiveLength(seq_id), exclusive_length);
+    evictor->RecycleSequence(seq_id);
+  }
+  // The sequences freeing more tokens go first, against the recycling order.
+  for (int64_t expected : {3, 2, 1}) {
+    int64_t victim = evictor->SelectVictim(nullptr);
+    ASSERT_EQ(victim, expected);
+    radix_tree->RemoveSequence(victim);
+    evictor->RemoveSequence(victim);
+  }
+  ASSERT_EQ(evictor->SelectVictim(nullptr), -1);
+}
+
+void _TestGDSFEvictsFullySharedFirst() {
+  PagedRadixTree radix_tree = PagedRadixTree::Create();
+  std::unique_ptr<PrefixCacheEvictor> evictor =
+      PrefixCacheEvictor::Create(PrefixCacheEvictionPolicy::kGDSF, radix_tree);
+  radix_tree->AddSequence(0);
+  radix_tree->ExtendSequence(0, _Tokens(0, 60));
+  evictor->RecycleSequence(0);
+  radix_tree->AddSequence(1);
+  radix_tree->ExtendSequence(1, _Tokens(100, 30));
+  evictor->RecycleSequence(1);
+  // Sequence 2 shares all its tokens with sequence 0, and costs no prefill to evict.
+  radix_tree->ForkSequence(2, 0, 40);
+  evictor->RecycleSequence(2);
+  ASSERT_EQ(evictor->SelectVictim(nullptr), 2);
+  // Sequence 0 keeps 20 exclusive tokens of 60, and sequence 1 keeps all its 30 tokens, whose
+  // priorities are 60 / 20 and 30 / 30.
+  ASSERT_EQ(evictor->SelectVictim([](int64_t seq_id) { return seq_id != 2; }), 1);
+}
+
+TEST(ServePrefixCacheEvictorTest, GDSFEvictsBySizeOnEqualFrequency) {
+  _TestGDSFEvictsBySizeOnEqualFrequency();
+}
+
+TEST(ServePrefixCacheEvictorTest, GDSFEvictsFullySharedFirst) { _TestGDSFEvictsFullySharedFirst(); }
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "serve/request.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+std::vector<Request> _CreateRequests(int num_requests) {
+  GenerationConfig generation_cfg(make_object<GenerationConfigNode>());
+  std::vector<Request> requests;
+  requests.reserve(num_requests);
+  for (int i = 0; i < num_requests; ++i) {
+    requests.push_back(
+        Request(std::to_string(i), {TokenData(std::vector<int32_t>{i})}, generation_cfg));
+  }
+  return requests;
+}
+
+void _TestRemoveRequestsFromQueue() {
+  std::vector<Request> requests = _CreateRequests(6);
+  std::vector<Request> queue = requests;
+  // Requests not in the queue are ignored.
+  std::vector<Request> removed = {requests[4], requests[1], _CreateRequests(1)[0]};
+  ASSERT_EQ(RemoveRequestsFromQueue(&queue, removed), 2);
+  // The remaining requests keep their order.
+  ASSERT_EQ(queue.size(), 4);
+  ASSERT_TRUE(queue[0].same_as(requests[0]));
+  ASSERT_TRUE(queue[1].same_as(requests[2]));
+  ASSERT_TRUE(queue[2].same_as(requests[3]));
+  ASSERT_TRUE(queue[3].same_as(requests[5]));
+  ASSERT_EQ(RemoveRequestsFromQueue(&queue, {}), 0);
+  ASSERT_EQ(RemoveRequestsFromQueue(&queue, queue), 4);
+  ASSERT_TRUE(queue.empty());
+}
+
+/*!
+ * \brief Compare the time of removing the requests finished in one engine step from the running
+ * queue one by one, against removing them in a single pass, at thousands of running requests.
+ */
+void _BenchmarkRemoveRequestsFromQueue() {
+  std::mt19937 rng(0);
+  std::cout << "num-running num-finished  one-by-one (us)  single-pass (us)" << std::endl;
+  for (int num_running : {1024, 4096}) {
+    std::vector<Request> requests = _CreateRequests(num_running);
+    for (int num_finished : {16, num_running / 4, num_running}) {
+      std::vector<Request> finished = requests;
+      std::shuffle(finished.begin(), finished.end(), rng);
+      finished.resize(num_finished);
+
+      std::vector<Request> queue = requests;
+      auto tstart = std::chrono::high_resolution_clock::now();
+      for (const Request& request : finished) {
+        queue.erase(std::find(queue.begin(), queue.end(), request));
+      }
+      auto tend = std::chrono::high_resolution_clock::now();
+      double one_by_one_us = static_cast<double>((tend - tstart).count()) / 1e3;
+
+      std::vector<Request> queue_single_pass = requests;
+      tstart = std::chrono::high_resolution_clock::now();
+      RemoveRequestsFromQueue(&queue_single_pass, finished);
+      tend = std::chrono::high_resolution_clock::now();
+      double single_pass_us = static_cast<double>((tend - tstart).count()) / 1e3;
+
+      ASSERT_EQ(queue.size(), queue_single_pass.size());
+      for (size_t i = 0; i < queue.size(); ++i) {
+        ASSERT_TRUE(queue[i].same_as(queue_single_pass[i]));
+      }
+      std::cout << std::setw(11) << num_running << " " << std::setw(12) << num_finished << " "
+                << std::setw(16) << one_by_one_us << " " << std::setw(17) << single_pass_us
+                << std::endl;
+    }
+  }
+}
+
+TEST(ServeRequestQueueTest, RemoveRequestsFromQueueTest) { _TestRemoveRequestsFromQueue(); }
+// The benchmark runs only with "--gtest_also_run_disabled_tests".
+TEST(ServeRequestQueueTest, DISABLED_RemoveRequestsFromQueueBenchmark) {
+  _BenchmarkRemoveRequestsFromQueue();
+}
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
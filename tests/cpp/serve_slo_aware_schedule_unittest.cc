@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "serve/engine_actions/action.h"
+
+namespace mlc {
+namespace llm {
+namespace serve {
+
+using Clock = std::chrono::high_resolution_clock;
+
+/*! \brief The action that records whether it is run and the prefill chunk size limit then. */
+class RecordingActionObj : public EngineActionObj {
+ public:
+  Array<Request> Step(EngineState estate) final {
+    ++num_steps;
+    prefill_chunk_size_limit = estate->prefill_chunk_size_limit;
+    return estate->running_queue.empty() ? Array<Request>(estate->waiting_queue)
+                                         : Array<Request>(estate->running_queue);
+  }
+
+  int num_steps = 0;
+  int64_t prefill_chunk_size_limit = -1;
+
+  static constexpr const char* _type_key = "mlc.serve.test.RecordingAction";
+  TVM_DECLARE_FINAL_OBJECT_INFO(RecordingActionObj, EngineActionObj);
+};
+
+/*! \brief The engine state with 0.2s batch decode time and 10ms prefill time per token. */
+struct SLOScheduleState {
+  EngineState estate;
+  std::vector<RequestState> rstates;
+
+  SLOScheduleState() {
+    estate->metrics.UpdateDecodeTimeByBatchSize(1, 0.2);
+    estate->metrics.prefill_tokens_sum = 100;
+    estate->metrics.engine_prefill_time_sum = 1.0;
+  }
+
+  /*!
+   * \brief Add a request state of the given input length and targets.
+   * \param time_since_last_token_ms The time since the request was added and output its last token.
+   */
+  RequestStateEntry AddRequestState(int input_length, int64_t ttft_slo_ms, int64_t tpot_slo_ms,
+                                    int64_t time_since_last_token_ms) {
+    ObjectPtr<GenerationConfigNode> n = make_object<GenerationConfigNode>();
+    n->ttft_slo_ms = ttft_slo_ms;
+    n->tpot_slo_ms = tpot_slo_ms;
+    Request request(std::to_string(rstates.size()),
+                    {TokenData(std::vector<int32_t>(input_length, 0))}, GenerationConfig(n));
+    RequestStateEntry rsentry(request, /*num_models=*/1, /*internal_id=*/rstates.size(),
+                              /*rng_seed=*/0, /*counter_based_rng=*/false, /*token_table=*/{},
+                              std::nullopt);
+    auto time_point = Clock::now() - std::chrono::milliseconds(time_since_last_token_ms);
+    RequestState rstate({rsentry}, /*num_response=*/1, time_point);
+    rstate->metrics.add_time_point = time_point;
+    rstate->metrics.last_token_time_point = time_point;
+    rsentry->rstate = rstate.operator->();
+    request->rstate = rstate.operator->();
+    rstates.push_back(rstate);
+    return rsentry;
+  }
+
+  /*! \brief Add a running request with the given TPOT target. */
+  void AddRunning(int64_t tpot_slo_ms) {
+    RequestStateEntry rsentry = AddRequestState(8, -1, tpot_slo_ms, 0);
+    rsentry->status = RequestStateStatus::kAlive;
+    rsentry->mstates[0]->inputs.clear();
+    rsentry->mstates[0]->num_tokens_for_next_decode = 1;
+    estate->running_queue.push_back(rsentry->request);
+    estate->running_rsentries_changed = true;
+  }
+
+  /*! \brief Add a waiting request with the given TTFT target. */
+  void AddWaiting(int input_length, int64_t ttft_slo_ms, int64_t time_since_added_ms) {
+    RequestStateEntry rsentry =
+        AddRequestState(input_length, ttft_slo_ms, -1, time_since_added_ms);
+    estate->waiting_queue.push_back(rsentry->request);
+  }
+};
+
+/*!
+ * \brief Run one SLO-aware schedule step.
+ * \return Whether the step prefills, and the prefill chunk size limit of the prefill.
+ */
+std::pair<bool, int64_t> _ScheduleStep(const SLOScheduleState& state) {
+  ObjectPtr<RecordingActionObj> prefill = make_object<RecordingActionObj>();
+  ObjectPtr<RecordingActionObj> decode = make_object<RecordingActionObj>();
+  ObjectPtr<EngineConfigNode> engine_config = make_object<EngineConfigNode>();
+  engine_config->kv_cache_page_size = 16;
+  engine_config->prefill_mode = PrefillMode::kHybrid;
+  EngineAction::SLOAwareSchedule(EngineAction(prefill), {EngineAction(decode)},
+                                 EngineConfig(engine_config))
+      ->Step(state.estate);
+  EXPECT_EQ(prefill->num_steps + decode->num_steps, 1);
+  // The limit only applies to the prefill of the step.
+  EXPECT_EQ(state.estate->prefill_chunk_size_limit, 0);
+  return {prefill->num_steps == 1, prefill->prefill_chunk_size_limit};
+}
+
+void _TestPrefillWithinTPOTSlack() {
+  SLOScheduleState state;
+  state.AddRunning(/*tpot_slo_ms=*/10000);
+  state.AddRunning(/*tpot_slo_ms=*/-1);
+  state.AddWaiting(/*input_length=*/2000, /*ttft_slo_ms=*/-1, 0);
+  // 9.8s of slack fits about 980 tokens, which are capped next to the 2 decode tokens.
+  auto [prefill, limit] = _ScheduleStep(state);
+  ASSERT_TRUE(prefill);
+  ASSERT_GT(limit, 900);
+  ASSERT_LE(limit, 982);
+}
+
+void _TestDecodeWithoutTTFTMiss() {
+  SLOScheduleState state;
+  // 0.1s of slack does not fit a page of 16 tokens.
+  state.AddRunning(/*tpot_slo_ms=*/300);
+  state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/-1, 0);
+  state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/100000, 0);
+  ASSERT_FALSE(_ScheduleStep(state).first);
+  // Running requests missing their targets anyway do not defer prefill.
+  SLOScheduleState missed_state;
+  missed_state.AddRunning(/*tpot_slo_ms=*/100);
+  missed_state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/-1, 0);
+  ASSERT_TRUE(_ScheduleStep(missed_state).first);
+}
+
+void _TestTradeTTFTAgainstTPOT() {
+  // Two waiting requests miss their TTFT targets by waiting for a decode step, while the prefill
+  // of two pages makes only one running request miss its TPOT target.
+  SLOScheduleState state;
+  state.AddRunning(/*tpot_slo_ms=*/300);
+  state.AddRunning(/*tpot_slo_ms=*/10000);
+  state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/1000, /*time_since_added_ms=*/800);
+  state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/1000, /*time_since_added_ms=*/800);
+  state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/-1, 0);
+  auto [prefill, limit] = _ScheduleStep(state);
+  ASSERT_TRUE(prefill);
+  ASSERT_EQ(limit, 2 * 16 + 2);
+
+  // One waiting request misses its TTFT target, while two running requests miss their TPOT
+  // targets by the prefill of a page.
+  SLOScheduleState tpot_state;
+  tpot_state.AddRunning(/*tpot_slo_ms=*/300);
+  tpot_state.AddRunning(/*tpot_slo_ms=*/300);
+  tpot_state.AddWaiting(/*input_length=*/10, /*ttft_slo_ms=*/1000, /*time_since_added_ms=*/800);
+  ASSERT_FALSE(_ScheduleStep(tpot_state).first);
+}
+
+void _TestEstimateDecodeTime() {
+  EngineMetrics metrics;
+  ASSERT_EQ(metrics.EstimateDecodeTime(4), 0.0);
+  metrics.UpdateDecodeTimeByBatchSize(8, 0.5);
+  metrics.UpdateDecodeTimeByBatchSize(64, 1.0);
+  ASSERT_EQ(metrics.EstimateDecodeTime(4), 0.5);
+  ASSERT_EQ(metrics.EstimateDecodeTime(40), 1.0);
+  // The batch sizes beyond the tracking range fall back to the largest tracked one.
+  ASSERT_EQ(metrics.EstimateDecodeTime(200), 1.0);
+  ASSERT_EQ(metrics.EstimateDecodeTime(1000), 1.0);
+}
+
+TEST(ServeSLOAwareScheduleTest, PrefillWithinTPOTSlackTest) { _TestPrefillWithinTPOTSlack(); }
+TEST(ServeSLOAwareScheduleTest, DecodeWithoutTTFTMissTest) { _TestDecodeWithoutTTFTMiss(); }
+TEST(ServeSLOAwareScheduleTest, TradeTTFTAgainstTPOTTest) { _TestTradeTTFTAgainstTPOT(); }
+TEST(ServeSLOAwareScheduleTest, EstimateDecodeTimeTest) { _TestEstimateDecodeTime(); }
+
+}  // namespace serve
+}  // namespace llm
+}  // namespace mlc
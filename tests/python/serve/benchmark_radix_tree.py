@@ -0,0 +1,105 @@
+# pylint: disable=missing-docstring
+"""Micro-benchmarks of the paged radix tree.
+
+The "match" benchmark measures the latency of `PagedRadixTree.match` under different fan-out
+of the root page and different depth (number of radix pages) of each sequence.
+The "churn" benchmark measures the latency of removing a random sequence and forking a new one
+from a shared prefix, with thousands of concurrent sequences, which stresses the page and
+sequence ID node pools.
+The latency includes the constant FFI overhead, so the trend along the swept parameter is the
+quantity of interest.
+
+Usage: python tests/python/serve/benchmark_radix_tree.py --benchmarks match churn --num-iters 2000
+"""
+import argparse
+import random
+import time
+
+from tvm.runtime import ShapeTuple
+
+from mlc_llm.serve import PagedRadixTree
+
+# The token capacity of each radix page.
+PAGE_CAPACITY = 64
+
+
+def _parse_args():
+    args = argparse.ArgumentParser()
+    args.add_argument("--benchmarks", type=str, nargs="+", default=["match", "churn"])
+    args.add_argument("--fan-outs", type=int, nargs="+", default=[1, 4, 16, 64, 256, 1024, 4096])
+    args.add_argument("--depths", type=int, nargs="+", default=[1, 8, 32])
+    args.add_argument("--num-seqs", type=int, nargs="+", default=[1000, 4000, 16000])
+    args.add_argument("--num-iters", type=int, default=2000)
+    args.add_argument("--seed", type=int, default=0)
+    return args.parse_args()
+
+
+def build_tree(fan_out: int, depth: int):
+    """Build a radix tree whose root page has `fan_out` child sequences of `depth` pages."""
+    prt = PagedRadixTree()
+    sequences = []
+    for seq_id in range(fan_out):
+        # The first token decides the child page of root, and the rest are random.
+        tokens = [seq_id] + [random.randint(0, 32000) for _ in range(depth * PAGE_CAPACITY - 1)]
+        prt.add(seq_id)
+        prt.extend(seq_id, tokens)
+        sequences.append(ShapeTuple(tokens))
+    return prt, sequences
+
+
+def benchmark_match(args: argparse.Namespace):
+    random.seed(args.seed)
+    print(f"{'fan-out':>8} {'depth':>6} {'latency (us)':>14}")
+    for fan_out in args.fan_outs:
+        for depth in args.depths:
+            prt, sequences = build_tree(fan_out, depth)
+            queries = [random.choice(sequences) for _ in range(args.num_iters)]
+            # Warm up.
+            for tokens in queries[:100]:
+                prt.match(tokens)
+            tic = time.perf_counter()
+            for tokens in queries:
+                prt.match(tokens)
+            toc = time.perf_counter()
+            latency_us = (toc - tic) / args.num_iters * 1e6
+            print(f"{fan_out:>8} {depth:>6} {latency_us:>14.3f}")
+
+
+def benchmark_churn(args: argparse.Namespace):
+    random.seed(args.seed)
+    prefix_length = 4 * PAGE_CAPACITY
+    suffix = [0] * 16
+    print(f"{'num-seqs':>8} {'latency (us)':>14}")
+    for num_seqs in args.num_seqs:
+        prt = PagedRadixTree()
+        prt.add(0)
+        prt.extend(0, [random.randint(0, 32000) for _ in range(prefix_length)])
+        # Every live sequence forks a random-length prefix of sequence 0 and decodes a suffix.
+        live_seq_ids = list(range(1, num_seqs + 1))
+        for seq_id in live_seq_ids:
+            prt.fork(seq_id, 0, random.randint(1, prefix_length))
+            prt.extend(seq_id, suffix)
+        next_seq_id = num_seqs + 1
+        victims = [random.randrange(num_seqs) for _ in range(args.num_iters)]
+        fork_lengths = [random.randint(1, prefix_length) for _ in range(args.num_iters)]
+        tic = time.perf_counter()
+        for victim, fork_length in zip(victims, fork_lengths):
+            prt.remove(live_seq_ids[victim])
+            prt.fork(next_seq_id, 0, fork_length)
+            prt.extend(next_seq_id, suffix)
+            live_seq_ids[victim] = next_seq_id
+            next_seq_id += 1
+        toc = time.perf_counter()
+        latency_us = (toc - tic) / args.num_iters * 1e6
+        print(f"{num_seqs:>8} {latency_us:>14.3f}")
+
+
+def benchmark(args: argparse.Namespace):
+    if "match" in args.benchmarks:
+        benchmark_match(args)
+    if "churn" in args.benchmarks:
+        benchmark_churn(args)
+
+
+if __name__ == "__main__":
+    benchmark(_parse_args())
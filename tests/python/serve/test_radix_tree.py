@@ -129,6 +129,111 @@ def test_rollback():
             seq_id += 2
 
 
+def test_large_fan_out():
+    prt = PagedRadixTree()
+    num_seqs = 300
+    # Each sequence is a distinct child page of root, so that the child index of root
+    # switches from the inline array to the hash table and back.
+    for seq_id in range(num_seqs):
+        prt.add(seq_id)
+        prt.extend(seq_id, [seq_id, seq_id + 1, seq_id + 2])
+    for seq_id in range(num_seqs):
+        assert prt.match([seq_id, seq_id + 1, seq_id + 2]) == (3, [seq_id])
+        assert prt.match([seq_id, seq_id + 1, -1]) == (2, [seq_id])
+    assert prt.match([num_seqs]) == (0, [])
+    for seq_id in range(0, num_seqs, 2):
+        prt.remove(seq_id)
+    for seq_id in range(num_seqs):
+        expected = (0, []) if seq_id % 2 == 0 else (3, [seq_id])
+        assert prt.match([seq_id, seq_id + 1, seq_id + 2]) == expected
+    # Split every remaining child page of root, and then merge them back by removal.
+    for seq_id in range(1, num_seqs, 2):
+        prt.fork(num_seqs + seq_id, seq_id, 1)
+        prt.extend(num_seqs + seq_id, [-seq_id])
+        assert prt.match([seq_id, -seq_id]) == (2, [num_seqs + seq_id])
+        assert prt.match([seq_id, seq_id + 1]) == (2, [seq_id])
+    for seq_id in range(1, num_seqs, 2):
+        prt.remove(seq_id)
+        prt.remove(num_seqs + seq_id)
+    for seq_id in range(num_seqs):
+        assert prt.match([seq_id, seq_id + 1, seq_id + 2]) == (0, [])
+
+
+def test_exclusive_length():
+    prt = PagedRadixTree()
+    prt.add(0)
+    assert prt.get_exclusive_length(0) == 0
+    prt.extend(0, [1 for _ in range(200)])
+    assert prt.get_exclusive_length(0) == 200
+    prt.fork(1, 0, 150)
+    assert prt.get_exclusive_length(0) == 50
+    assert prt.get_exclusive_length(1) == 0
+    prt.extend(1, [2 for _ in range(30)])
+    assert prt.get_exclusive_length(0) == 50
+    assert prt.get_exclusive_length(1) == 30
+    prt.add(2)
+    prt.extend(2, [1 for _ in range(10)] + [3 for _ in range(20)])
+    assert prt.get_exclusive_length(2) == 20
+    prt.remove(1)
+    assert prt.get_exclusive_length(0) == 190
+    # The exclusive tokens are exactly the ones matched by no other sequence.
+    assert prt.match([1 for _ in range(200)]) == (200, [0])
+    prt.remove(0)
+    assert prt.get_exclusive_length(2) == 30
+
+
+def test_export_import():
+    prt = PagedRadixTree()
+    prt.add(0)
+    prt.extend(0, [1 for _ in range(200)])
+    prt.fork(1, 0, 150)
+    prt.extend(1, [2 for _ in range(30)])
+    prt.add(2)
+    prt.extend(2, [3, 4, 5])
+    prt.add(3)
+    data = prt.export_binary()
+
+    new_prt = PagedRadixTree()
+    assert sorted(new_prt.import_binary(data)) == [0, 1, 2, 3]
+    for seq_id in range(4):
+        assert new_prt.get(seq_id) == prt.get(seq_id)
+        assert new_prt.get_exclusive_length(seq_id) == prt.get_exclusive_length(seq_id)
+    assert new_prt.match([1 for _ in range(150)] + [2]) == (151, [1])
+    # Importing existing sequences is rejected.
+    with pytest.raises(Exception):
+        new_prt.import_binary(data)
+    with pytest.raises(Exception):
+        PagedRadixTree().import_binary(data[:-1])
+
+
+def test_snapshot():
+    prt = PagedRadixTree()
+    prt.add(0)
+    prt.extend(0, [1 for _ in range(200)])
+    prt.fork(1, 0, 150)
+    prt.extend(1, [2 for _ in range(30)])
+    prt.add(2)
+    prt.extend(2, [3, 4, 5])
+    snapshot = prt.snapshot()
+    queries = [
+        [1 for _ in range(150)] + [2, 2, 3],
+        [1 for _ in range(201)],
+        [3, 4, 6],
+        [4],
+    ]
+    for tokens in queries:
+        assert snapshot.match_length(tokens) == prt.match(tokens)[0]
+    # The snapshot is unaffected by later modifications.
+    prt.remove(1)
+    prt.rollback(0, 100)
+    prt.add(3)
+    prt.extend(3, [4, 5])
+    assert snapshot.match_length(queries[0]) == 152
+    assert snapshot.match_length(queries[1]) == 200
+    assert snapshot.match_length(queries[3]) == 0
+    assert prt.snapshot().match_length(queries[3]) == 1
+
+
 if __name__ == "__main__":
     test_add()
     test_remove()
@@ -136,3 +241,7 @@ if __name__ == "__main__":
     test_fork()
     test_fork_2()
     test_rollback()
+    test_large_fan_out()
+    test_exclusive_length()
+    test_export_import()
+    test_snapshot()
@@ -1,6 +1,7 @@
 # pylint: disable=chained-comparison,line-too-long,missing-docstring,
 # pylint: disable=too-many-arguments,too-many-locals,unused-argument,unused-variable
 import asyncio
+import time
 from typing import List
 
 from mlc_llm.protocol.generation_config import GenerationConfig
@@ -79,6 +80,67 @@ async def test_engine_generate(model: str):
     del async_engine
 
 
+@require_test_model("Llama-2-7b-chat-hf-q4f16_1-MLC")
+async def test_engine_generate_slo_scheduler(model: str):
+    # Create engine
+    async_engine = AsyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(max_total_sequence_length=4096, scheduler_mode="slo"),
+    )
+
+    num_requests = 8
+    num_running_requests = 4
+    # The running requests have TPOT targets, and the requests arriving later have tight TTFT
+    # targets, so that the scheduler fits the prefill of the latter in the TPOT slack of the former.
+    running_cfg = GenerationConfig(max_tokens=256, tpot_slo_ms=1000)
+    arriving_cfg = GenerationConfig(max_tokens=16, ttft_slo_ms=200)
+    output_texts: List[str] = ["" for _ in range(num_requests)]
+    first_token_times: List[float] = [0.0 for _ in range(num_requests)]
+    finish_times: List[float] = [0.0 for _ in range(num_requests)]
+    running_started = [asyncio.Event() for _ in range(num_running_requests)]
+
+    async def generate_task(prompt: str, generation_cfg: GenerationConfig, request_id: str):
+        rid = int(request_id)
+        async for delta_outputs in async_engine._generate(
+            prompt, generation_cfg, request_id=request_id
+        ):
+            if delta_outputs[0].request_final_usage_json_str is not None:
+                continue
+            if first_token_times[rid] == 0.0:
+                first_token_times[rid] = time.monotonic()
+                if rid < num_running_requests:
+                    running_started[rid].set()
+            output_texts[rid] += delta_outputs[0].delta_text
+        finish_times[rid] = time.monotonic()
+
+    tasks = [
+        asyncio.create_task(generate_task(prompts[i], running_cfg, request_id=str(i)))
+        for i in range(num_running_requests)
+    ]
+    # The requests with TTFT targets arrive when the others are decoding.
+    await asyncio.gather(*[event.wait() for event in running_started])
+    tasks += [
+        asyncio.create_task(generate_task(prompts[i], arriving_cfg, request_id=str(i)))
+        for i in range(num_running_requests, num_requests)
+    ]
+    await asyncio.gather(*tasks)
+
+    # Print output.
+    print("All finished")
+    for req_id, output in enumerate(output_texts):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output}\n")
+        assert len(output) > 0
+
+    # The arriving requests are prefilled while the running requests decode, instead of waiting
+    # for them to finish.
+    assert max(first_token_times[num_running_requests:]) < min(finish_times[:num_running_requests])
+
+    async_engine.terminate()
+    del async_engine
+
+
 @require_test_model("Llama-2-7b-chat-hf-q4f16_1-MLC")
 async def test_chat_completion(model: str):
     # Create engine
@@ -281,6 +343,7 @@ async def test_completion_non_stream(model: str):
 
 if __name__ == "__main__":
     asyncio.run(test_engine_generate())
+    asyncio.run(test_engine_generate_slo_scheduler())
     asyncio.run(test_chat_completion())
     asyncio.run(test_chat_completion_non_stream())
     asyncio.run(test_completion())
@@ -69,6 +69,68 @@ def test_engine_multi_round(engine):
     output_texts, _ = engine.generate(concat_prompt[:num_requests], generation_config)
     metrics = engine.metrics()
     assert metrics["prefill_tokens_sum"] == sum_prefill_tokens + 2 * num_requests
+    prefix_cache_metrics = metrics["prefix_cache"]
+    assert prefix_cache_metrics["num_misses"] == num_requests
+    assert prefix_cache_metrics["num_reuses"] == num_requests
+    assert (
+        prefix_cache_metrics["prompt_tokens_sum"] - prefix_cache_metrics["matched_tokens_sum"]
+        == metrics["prefill_tokens_sum"]
+    )
+
+
+def test_engine_warm_up(engine):
+    max_tokens = 8
+    generation_config = GenerationConfig(temperature=0, max_tokens=max_tokens)
+    _, _ = engine.generate(prompts, generation_config)
+    data = engine.export_prefix_cache()
+
+    # Reset drops the prefix cache, and warming up restores it from the exported data.
+    engine.reset()
+    engine.warm_up_prefix_cache(data)
+    metrics = engine.metrics()
+    sum_prefill_tokens = metrics["prefill_tokens_sum"]
+    _, _ = engine.generate(prompts, generation_config)
+    metrics = engine.metrics()
+    # Only the last token of each prompt needs prefill.
+    assert metrics["prefill_tokens_sum"] == sum_prefill_tokens + len(prompts)
+
+
+def test_engine_tenant_isolation(engine):
+    max_tokens = 8
+
+    def generate(prompt: str, tenant: str, shared: bool = False):
+        generation_config = GenerationConfig(
+            temperature=0,
+            max_tokens=max_tokens,
+            debug_config=DebugConfig(
+                prefix_cache_tenant=tenant, share_prefix_across_tenants=shared
+            ),
+        )
+        sum_prefill_tokens = engine.metrics()["prefill_tokens_sum"]
+        _, _ = engine.generate(prompt, generation_config)
+        return engine.metrics()["prefill_tokens_sum"] - sum_prefill_tokens
+
+    input_token_lens = [len(engine.tokenizer.encode(prompt)) for prompt in prompts[:2]]
+    assert generate(prompts[0], "a") == input_token_lens[0]
+    # The prefix of tenant "a" is invisible to tenant "b", but reused by tenant "a".
+    assert generate(prompts[0], "b") == input_token_lens[0]
+    assert generate(prompts[0], "a") == 1
+    # The prefix shared by tenant "a" is visible to tenant "b".
+    assert generate(prompts[1], "a", shared=True) == input_token_lens[1]
+    assert generate(prompts[1], "b") == 1
+
+
+def test_engine_prefix_aware_order(engine):
+    max_tokens = 8
+    generation_config = GenerationConfig(temperature=0, max_tokens=max_tokens)
+    input_token_lens = [len(engine.tokenizer.encode(prompt)) for prompt in prompts[:3]]
+    _, _ = engine.generate(prompts[0], generation_config)
+    sum_prefill_tokens = engine.metrics()["prefill_tokens_sum"]
+    # The request reusing the cached prompt is prefilled first, before the other requests are
+    # recycled and the cached prompt is evicted.
+    _, _ = engine.generate([prompts[1], prompts[2], prompts[0]], generation_config)
+    metrics = engine.metrics()
+    assert metrics["prefill_tokens_sum"] == sum_prefill_tokens + sum(input_token_lens[1:3]) + 1
 
 
 @require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
@@ -85,6 +147,17 @@ def test_basic_engine_system_prompt(model: str):
     test_engine_system_prompt(engine)
 
 
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_basic_engine_warm_up(model: str):
+    # Create engine
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(max_total_sequence_length=4096),
+    )
+    test_engine_warm_up(engine)
+
+
 @require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
 def test_basic_engine_multi_round(model: str):
     # Create engine
@@ -96,6 +169,35 @@ def test_basic_engine_multi_round(model: str):
     test_engine_multi_round(engine)
 
 
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_basic_engine_tenant_isolation(model: str):
+    # Create engine
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(
+            max_total_sequence_length=4096,
+            prefix_cache_tenant_max_num_recycling_seqs=2,
+        ),
+    )
+    test_engine_tenant_isolation(engine)
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_basic_engine_prefix_aware_order(model: str):
+    # Create engine
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(
+            max_num_sequence=1,
+            max_total_sequence_length=4096,
+            waiting_queue_order="prefix_aware",
+        ),
+    )
+    test_engine_prefix_aware_order(engine)
+
+
 @require_test_model(
     "Llama-2-7b-chat-hf-q0f16-MLC",
     "Llama-2-7b-chat-hf-q4f16_1-MLC",
@@ -136,6 +238,9 @@ def test_engine_eagle_multi_round(model: str):
 
 if __name__ == "__main__":
     test_basic_engine_system_prompt()
+    test_basic_engine_warm_up()
     test_basic_engine_multi_round()
+    test_basic_engine_tenant_isolation()
+    test_basic_engine_prefix_aware_order()
     test_engine_spec_multi_round()
     test_engine_eagle_multi_round()
@@ -429,6 +429,45 @@ def test_engine_generate(model: str, small_model: str, compare_precision=False):
             print(f"Accuracy verification failed\n")
 
 
+@require_test_model(
+    "Llama-2-7b-chat-hf-q0f16-MLC",
+    "Llama-2-7b-chat-hf-q4f16_1-MLC",
+)
+def test_engine_top_k_min_p(model: str, small_model: str):
+    """Test speculative decoding **with top-k and min-p sampling**.
+
+    - Generate with greedy sampling, and with random sampling truncated by
+    top-k of 1 or min-p of 1, which both keep only the most probable token.
+    - The draft tokens are verified against the truncated distributions, so
+    the outputs are the same.
+    """
+
+    num_requests = 4
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(
+            max_total_sequence_length=4096,
+            additional_models=[small_model],
+            speculative_mode="small_draft",
+        ),
+    )
+    output_texts_list = []
+    for generation_config in [
+        GenerationConfig(temperature=0.0, max_tokens=32),
+        GenerationConfig(temperature=1.0, top_k=1, max_tokens=32),
+        GenerationConfig(temperature=1.0, min_p=1.0, max_tokens=32),
+    ]:
+        output_texts, _ = engine.generate(prompts[:num_requests], generation_config)
+        output_texts_list.append(output_texts)
+
+    for req_id in range(num_requests):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output_texts_list[0][req_id][0]}\n")
+        assert output_texts_list[1][req_id] == output_texts_list[0][req_id]
+        assert output_texts_list[2][req_id] == output_texts_list[0][req_id]
+
+
 @require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
 def test_engine_eagle_generate(model: str):
     # Create engine
@@ -656,6 +695,7 @@ if __name__ == "__main__":
     test_engine_continuous_batching_1()
     test_engine_eagle_continuous_batching_1()
     test_engine_generate(compare_precision=True)
+    test_engine_top_k_min_p()
     test_engine_eagle_generate()
     test_engine_efficiency()
     test_engine_spec_efficiency()
@@ -4,6 +4,7 @@ from typing import Callable, List, Optional
 
 import numpy as np
 
+from mlc_llm.protocol.debug_protocol import DebugConfig
 from mlc_llm.protocol.generation_config import GenerationConfig
 from mlc_llm.serve import Request, RequestStreamOutput, data
 from mlc_llm.serve.sync_engine import EngineConfig, SyncMLCEngine
@@ -467,6 +468,252 @@ def test_engine_hybrid_prefill(model: str):
         ), f"finish time = {fin_time}, max tokens = {req_id + request.generation_config.max_tokens - 1}"
 
 
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_fair_share(model: str):
+    """Test engine **with the fair-share waiting queue order**.
+
+    - Add the requests of the "batch" class first, and then the requests of the
+    "interactive" class, which has a larger weight.
+    - At most two requests run at a time. So the requests are admitted to prefill
+    one by one, and the "interactive" requests are admitted ahead of the earlier
+    "batch" requests by deficit round robin.
+    - Engine keeps running `step` until all requests finish. Then check the
+    admission order and the per-class metrics.
+    """
+
+    # Hyperparameters for tests (you can try different combinations)
+    num_batch_requests = 6
+    num_interactive_requests = 2
+    num_requests = num_batch_requests + num_interactive_requests
+    max_tokens = 8
+    np.random.seed(0)
+
+    # Output list
+    outputs: List[List[int]] = [[] for _ in range(num_requests)]
+    first_token_order: List[int] = []
+
+    def fcallback(delta_outputs: List[RequestStreamOutput]):
+        for delta_output in delta_outputs:
+            request_id, stream_outputs = delta_output.unpack()
+            assert len(stream_outputs) == 1
+            if len(outputs[int(request_id)]) == 0:
+                first_token_order.append(int(request_id))
+            outputs[int(request_id)] += stream_outputs[0].delta_token_ids
+
+    # Create engine
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        request_stream_callback=fcallback,
+        engine_config=EngineConfig(
+            max_num_sequence=2,
+            waiting_queue_order="fair_share",
+            request_class_weights={"interactive": 4},
+        ),
+    )
+
+    # Create requests
+    for req_id, prompt in zip(range(num_requests), prompts):
+        request_class = "batch" if req_id < num_batch_requests else "interactive"
+        engine.add_request(
+            engine.create_request(
+                request_id=str(req_id),
+                inputs=data.TextData(prompt),
+                generation_config=GenerationConfig(
+                    temperature=0.0, max_tokens=max_tokens, request_class=request_class
+                ),
+            )
+        )
+
+    # Run steps
+    num_steps = num_requests * max_tokens
+    for _ in range(num_steps):
+        engine.step()
+
+    for req_id, output in enumerate(outputs):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{engine.tokenizer.decode(output)}\n")
+        assert len(output) == max_tokens
+    # The interactive requests do not wait for all batch requests.
+    print(f"First token order: {first_token_order}")
+    interactive_ranks = [
+        first_token_order.index(req_id) for req_id in range(num_batch_requests, num_requests)
+    ]
+    assert max(interactive_ranks) < num_requests - 1
+
+    metrics = engine.metrics()
+    print(f"Request class metrics: {metrics['request_classes']}")
+    assert metrics["request_classes"]["batch"]["num_admitted"] == num_batch_requests
+    assert metrics["request_classes"]["interactive"]["num_admitted"] == num_interactive_requests
+    assert metrics["request_classes"]["batch"]["queue_depth"] == 0
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_overlap_post_process(model: str):
+    """Test engine **with overlapped post-process**.
+
+    - Generate with greedy sampling and different max tokens, with and without
+    the post-process overlapped with the next decode step.
+    - The requests finishing in the overlapped post-process are decoded for one more
+    token, which must not show up in the outputs. So the outputs are the same.
+    """
+
+    num_requests = 10
+    generation_config = [
+        GenerationConfig(temperature=0.0, max_tokens=8 + 4 * req_id)
+        for req_id in range(num_requests)
+    ]
+
+    output_texts_list = []
+    for overlap_post_process in [False, True]:
+        engine = SyncMLCEngine(
+            model=model,
+            mode="server",
+            engine_config=EngineConfig(overlap_post_process=overlap_post_process),
+        )
+        output_texts, _ = engine.generate(prompts[:num_requests], generation_config)
+        output_texts_list.append(output_texts)
+        del engine
+
+    for req_id in range(num_requests):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output_texts_list[1][req_id][0]}\n")
+        assert output_texts_list[1][req_id] == output_texts_list[0][req_id]
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_multi_step_decode(model: str):
+    """Test engine **with multi-step decode**.
+
+    - Generate with greedy sampling and different max tokens, with one decode step
+    and with up to 8 decode steps in each engine step.
+    - The requests finishing by stop tokens or max tokens in the middle of an engine
+    step stop decoding. So the outputs are the same.
+    """
+
+    num_requests = 10
+    generation_config = [
+        GenerationConfig(temperature=0.0, max_tokens=5 + 3 * req_id)
+        for req_id in range(num_requests)
+    ]
+
+    output_texts_list = []
+    for max_decode_steps in [1, 8]:
+        engine = SyncMLCEngine(
+            model=model,
+            mode="server",
+            engine_config=EngineConfig(max_decode_steps=max_decode_steps),
+        )
+        output_texts, _ = engine.generate(prompts[:num_requests], generation_config)
+        output_texts_list.append(output_texts)
+        del engine
+
+    for req_id in range(num_requests):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output_texts_list[1][req_id][0]}\n")
+        assert output_texts_list[1][req_id] == output_texts_list[0][req_id]
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_admission_reservation(model: str):
+    """Test engine **with the KV cache reservation for decode on admission**.
+
+    - The KV cache holds a few requests of "max_tokens" output tokens, and the
+    requests are added all at once.
+    - Under the "max_tokens" admission policy, a request is admitted only when the
+    KV cache has room for the decode of all running requests. So no running
+    request is preempted.
+    """
+
+    num_requests = 10
+    max_tokens = 256
+
+    # Create engine
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(
+            max_total_sequence_length=2048,
+            admission_policy="max_tokens",
+        ),
+    )
+
+    output_texts, _ = engine.generate(
+        prompts[:num_requests],
+        GenerationConfig(
+            temperature=0.0, max_tokens=max_tokens, debug_config=DebugConfig(ignore_eos=True)
+        ),
+    )
+    for req_id, outputs in enumerate(output_texts):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{outputs[0]}\n")
+
+    metrics = engine.metrics()
+    print(f"Admission metrics: {metrics['admission']}")
+    assert metrics["admission"]["num_held_admissions"] > 0
+    assert "preemption" not in metrics
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_top_k_min_p(model: str):
+    """Test engine **with top-k and min-p sampling**.
+
+    - Generate with greedy sampling, and with random sampling truncated by
+    top-k of 1 or min-p of 1, which both keep only the most probable token.
+    - So the outputs are the same.
+    """
+
+    num_requests = 4
+    engine = SyncMLCEngine(model=model, mode="server")
+    output_texts_list = []
+    for generation_config in [
+        GenerationConfig(temperature=0.0, max_tokens=32),
+        GenerationConfig(temperature=1.0, top_k=1, max_tokens=32),
+        GenerationConfig(temperature=1.0, min_p=1.0, max_tokens=32),
+    ]:
+        output_texts, _ = engine.generate(prompts[:num_requests], generation_config)
+        output_texts_list.append(output_texts)
+
+    for req_id in range(num_requests):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output_texts_list[0][req_id][0]}\n")
+        assert output_texts_list[1][req_id] == output_texts_list[0][req_id]
+        assert output_texts_list[2][req_id] == output_texts_list[0][req_id]
+
+
+@require_test_model("Llama-2-7b-chat-hf-q0f16-MLC")
+def test_engine_deterministic_sampling(model: str):
+    """Test engine **with deterministic sampling**.
+
+    - Generate with random sampling and fixed seeds, once with all requests in
+    one batch and once with each request alone.
+    - The random numbers of a request depend only on its seed and the number of
+    draws before, and the sampled token does not depend on the order of reduction. So the
+    outputs are the same.
+    """
+
+    num_requests = 4
+    engine = SyncMLCEngine(
+        model=model,
+        mode="server",
+        engine_config=EngineConfig(deterministic_sampling=True),
+    )
+    generation_configs = [
+        GenerationConfig(temperature=1.0, top_p=0.9, seed=req_id, max_tokens=32)
+        for req_id in range(num_requests)
+    ]
+    output_texts_batched, _ = engine.generate(prompts[:num_requests], generation_configs)
+    output_texts_alone = [
+        engine.generate([prompts[req_id]], generation_configs[req_id])[0][0]
+        for req_id in range(num_requests)
+    ]
+
+    for req_id in range(num_requests):
+        print(f"Prompt {req_id}: {prompts[req_id]}")
+        print(f"Output {req_id}:{output_texts_batched[req_id][0]}\n")
+        assert output_texts_alone[req_id] == output_texts_batched[req_id]
+
+
 if __name__ == "__main__":
     test_engine_basic()
     test_engine_continuous_batching_1()
@@ -474,3 +721,9 @@ if __name__ == "__main__":
     test_engine_continuous_batching_3()
     test_engine_generate()
     test_engine_hybrid_prefill()
+    test_engine_fair_share()
+    test_engine_overlap_post_process()
+    test_engine_multi_step_decode()
+    test_engine_admission_reservation()
+    test_engine_top_k_min_p()
+    test_engine_deterministic_sampling()